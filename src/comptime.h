@@ -0,0 +1,6 @@
+
+// Do not edit!  This file was autogenerated
+// by the ../comptime.sh script with git
+//
+const char* compbranch = "master";
+const char* comprevision = "dab15ae3";
@@ -10,6 +10,24 @@
 /// \file  d_clisrv.c
 /// \brief SRB2 Network game communication and protocol, all OS independent parts.
 
+#ifdef HAVE_ZLIB
+#ifndef _MSC_VER
+#ifndef _LARGEFILE64_SOURCE
+#define _LARGEFILE64_SOURCE
+#endif
+#endif
+
+#ifndef _LFS64_LARGEFILE
+#define _LFS64_LARGEFILE
+#endif
+
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 0
+#endif
+
+#include <zlib.h>
+#endif
+
 #include <time.h>
 #ifdef __GNUC__
 #include <unistd.h> //for unlink
@@ -104,7 +122,24 @@ static tic_t firstticstosend; // min of the nettics
 static tic_t tictoclear = 0; // optimize d_clearticcmd
 static tic_t maketic;
 
-static INT16 consistancy[BACKUPTICS];
+static UINT32 consistancy[BACKUPTICS];
+
+// A consistancy value is split into parts that each cover some of the
+// game state, so that the server can tell what went out of synch.
+// Only the players can be resynched, so they get the most bits; the
+// rest of the world is just reported when it differs.
+typedef enum
+{
+	SYNCH_PLAYERS,
+	SYNCH_MOBJS,
+	SYNCH_SECTORS,
+	SYNCH_POLYOBJS,
+	NUMSYNCHPARTS
+} synchpart_t;
+
+static const UINT32 synchpartmask[NUMSYNCHPARTS] = {0x0000FFFF, 0x00FF0000, 0x0F000000, 0xF0000000};
+
+static const char *const synchpartnames[NUMSYNCHPARTS] = {"players", "objects", "sectors", "polyobjects"};
 
 // Resynching shit!
 static UINT32 resynch_score[MAXNETNODES]; // "score" for kicking -- if this gets too high then cfail kick
@@ -112,6 +147,7 @@ static UINT16 resynch_delay[MAXNETNODES]; // delay time before the player can be
 static UINT32 resynch_status[MAXNETNODES]; // 0 bit means synched for that player, 1 means possibly desynched
 static UINT8 resynch_sent[MAXNETNODES][MAXPLAYERS]; // what synch packets have we attempted to send to the player
 static UINT8 resynch_inprogress[MAXNETNODES];
+static tic_t resynch_worldcheck[MAXNETNODES]; // first tic the whole world is checked at, rather than just the players
 static UINT8 resynch_local_inprogress = false; // WE are desynched and getting packets to fix it.
 static UINT8 player_joining = false;
 UINT8 hu_resynching = 0;
@@ -992,6 +1028,7 @@ static inline void resynch_read_others(resynchend_pak *p)
 static void SV_InitResynchVars(INT32 node)
 {
 	resynch_delay[node] = TICRATE; // initial one second delay
+	resynch_worldcheck[node] = gametic + 2*TICRATE; // after the next P_RefreshSynchHashes
 	resynch_score[node] = 0; // clean slate
 	resynch_status[node] = 0x00;
 	resynch_inprogress[node] = false;
@@ -1105,7 +1142,7 @@ static void SV_AcknowledgeResynchAck(INT32 node, UINT8 rsg)
 // end resynch
 // -----------------------------------------------------------------
 
-static INT16 Consistancy(void);
+static UINT32 Consistancy(void);
 
 typedef enum
 {
@@ -1795,6 +1832,12 @@ static boolean CL_SendJoin(void)
 	strncpy(netbuffer->u.clientcfg.names[0], cv_playername.zstring, MAXPLAYERNAME);
 	strncpy(netbuffer->u.clientcfg.names[1], cv_playername2.zstring, MAXPLAYERNAME);
 
+#ifdef HAVE_ZLIB
+	netbuffer->u.clientcfg.caninflate = 1;
+#else
+	netbuffer->u.clientcfg.caninflate = 0;
+#endif
+
 	return HSendPacket(servernode, true, 0, sizeof (clientconfig_pak));
 }
 
@@ -2043,12 +2086,110 @@ static boolean SV_SendServerConfig(INT32 node)
 #ifndef NONET
 #define SAVEGAMESIZE (768*1024)
 
-static void SV_SendSaveGame(INT32 node)
+// How the savegame sent to joining players is packed.
+// It starts with its uncompressed length and one of these.
+// The whole savegame is written before it gets compressed, and sent as
+// one file, so the client only unpacks it once all of it has arrived.
+typedef enum
+{
+	SAVECOMP_NONE,
+	SAVECOMP_LZF,
+	SAVECOMP_DEFLATE,
+} savecompression_t;
+
+#define SAVEGAMEHEADERSIZE (sizeof(UINT32) + sizeof(UINT8))
+#define SAVEGAMECHUNKSIZE (64*1024) // how much gets compressed or decompressed at a time
+
+#ifdef HAVE_ZLIB
+/** Deflates a finished savegame a chunk at a time, into a buffer that only
+  * grows as far as the compressed data needs it to.
+  *
+  * \param in The uncompressed savegame.
+  * \param inlength Its length.
+  * \param header Bytes to reserve in front of the compressed data.
+  * \param outlength Set to the length of the result, header included.
+  * \return A malloc'd buffer, or NULL if it didn't compress well enough to be worth it.
+  */
+static UINT8 *SV_DeflateSaveGame(UINT8 *in, size_t inlength, size_t header, size_t *outlength)
+{
+	z_stream strm;
+	UINT8 *out, *newout;
+	size_t outsize = header + inlength/4 + SAVEGAMECHUNKSIZE;
+	size_t inpos = 0;
+	int zErr;
+
+	memset(&strm, 0, sizeof strm);
+	if (deflateInit(&strm, Z_BEST_SPEED) != Z_OK)
+		return NULL;
+
+	out = malloc(outsize);
+	if (!out)
+	{
+		deflateEnd(&strm);
+		return NULL;
+	}
+	strm.next_out = out + header;
+	strm.avail_out = (uInt)(outsize - header);
+
+	do
+	{
+		size_t chunk = min(inlength - inpos, SAVEGAMECHUNKSIZE);
+
+		strm.next_in = in + inpos;
+		strm.avail_in = (uInt)chunk;
+		inpos += chunk;
+
+		do
+		{
+			if (!strm.avail_out)
+			{
+				size_t used = outsize;
+
+				// Not worth it anymore; just send it as it is.
+				if (outsize >= header + inlength)
+				{
+					deflateEnd(&strm);
+					free(out);
+					return NULL;
+				}
+
+				outsize = min(outsize*2, header + inlength);
+				newout = realloc(out, outsize);
+				if (!newout)
+				{
+					deflateEnd(&strm);
+					free(out);
+					return NULL;
+				}
+				out = newout;
+				strm.next_out = out + used;
+				strm.avail_out = (uInt)(outsize - used);
+			}
+
+			zErr = deflate(&strm, inpos == inlength ? Z_FINISH : Z_NO_FLUSH);
+		} while (zErr == Z_OK && (strm.avail_in || (inpos == inlength && zErr != Z_STREAM_END)));
+	} while (zErr == Z_OK && inpos < inlength);
+
+	deflateEnd(&strm);
+
+	if (zErr != Z_STREAM_END)
+	{
+		free(out);
+		return NULL;
+	}
+
+	*outlength = header + strm.total_out;
+	return out;
+}
+#endif
+
+static void SV_SendSaveGame(INT32 node, boolean caninflate)
 {
-	size_t length, compressedlen;
+	size_t length, compressedlen = 0;
 	UINT8 *savebuffer;
-	UINT8 *compressedsave;
+	UINT8 *compressedsave = NULL;
 	UINT8 *buffertosend;
+	UINT8 compression = SAVECOMP_NONE;
 
 	// first save it in a malloced buffer
 	savebuffer = (UINT8 *)malloc(SAVEGAMESIZE);
@@ -2058,8 +2199,8 @@ static void SV_SendSaveGame(INT32 node)
 		return;
 	}
 
-	// Leave room for the uncompressed length.
-	save_p = savebuffer + sizeof(UINT32);
+	// Leave room for the uncompressed length and compression method.
+	save_p = savebuffer + SAVEGAMEHEADERSIZE;
 
 	P_SaveNetGame();
 
@@ -2071,36 +2212,51 @@ static void SV_SendSaveGame(INT32 node)
 		I_Error("Savegame buffer overrun");
 	}
 
+	// Attempt to compress it.
+#ifdef HAVE_ZLIB
+	if (caninflate)
+	{
+		compressedsave = SV_DeflateSaveGame(savebuffer + SAVEGAMEHEADERSIZE, length - SAVEGAMEHEADERSIZE, SAVEGAMEHEADERSIZE, &compressedlen);
+		if (compressedsave)
+			compression = SAVECOMP_DEFLATE;
+	}
+#else
+	(void)caninflate;
+#endif
+
 	// Allocate space for compressed save: one byte fewer than for the
 	// uncompressed data to ensure that the compression is worthwhile.
-	compressedsave = malloc(length - 1);
-	if (!compressedsave)
+	if (!compressedsave && (compressedsave = malloc(length - 1)) != NULL)
 	{
-		CONS_Alert(CONS_ERROR, M_GetText("No more free memory for savegame\n"));
-		return;
+		compressedlen = lzf_compress(savebuffer + SAVEGAMEHEADERSIZE, length - SAVEGAMEHEADERSIZE, compressedsave + SAVEGAMEHEADERSIZE, length - SAVEGAMEHEADERSIZE - 1);
+		if (compressedlen)
+		{
+			compressedlen += SAVEGAMEHEADERSIZE;
+			compression = SAVECOMP_LZF;
+		}
+		else
+		{
+			free(compressedsave);
+			compressedsave = NULL;
+		}
 	}
 
-	// Attempt to compress it.
-	if((compressedlen = lzf_compress(savebuffer + sizeof(UINT32), length - sizeof(UINT32), compressedsave + sizeof(UINT32), length - sizeof(UINT32) - 1)))
+	if (compressedsave)
 	{
 		// Compressing succeeded; send compressed data
-
 		free(savebuffer);
 
-		// State that we're compressed.
 		buffertosend = compressedsave;
-		WRITEUINT32(compressedsave, length - sizeof(UINT32));
-		length = compressedlen + sizeof(UINT32);
+		WRITEUINT32(compressedsave, length - SAVEGAMEHEADERSIZE);
+		WRITEUINT8(compressedsave, compression);
+		length = compressedlen;
 	}
 	else
 	{
 		// Compression failed to make it smaller; send original
-
-		free(compressedsave);
-
-		// State that we're not compressed
 		buffertosend = savebuffer;
-		WRITEUINT32(savebuffer, 0);
+		WRITEUINT32(savebuffer, length - SAVEGAMEHEADERSIZE);
+		WRITEUINT8(savebuffer, compression);
 	}
 
 	AddRamToSendQueue(node, buffertosend, length, SF_RAM, 0);
@@ -2157,35 +2313,127 @@ static void SV_SavedGame(void)
 #define TMPSAVENAME "$$$.sav"
 
 
+#ifdef HAVE_ZLIB
+/** Inflates a received savegame straight from the file it was stored in,
+  * a chunk at a time, so that the compressed data never has to be in
+  * memory all at once. Only done once the whole file is there.
+  *
+  * \param f The savegame file, positioned after its header.
+  * \param out Where to put the savegame.
+  * \param outlength Its uncompressed length.
+  * \return true if it came out as long as it should have.
+  */
+static boolean CL_InflateSaveGame(FILE *f, UINT8 *out, size_t outlength)
+{
+	z_stream strm;
+	UINT8 *chunk;
+	int zErr = Z_OK;
+
+	memset(&strm, 0, sizeof strm);
+	if (inflateInit(&strm) != Z_OK)
+		return false;
+
+	chunk = Z_Malloc(SAVEGAMECHUNKSIZE, PU_STATIC, NULL);
+	strm.next_out = out;
+	strm.avail_out = (uInt)outlength;
+
+	while (zErr == Z_OK)
+	{
+		if (!strm.avail_in)
+		{
+			strm.avail_in = (uInt)fread(chunk, 1, SAVEGAMECHUNKSIZE, f);
+			strm.next_in = chunk;
+			if (!strm.avail_in)
+				break;
+		}
+		zErr = inflate(&strm, Z_NO_FLUSH);
+	}
+
+	inflateEnd(&strm);
+	Z_Free(chunk);
+
+	return (zErr == Z_STREAM_END && strm.total_out == outlength);
+}
+#endif
+
 static void CL_LoadReceivedSavegame(void)
 {
 	UINT8 *savebuffer = NULL;
+	UINT8 header[SAVEGAMEHEADERSIZE];
 	size_t length, decompressedlen;
+	UINT8 compression;
 	char tmpsave[256];
+	FILE *f;
 
 	sprintf(tmpsave, "%s" PATHSEP TMPSAVENAME, srb2home);
 
-	length = FIL_ReadFile(tmpsave, &savebuffer);
+	f = fopen(tmpsave, "rb");
+	if (!f)
+	{
+		I_Error("Can't read savegame sent");
+		return;
+	}
+
+	fseek(f, 0, SEEK_END);
+	length = ftell(f);
+	fseek(f, 0, SEEK_SET);
 
 	CONS_Printf(M_GetText("Loading savegame length %s\n"), sizeu1(length));
-	if (!length)
+	if (length < SAVEGAMEHEADERSIZE || fread(header, 1, SAVEGAMEHEADERSIZE, f) != SAVEGAMEHEADERSIZE)
 	{
+		fclose(f);
 		I_Error("Can't read savegame sent");
 		return;
 	}
 
-	save_p = savebuffer;
+	save_p = header;
+	decompressedlen = READUINT32(save_p);
+	compression = READUINT8(save_p);
 
 	// Decompress saved game if necessary.
-	decompressedlen = READUINT32(save_p);
-	if(decompressedlen > 0)
+	switch (compression)
+	{
+		case SAVECOMP_NONE:
+			length -= SAVEGAMEHEADERSIZE;
+			savebuffer = Z_Malloc(length ? length : 1, PU_STATIC, NULL);
+			if (fread(savebuffer, 1, length, f) != length)
+				length = 0;
+			decompressedlen = length;
+			break;
+		case SAVECOMP_LZF:
+		{
+			UINT8 *compressedbuffer;
+
+			length -= SAVEGAMEHEADERSIZE;
+			compressedbuffer = Z_Malloc(length ? length : 1, PU_STATIC, NULL);
+			savebuffer = Z_Malloc(decompressedlen ? decompressedlen : 1, PU_STATIC, NULL);
+			if (fread(compressedbuffer, 1, length, f) != length
+				|| lzf_decompress(compressedbuffer, length, savebuffer, decompressedlen) != decompressedlen)
+				decompressedlen = 0;
+			Z_Free(compressedbuffer);
+			break;
+		}
+#ifdef HAVE_ZLIB
+		case SAVECOMP_DEFLATE:
+			savebuffer = Z_Malloc(decompressedlen ? decompressedlen : 1, PU_STATIC, NULL);
+			if (!CL_InflateSaveGame(f, savebuffer, decompressedlen))
+				decompressedlen = 0;
+			break;
+#endif
+		default:
+			decompressedlen = 0;
+			break;
+	}
+	fclose(f);
+
+	if (!decompressedlen)
 	{
-		UINT8 *decompressedbuffer = Z_Malloc(decompressedlen, PU_STATIC, NULL);
-		lzf_decompress(save_p, length - sizeof(UINT32), decompressedbuffer, decompressedlen);
-		Z_Free(savebuffer);
-		save_p = savebuffer = decompressedbuffer;
+		I_Error("Can't read savegame sent");
+		return;
 	}
 
+	save_p = savebuffer;
+
 	paused = false;
 	demoplayback = false;
 	titlemapinaction = TITLEMAP_OFF;
@@ -4169,6 +4417,8 @@ static void HandleConnect(SINT8 node)
 	{
 #ifndef NONET
 		boolean newnode = false;
+		// Read now; sending the server config reuses the packet buffer.
+		boolean caninflate = netbuffer->u.clientcfg.caninflate != 0;
 #endif
 
 		for (i = 0; i < netbuffer->u.clientcfg.localplayers - playerpernode[node]; i++)
@@ -4218,7 +4468,7 @@ static void HandleConnect(SINT8 node)
 		{
 			if ((gamestate == GS_LEVEL || gamestate == GS_INTERMISSION) && newnode)
 			{
-				SV_SendSaveGame(node); // send a complete game state
+				SV_SendSaveGame(node, caninflate); // send a complete game state
 				DEBFILE("send savegame\n");
 			}
 			SV_AddWaitingPlayers(names[0], names[1]);
@@ -4608,29 +4858,58 @@ static void HandlePacketFromPlayer(SINT8 node)
 				break;
 			}
 			// Check player consistancy during the level
-			if (realstart <= gametic && realstart > gametic - BACKUPTICS+1 && gamestate == GS_LEVEL
-				&& consistancy[realstart%BACKUPTICS] != SHORT(netbuffer->u.clientpak.consistancy))
+			if (realstart <= gametic && realstart > gametic - BACKUPTICS+1 && gamestate == GS_LEVEL)
 			{
+				UINT32 ours = consistancy[realstart%BACKUPTICS];
+				UINT32 theirs = (UINT32)LONG(netbuffer->u.clientpak.consistancy);
+				UINT32 diff = ours ^ theirs;
+				char parts[64] = "";
+				INT32 part;
+
+				// The rest of the world can't be resynched, so just say what differs.
+				// A player who just joined won't agree on it until everything's been rehashed.
+				if ((diff & ~synchpartmask[SYNCH_PLAYERS]) && realstart >= resynch_worldcheck[node])
+				{
+					for (part = SYNCH_PLAYERS+1; part < NUMSYNCHPARTS; part++)
+						if (diff & synchpartmask[part])
+						{
+							if (parts[0])
+								strlcat(parts, ", ", sizeof parts);
+							strlcat(parts, synchpartnames[part], sizeof parts);
+						}
+
+					if (cv_blamecfail.value)
+						CONS_Printf(M_GetText("Player %d (%s) is out of synch in %s; expected %08x, got %08x\n"),
+							netconsole+1, player_names[netconsole], parts, ours, theirs);
+					DEBFILE(va("player %d out of synch in %s [%u] %08x!=%08x\n",
+						netconsole, parts, realstart, ours, theirs));
+					resynch_worldcheck[node] = gametic + TICRATE; // don't flood
+				}
+
+				if (!(diff & synchpartmask[SYNCH_PLAYERS]))
+				{
+					if (resynch_score[node])
+						--resynch_score[node];
+					break;
+				}
+
 				SV_RequireResynch(node);
 
 				if (cv_resynchattempts.value && resynch_score[node] <= (unsigned)cv_resynchattempts.value*250)
 				{
 					if (cv_blamecfail.value)
-						CONS_Printf(M_GetText("Synch failure for player %d (%s); expected %hd, got %hd\n"),
+						CONS_Printf(M_GetText("Synch failure for player %d (%s); expected %04x, got %04x\n"),
 							netconsole+1, player_names[netconsole],
-							consistancy[realstart%BACKUPTICS],
-							SHORT(netbuffer->u.clientpak.consistancy));
-					DEBFILE(va("Restoring player %d (synch failure) [%update] %d!=%d\n",
-						netconsole, realstart, consistancy[realstart%BACKUPTICS],
-						SHORT(netbuffer->u.clientpak.consistancy)));
+							ours & synchpartmask[SYNCH_PLAYERS], theirs & synchpartmask[SYNCH_PLAYERS]);
+					DEBFILE(va("Restoring player %d (synch failure) [%update] %08x!=%08x\n",
+						netconsole, realstart, ours, theirs));
 					break;
 				}
 				else
 				{
 					SendKick(netconsole, KICK_MSG_CON_FAIL | KICK_MSG_KEEP_BODY);
-					DEBFILE(va("player %d kicked (synch failure) [%u] %d!=%d\n",
-						netconsole, realstart, consistancy[realstart%BACKUPTICS],
-						SHORT(netbuffer->u.clientpak.consistancy)));
+					DEBFILE(va("player %d kicked (synch failure) [%u] %08x!=%08x\n",
+						netconsole, realstart, ours, theirs));
 					break;
 				}
 			}
@@ -4976,14 +5255,28 @@ static void GetPackets(void)
 // no more use random generator, because at very first tic isn't yet synchronized
 // Note: It is called consistAncy on purpose.
 //
-static INT16 Consistancy(void)
+static UINT32 FoldSynchHash(UINT32 h, synchpart_t part)
+{
+	UINT32 mask = synchpartmask[part];
+	UINT32 ret = 0;
+	INT32 shift = 0, bits = 0;
+
+	while (!(mask & 1))
+		mask >>= 1, shift++;
+	while (mask & 1)
+		mask >>= 1, bits++;
+
+	// Fold the whole hash down into the bits the part has
+	for (; h; h >>= bits)
+		ret ^= h & ((1u << bits) - 1);
+	return ret << shift;
+}
+
+static UINT32 Consistancy(void)
 {
 	INT32 i;
 	UINT32 ret = 0;
-#ifdef MOBJCONSISTANCY
-	thinker_t *th;
-	mobj_t *mo;
-#endif
+	UINT32 mobjs = 0, sectorhash = 0, polyobjs = 0;
 
 	DEBFILE(va("TIC %u ", gametic));
 
@@ -5005,78 +5298,22 @@ static INT16 Consistancy(void)
 	if (!G_PlatformGametype())
 		ret += P_GetRandSeed();
 
-#ifdef MOBJCONSISTANCY
-	for (th = thlist[THINK_MOBJ].next; th != &thlist[THINK_MOBJ]; th = th->next)
+	if (gamestate == GS_LEVEL)
 	{
-		if (th->function.acp1 == (actionf_p1)P_RemoveThinkerDelayed)
-			continue;
-
-		mo = (mobj_t *)th;
-
-		if (mo->flags & (MF_SPECIAL | MF_SOLID | MF_PUSHABLE | MF_BOSS | MF_MISSILE | MF_SPRING | MF_MONITOR | MF_FIRE | MF_ENEMY | MF_PAIN | MF_STICKY))
-		{
-			ret -= mo->type;
-			ret += mo->x;
-			ret -= mo->y;
-			ret += mo->z;
-			ret -= mo->momx;
-			ret += mo->momy;
-			ret -= mo->momz;
-			ret += mo->angle;
-			ret -= mo->flags;
-			ret += mo->flags2;
-			ret -= mo->eflags;
-			if (mo->target)
-			{
-				ret += mo->target->type;
-				ret -= mo->target->x;
-				ret += mo->target->y;
-				ret -= mo->target->z;
-				ret += mo->target->momx;
-				ret -= mo->target->momy;
-				ret += mo->target->momz;
-				ret -= mo->target->angle;
-				ret += mo->target->flags;
-				ret -= mo->target->flags2;
-				ret += mo->target->eflags;
-				ret -= mo->target->state - states;
-				ret += mo->target->tics;
-				ret -= mo->target->sprite;
-				ret += mo->target->frame;
-			}
-			else
-				ret ^= 0x3333;
-			if (mo->tracer && mo->tracer->type != MT_OVERLAY)
-			{
-				ret += mo->tracer->type;
-				ret -= mo->tracer->x;
-				ret += mo->tracer->y;
-				ret -= mo->tracer->z;
-				ret += mo->tracer->momx;
-				ret -= mo->tracer->momy;
-				ret += mo->tracer->momz;
-				ret -= mo->tracer->angle;
-				ret += mo->tracer->flags;
-				ret -= mo->tracer->flags2;
-				ret += mo->tracer->eflags;
-				ret -= mo->tracer->state - states;
-				ret += mo->tracer->tics;
-				ret -= mo->tracer->sprite;
-				ret += mo->tracer->frame;
-			}
-			else
-				ret ^= 0xAAAA;
-			ret -= mo->state - states;
-			ret += mo->tics;
-			ret -= mo->sprite;
-			ret += mo->frame;
-		}
+		if (!G_PlatformGametype())
+			mobjs = synch_mobjhash;
+		sectorhash = synch_sectorhash;
+		polyobjs = P_PolyobjSynchHash();
 	}
-#endif
 
-	DEBFILE(va("Consistancy = %u\n", (ret & 0xFFFF)));
+	ret = FoldSynchHash(ret, SYNCH_PLAYERS)
+		| FoldSynchHash(mobjs, SYNCH_MOBJS)
+		| FoldSynchHash(sectorhash, SYNCH_SECTORS)
+		| FoldSynchHash(polyobjs, SYNCH_POLYOBJS);
+
+	DEBFILE(va("Consistancy = %08x\n", ret));
 
-	return (INT16)(ret & 0xFFFF);
+	return ret;
 }
 
 // send the client packet to the server
@@ -5095,13 +5332,13 @@ static void CL_SendClientCmd(void)
 	{
 		// Send PT_NODEKEEPALIVE packet
 		netbuffer->packettype += 4;
-		packetsize = sizeof (clientcmd_pak) - sizeof (ticcmd_t) - sizeof (INT16);
+		packetsize = sizeof (clientcmd_pak) - sizeof (ticcmd_t) - sizeof (UINT32);
 		HSendPacket(servernode, false, 0, packetsize);
 	}
 	else if (gamestate != GS_NULL && (addedtogame || dedicated))
 	{
 		G_MoveTiccmd(&netbuffer->u.clientpak.cmd, &localcmds, 1);
-		netbuffer->u.clientpak.consistancy = SHORT(consistancy[gametic%BACKUPTICS]);
+		netbuffer->u.clientpak.consistancy = LONG(consistancy[gametic%BACKUPTICS]);
 
 		// Send a special packet with 2 cmd for splitscreen
 		if (splitscreen || botingame)
@@ -24,7 +24,7 @@ The 'packet version' is used to distinguish packet formats.
 This version is independent of VERSION and SUBVERSION. Different
 applications may follow different packet versions.
 */
-#define PACKETVERSION 3
+#define PACKETVERSION 4
 
 // Network play related stuff.
 // There is a data struct that stores network
@@ -109,7 +109,7 @@ typedef struct
 {
 	UINT8 client_tic;
 	UINT8 resendfrom;
-	INT16 consistancy;
+	UINT32 consistancy;
 	ticcmd_t cmd;
 } ATTRPACK clientcmd_pak;
 
@@ -119,7 +119,7 @@ typedef struct
 {
 	UINT8 client_tic;
 	UINT8 resendfrom;
-	INT16 consistancy;
+	UINT32 consistancy;
 	ticcmd_t cmd, cmd2;
 } ATTRPACK client2cmd_pak;
 
@@ -366,6 +366,7 @@ typedef struct
 	UINT8 localplayers;
 	UINT8 mode;
 	char names[MAXSPLITSCREENPLAYERS][MAXPLAYERNAME];
+	UINT8 caninflate; // Can take a deflated savegame
 } ATTRPACK clientconfig_pak;
 
 #define MAXSERVERNAME 32
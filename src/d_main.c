@@ -204,6 +204,29 @@ void D_ProcessEvents(void)
 	}
 }
 
+//
+// D_DrawTickStats
+// per-phase P_Ticker timings, see P_GetTickStats
+//
+static void D_DrawTickStats(void)
+{
+	const tickstatsummary_t *summary;
+	size_t count = P_GetTickStats(&summary);
+	char s[50];
+	INT32 i, y = 10;
+
+	snprintf(s, sizeof s, "%s tics   min   avg   max   p99", sizeu1(count));
+	V_DrawRightAlignedThinString(BASEVIDWIDTH - 10, y, V_MONOSPACE | V_YELLOWMAP, s);
+
+	for (i = 0; i < NUMTICKSTATS; i++)
+	{
+		y += 8;
+		snprintf(s, sizeof s, "%-9s %5u %5u %5u %5u", tickstatnames[i],
+			summary[i].min, summary[i].avg, summary[i].max, summary[i].p99);
+		V_DrawRightAlignedThinString(BASEVIDWIDTH - 10, y, V_MONOSPACE | (i == TICKSTAT_TOTAL ? V_YELLOWMAP : 0), s);
+	}
+}
+
 //
 // D_Display
 // draw current display, possibly wiping it from the previous
@@ -668,9 +691,25 @@ static void D_Display(void)
 				V_DrawThinString(30, 60, V_MONOSPACE | V_YELLOWMAP, s);
 				snprintf(s, sizeof s - 1, "fin  %d", rs_swaptime / divisor);
 				V_DrawThinString(30, 70, V_MONOSPACE | V_YELLOWMAP, s);
+#ifdef THREADEDRENDER
+				if (rs_sw_numthreads > 1) // per-thread drawing times
+				{
+					INT32 i;
+					snprintf(s, sizeof s - 1, "drw  %d", rs_sw_drawtime / divisor);
+					V_DrawThinString(30, 80, V_MONOSPACE | V_YELLOWMAP, s);
+					for (i = 0; i < rs_sw_numthreads; i++)
+					{
+						snprintf(s, sizeof s - 1, "t%-2d %d", i, rs_sw_threadtime[i] / divisor);
+						V_DrawThinString(80 + (i / 8)*50, 55 + (i % 8)*10, V_MONOSPACE | V_REDMAP, s);
+					}
+				}
+#endif
 			}
 		}
 
+		if (cv_tickstats.value)
+			D_DrawTickStats();
+
 		rs_swaptime = I_GetTimeMicros();
 		I_FinishUpdate(); // page flip or blit buffer
 		rs_swaptime = I_GetTimeMicros() - rs_swaptime;
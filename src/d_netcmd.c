@@ -478,8 +478,18 @@ void D_RegisterServerCommands(void)
 
 	COM_AddCommand("addfile", Command_Addfile);
 	COM_AddCommand("listwad", Command_ListWADS_f);
+#ifdef DEVELOP
+	COM_AddCommand("lumpbench", Command_Lumpbench_f);
+#endif
 
 	COM_AddCommand("runsoc", Command_RunSOC);
+	COM_AddCommand("luaprofile", Command_Luaprofile_f);
+	COM_AddCommand("tickstatsdump", Command_Tickstats_f);
+	COM_AddCommand("thinkerstats", Command_Thinkerstats_f);
+#ifdef DEVELOP
+	COM_AddCommand("textmapbench", Command_Textmapbench_f);
+#endif
+	CV_RegisterVar(&cv_tickstats);
 	COM_AddCommand("pause", Command_Pause);
 	COM_AddCommand("suicide", Command_Suicide);
 
@@ -11181,6 +11181,16 @@ const char *LUA_GetActionName(void *action)
 	return NULL;
 }
 
+// Gets the name of a mobj type, without MT_, including freeslots.
+const char *DEH_GetMobjTypeName(INT32 type)
+{
+	if (type >= 0 && type < MT_FIRSTFREESLOT)
+		return MOBJTYPE_LIST[type] + 3;
+	if (type >= MT_FIRSTFREESLOT && type <= MT_LASTFREESLOT)
+		return FREE_MOBJS[type - MT_FIRSTFREESLOT];
+	return NULL;
+}
+
 void LUA_SetActionByName(void *state, const char *actiontocompare)
 {
 	state_t *st = (state_t *)state;
@@ -31,6 +31,7 @@ void DEH_LoadDehackedLump(lumpnum_t lumpnum);
 void DEH_LoadDehackedLumpPwad(UINT16 wad, UINT16 lump, boolean mainfile);
 
 void DEH_Check(void);
+const char *DEH_GetMobjTypeName(INT32 type);
 
 fixed_t get_number(const char *word);
 
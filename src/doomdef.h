@@ -657,4 +657,14 @@ extern const char *compdate, *comptime, *comprevision, *compbranch;
 /// Render flats on walls
 #define WALLFLATS
 
+/// Spread software drawing over worker threads (see the renderthreads cvar).
+/// \note	The drawer state has to be thread-local for this, which the
+///      	assembly drawers know nothing about.
+#if defined (HAVE_THREADS) && defined (ATTRTHREADLOCAL) && !defined (USEASM)
+#define THREADEDRENDER
+#define RENDERLOCAL ATTRTHREADLOCAL
+#else
+#define RENDERLOCAL
+#endif
+
 #endif // __DOOMDEF__
@@ -801,3 +801,62 @@ boolean preparefilemenu(boolean samedepth)
 
 	return true;
 }
+
+typedef struct
+{
+	char *name;
+	time_t mtime;
+} trimfile_t;
+
+static int trimfilecmp(const void *a, const void *b)
+{
+	const trimfile_t *fa = a, *fb = b;
+	return (fa->mtime < fb->mtime) - (fa->mtime > fb->mtime); // newest first
+}
+
+void trimfolder(const char *path, size_t keep)
+{
+	DIR *dirhandle;
+	struct dirent *dent;
+	struct stat fsstat;
+	trimfile_t *files = NULL, *newfiles;
+	size_t numfiles = 0, maxfiles = 0, i;
+	char filepath[1024];
+
+	if (!(dirhandle = opendir(path)))
+		return;
+
+	while ((dent = readdir(dirhandle)) != NULL)
+	{
+		snprintf(filepath, sizeof filepath, "%s" PATHSEP "%s", path, dent->d_name);
+		if (stat(filepath, &fsstat) < 0 || S_ISDIR(fsstat.st_mode))
+			continue;
+
+		if (numfiles == maxfiles)
+		{
+			maxfiles = maxfiles ? maxfiles*2 : 64;
+			if (!(newfiles = realloc(files, maxfiles * sizeof *files)))
+				break;
+			files = newfiles;
+		}
+		if (!(files[numfiles].name = strdup(dent->d_name)))
+			break;
+		files[numfiles++].mtime = fsstat.st_mtime;
+	}
+
+	closedir(dirhandle);
+
+	if (numfiles > keep)
+	{
+		qsort(files, numfiles, sizeof *files, trimfilecmp);
+		for (i = keep; i < numfiles; i++)
+		{
+			snprintf(filepath, sizeof filepath, "%s" PATHSEP "%s", path, files[i].name);
+			remove(filepath);
+		}
+	}
+
+	for (i = 0; i < numfiles; i++)
+		free(files[i].name);
+	free(files);
+}
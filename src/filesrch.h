@@ -95,4 +95,14 @@ void closefilemenu(boolean validsize);
 void searchfilemenu(char *tempname);
 boolean preparefilemenu(boolean samedepth);
 
+/**	\brief	Deletes the oldest files in a folder, so that it doesn't grow forever
+
+	\param	path	the folder
+	\param	keep	how many of the newest files to leave
+
+	\return	void
+*/
+
+void trimfolder(const char *path, size_t keep);
+
 #endif // __FILESRCH_H__
@@ -0,0 +1,63 @@
+// SONIC ROBO BLAST 2
+//-----------------------------------------------------------------------------
+// Copyright (C) 2020 by Sonic Team Junior.
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  i_threads.h
+/// \brief Worker threads for splitting up heavy, self-contained work
+
+#ifndef __I_THREADS__
+#define __I_THREADS__
+
+#include "doomtype.h"
+
+/**	\brief	A unit of work for I_RunJobs.
+
+	\param	userdata	whatever was passed to I_RunJobs
+	\param	job	which job to do, from 0 to count-1
+	\param	thread	which thread is doing it, from 0 to the number of threads-1;
+		handy for per-thread scratch space
+
+	Jobs may run at the same time as each other, so they must not touch
+	zone memory (Z_Malloc and friends), the console, or anything else that
+	isn't thread-safe. Plain malloc/free are fine.
+*/
+typedef void (*I_job_fn)(void *userdata, size_t job, INT32 thread);
+
+#ifdef HAVE_THREADS
+
+/**	\brief	How many threads I_RunJobs can use at most (the number of CPUs)
+*/
+INT32 I_NumJobThreads(void);
+
+/**	\brief	Runs job(userdata, i, thread) for every i below count, spread over
+	up to maxthreads threads (including the calling one), and returns once
+	all of them are done. maxthreads <= 0 means one per CPU.
+
+	The other threads are kept around between calls. A call made while
+	another is still running, such as from inside a job, does all of its
+	jobs on the calling thread.
+*/
+void I_RunJobs(I_job_fn job, void *userdata, size_t count, INT32 maxthreads);
+
+#else
+
+FUNCINLINE static ATTRINLINE INT32 I_NumJobThreads(void)
+{
+	return 1;
+}
+
+FUNCINLINE static ATTRINLINE void I_RunJobs(I_job_fn job, void *userdata, size_t count, INT32 maxthreads)
+{
+	size_t i;
+	(void)maxthreads;
+	for (i = 0; i < count; i++)
+		job(userdata, i, 0);
+}
+
+#endif
+
+#endif
@@ -64,6 +64,22 @@ enum hook {
 };
 extern const char *const hookNames[];
 
+// Time spent in one hook function, see the luaprofile command
+typedef struct luaprofile_s
+{
+	struct luaprofile_s *next;
+	char *hook; // which hook
+	char *source; // where the function was added, as "file:line"
+	UINT32 calls;
+	UINT64 total; // microseconds, including any hooks it set off
+	UINT32 peak; // microseconds
+} luaprofile_t;
+
+extern boolean luaprofiling;
+
+void LUA_ProfileCall(luaprofile_t *prof, UINT32 time);
+void Command_Luaprofile_f(void);
+
 void LUAh_MapChange(INT16 mapnumber); // Hook for map change (before load)
 void LUAh_MapLoad(void); // Hook for map load
 void LUAh_PlayerJoin(int playernum); // Hook for Got_AddPlayer
@@ -22,6 +22,9 @@
 #include "lua_libs.h"
 #include "lua_hook.h"
 #include "lua_hud.h" // hud_running errors
+#include "i_system.h" // I_GetTimeMicros
+#include "d_main.h" // srb2home
+#include "command.h"
 
 static UINT8 hooksAvailable[(hook_MAX/8)+1];
 
@@ -85,29 +88,20 @@ struct hook_s
 		char *str;
 	} s;
 	boolean error;
+	luaprofile_t *profile;
 };
 typedef struct hook_s* hook_p;
 
 #define FMT_HOOKID "hook_%d"
 
-// For each mobj type, a linked list to its thinker and collision hooks.
-// That way, we don't have to iterate through all the hooks.
-// We could do that with all other mobj hooks, but it would probably just be
-// a waste of memory since they are only called occasionally. Probably...
-static hook_p mobjthinkerhooks[NUMMOBJTYPES];
-static hook_p mobjcollidehooks[NUMMOBJTYPES];
+// For each hook that takes a mobj type, a table of linked lists, one for
+// each mobj type (MT_NULL for the hooks that run for every type).
+// That way, calling a hook only ever goes through the functions that were
+// added for it. The tables are only allocated once a hook is added.
+static hook_p *mobjhooks[hook_MAX];
 
-// For each mobj type, a linked list for other mobj hooks
-static hook_p mobjhooks[NUMMOBJTYPES];
-
-// A linked list for player hooks
-static hook_p playerhooks;
-
-// A linked list for linedef executor hooks
-static hook_p linedefexecutorhooks;
-
-// For other hooks, a unique linked list
-hook_p roothook;
+// For all other hooks, a linked list per hook
+static hook_p hooklists[hook_MAX];
 
 static void PushHook(lua_State *L, hook_p hookp)
 {
@@ -115,10 +109,178 @@ static void PushHook(lua_State *L, hook_p hookp)
 	lua_gettable(L, LUA_REGISTRYINDEX);
 }
 
+// ==========================================================================
+// Profiling
+// ==========================================================================
+
+boolean luaprofiling = false;
+static luaprofile_t *luaprofiles = NULL;
+
+/** Makes a profile entry for a hook function that's being added.
+  *
+  * \param L The Lua state, inside the addHook (or similar) call.
+  * \param hook The name of the hook; it is copied.
+  * \return The new entry.
+  */
+luaprofile_t *LUA_NewProfile(lua_State *L, const char *hook)
+{
+	luaprofile_t *prof = ZZ_Calloc(sizeof (*prof));
+	lua_Debug ar;
+
+	prof->hook = Z_StrDup(hook);
+	if (lua_getstack(L, 1, &ar) && lua_getinfo(L, "Sl", &ar))
+		prof->source = Z_StrDup(va("%s:%d", ar.short_src, ar.currentline));
+	else
+		prof->source = Z_StrDup("?");
+
+	prof->next = luaprofiles;
+	luaprofiles = prof;
+	return prof;
+}
+
+/** Adds one call to a profile entry.
+  *
+  * \param prof The entry.
+  * \param time How long the call took, in microseconds.
+  */
+void LUA_ProfileCall(luaprofile_t *prof, UINT32 time)
+{
+	prof->calls++;
+	prof->total += time;
+	if (time > prof->peak)
+		prof->peak = time;
+}
+
+// Calls a hook with the error handler at stack index 1, timing it if need be.
+static int CallHook(hook_p hookp, int nargs, int nresults)
+{
+	int start, err;
+
+	if (!luaprofiling)
+		return lua_pcall(gL, nargs, nresults, 1);
+
+	start = I_GetTimeMicros();
+	err = lua_pcall(gL, nargs, nresults, 1);
+	LUA_ProfileCall(hookp->profile, (UINT32)(I_GetTimeMicros() - start));
+	return err;
+}
+
+static int CompareProfiles(const void *a, const void *b)
+{
+	const luaprofile_t *pa = *(const luaprofile_t *const *)a;
+	const luaprofile_t *pb = *(const luaprofile_t *const *)b;
+
+	if (pa->total != pb->total)
+		return (pa->total < pb->total) ? 1 : -1;
+	return (pa->calls < pb->calls) - (pa->calls > pb->calls);
+}
+
+// Gets every profile entry, busiest first. Free the result with Z_Free.
+static luaprofile_t **SortedProfiles(size_t *count)
+{
+	luaprofile_t *prof, **list;
+	size_t n = 0;
+
+	for (prof = luaprofiles; prof; prof = prof->next)
+		n++;
+
+	list = Z_Malloc((n ? n : 1) * sizeof (*list), PU_STATIC, NULL);
+	n = 0;
+	for (prof = luaprofiles; prof; prof = prof->next)
+		list[n++] = prof;
+	qsort(list, n, sizeof (*list), CompareProfiles);
+
+	*count = n;
+	return list;
+}
+
+static void WriteProfileCSV(const char *filename)
+{
+	luaprofile_t **list;
+	size_t i, count;
+	FILE *f = fopen(filename, "w");
+
+	if (!f)
+	{
+		CONS_Alert(CONS_ERROR, M_GetText("Couldn't write %s\n"), filename);
+		return;
+	}
+
+	list = SortedProfiles(&count);
+	fprintf(f, "hook,source,calls,total_us,average_us,peak_us\n");
+	for (i = 0; i < count; i++)
+		fprintf(f, "%s,\"%s\",%u,%s,%u,%u\n", list[i]->hook, list[i]->source, list[i]->calls,
+			sizeu1((size_t)list[i]->total),
+			list[i]->calls ? (UINT32)(list[i]->total / list[i]->calls) : 0, list[i]->peak);
+	fclose(f);
+	Z_Free(list);
+
+	CONS_Printf(M_GetText("Wrote %s\n"), filename);
+}
+
+/** Console command for the Lua hook profiler.
+  * With no arguments, shows the hook functions that took the most time.
+  */
+void Command_Luaprofile_f(void)
+{
+	const char *arg = COM_Argv(1);
+	luaprofile_t *prof, **list;
+	size_t i, count, show = 20;
+
+	if (!stricmp(arg, "on"))
+	{
+		luaprofiling = true;
+		CONS_Printf(M_GetText("Lua profiling on.\n"));
+		return;
+	}
+	else if (!stricmp(arg, "off"))
+	{
+		luaprofiling = false;
+		CONS_Printf(M_GetText("Lua profiling off.\n"));
+		return;
+	}
+	else if (!stricmp(arg, "reset"))
+	{
+		for (prof = luaprofiles; prof; prof = prof->next)
+		{
+			prof->calls = prof->peak = 0;
+			prof->total = 0;
+		}
+		return;
+	}
+	else if (!stricmp(arg, "csv"))
+	{
+		WriteProfileCSV(COM_Argc() > 2 ? COM_Argv(2) : va("%s" PATHSEP "luaprofile.csv", srb2home));
+		return;
+	}
+	else if (*arg && !isdigit(*arg))
+	{
+		CONS_Printf(M_GetText("luaprofile [count]: show the slowest Lua hooks\n"
+			"luaprofile on/off: start or stop profiling\n"
+			"luaprofile reset: clear the results\n"
+			"luaprofile csv [file]: write all results to a file\n"));
+		return;
+	}
+
+	if (*arg)
+		show = atoi(arg);
+
+	if (!luaprofiling)
+		CONS_Printf(M_GetText("Lua profiling is off; use \"luaprofile on\" to start it.\n"));
+
+	list = SortedProfiles(&count);
+	CONS_Printf("%-20s %-32s %8s %10s %8s %8s\n", "Hook", "Added at", "Calls", "Total ms", "Avg us", "Peak us");
+	for (i = 0; i < count && i < show && list[i]->calls; i++)
+		CONS_Printf("%-20s %-32s %8u %10s %8u %8u\n", list[i]->hook, list[i]->source, list[i]->calls,
+			sizeu1((size_t)(list[i]->total / 1000)),
+			(UINT32)(list[i]->total / list[i]->calls), list[i]->peak);
+	Z_Free(list);
+}
+
 // Takes hook, function, and additional arguments (mobj type to act on, etc.)
 static int lib_addHook(lua_State *L)
 {
-	static struct hook_s hook = {NULL, 0, 0, {0}, false};
+	static struct hook_s hook = {NULL, 0, 0, {0}, false, NULL};
 	static UINT32 nextid;
 	hook_p hookp, *lastp;
 
@@ -173,25 +335,23 @@ static int lib_addHook(lua_State *L)
 	}
 	lua_settop(L, 1); // lua stack contains only the function now.
 
+	hook.profile = LUA_NewProfile(L, hookNames[hook.type]);
+
 	hooksAvailable[hook.type/8] |= 1<<(hook.type%8);
 
 	// set hook.id to the highest id + 1
 	hook.id = nextid++;
 
-	// Special cases for some hook types (see the comments above mobjthinkerhooks declaration)
+	// Hooks that take a mobj type get a list for each type (see the comments above mobjhooks declaration)
 	switch(hook.type)
 	{
-	case hook_MobjThinker:
-		lastp = &mobjthinkerhooks[hook.s.mt];
-		break;
+	case hook_MobjSpawn:
 	case hook_MobjCollide:
 	case hook_MobjLineCollide:
 	case hook_MobjMoveCollide:
-		lastp = &mobjcollidehooks[hook.s.mt];
-		break;
-	case hook_MobjSpawn:
 	case hook_TouchSpecial:
 	case hook_MobjFuse:
+	case hook_MobjThinker:
 	case hook_BossThinker:
 	case hook_ShouldDamage:
 	case hook_MobjDamage:
@@ -201,27 +361,12 @@ static int lib_addHook(lua_State *L)
 	case hook_MobjMoveBlocked:
 	case hook_MapThingSpawn:
 	case hook_FollowMobj:
-		lastp = &mobjhooks[hook.s.mt];
-		break;
-	case hook_JumpSpecial:
-	case hook_AbilitySpecial:
-	case hook_SpinSpecial:
-	case hook_JumpSpinSpecial:
-	case hook_PlayerSpawn:
-	case hook_PlayerCanDamage:
-	case hook_TeamSwitch:
-	case hook_ViewpointSwitch:
-	case hook_SeenPlayer:
-	case hook_ShieldSpawn:
-	case hook_ShieldSpecial:
-	case hook_PlayerThink:
-		lastp = &playerhooks;
-		break;
-	case hook_LinedefExecute:
-		lastp = &linedefexecutorhooks;
+		if (!mobjhooks[hook.type])
+			mobjhooks[hook.type] = ZZ_Calloc(NUMMOBJTYPES * sizeof (hook_p));
+		lastp = &mobjhooks[hook.type][hook.s.mt];
 		break;
 	default:
-		lastp = &roothook;
+		lastp = &hooklists[hook.type];
 		break;
 	}
 
@@ -245,7 +390,8 @@ static int lib_addHook(lua_State *L)
 int LUA_HookLib(lua_State *L)
 {
 	memset(hooksAvailable,0,sizeof(UINT8[(hook_MAX/8)+1]));
-	roothook = NULL;
+	memset(mobjhooks,0,sizeof(mobjhooks));
+	memset(hooklists,0,sizeof(hooklists));
 	lua_register(L, "addHook", lib_addHook);
 	return 0;
 }
@@ -259,20 +405,21 @@ boolean LUAh_MobjHook(mobj_t *mo, enum hook which)
 
 	I_Assert(mo->type < NUMMOBJTYPES);
 
+	// Nothing to do for this type?
+	if (!mobjhooks[which][MT_NULL] && !mobjhooks[which][mo->type])
+		return false;
+
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic mobj hooks
-	for (hookp = mobjhooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[which][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != which)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 			LUA_PushUserdata(gL, mo, META_MOBJ);
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2);
-		if (lua_pcall(gL, 1, 1, 1)) {
+		if (CallHook(hookp, 1, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -284,16 +431,13 @@ boolean LUAh_MobjHook(mobj_t *mo, enum hook which)
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjhooks[mo->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[which][mo->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != which)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 			LUA_PushUserdata(gL, mo, META_MOBJ);
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2);
-		if (lua_pcall(gL, 1, 1, 1)) {
+		if (CallHook(hookp, 1, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -319,16 +463,13 @@ boolean LUAh_PlayerHook(player_t *plr, enum hook which)
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = playerhooks; hookp; hookp = hookp->next)
+	for (hookp = hooklists[which]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != which)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 			LUA_PushUserdata(gL, plr, META_PLAYER);
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2);
-		if (lua_pcall(gL, 1, 1, 1)) {
+		if (CallHook(hookp, 1, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -355,14 +496,11 @@ void LUAh_MapChange(INT16 mapnumber)
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 	lua_pushinteger(gL, mapnumber);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_MapChange]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_MapChange)
-			continue;
-
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2);
-		if (lua_pcall(gL, 1, 0, 1)) {
+		if (CallHook(hookp, 1, 0)) {
 			CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
 		}
@@ -382,14 +520,11 @@ void LUAh_MapLoad(void)
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 	lua_pushinteger(gL, gamemap);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_MapLoad]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_MapLoad)
-			continue;
-
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2);
-		if (lua_pcall(gL, 1, 0, 1)) {
+		if (CallHook(hookp, 1, 0)) {
 			CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
 		}
@@ -409,14 +544,11 @@ void LUAh_PlayerJoin(int playernum)
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 	lua_pushinteger(gL, playernum);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_PlayerJoin]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_PlayerJoin)
-			continue;
-
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2);
-		if (lua_pcall(gL, 1, 0, 1)) {
+		if (CallHook(hookp, 1, 0)) {
 			CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
 		}
@@ -434,13 +566,10 @@ void LUAh_PreThinkFrame(void)
 
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_PreThinkFrame]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_PreThinkFrame)
-			continue;
-
 		PushHook(gL, hookp);
-		if (lua_pcall(gL, 0, 0, 1)) {
+		if (CallHook(hookp, 0, 0)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -460,13 +589,10 @@ void LUAh_ThinkFrame(void)
 
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_ThinkFrame]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_ThinkFrame)
-			continue;
-
 		PushHook(gL, hookp);
-		if (lua_pcall(gL, 0, 0, 1)) {
+		if (CallHook(hookp, 0, 0)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -486,13 +612,10 @@ void LUAh_PostThinkFrame(void)
 
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_PostThinkFrame]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_PostThinkFrame)
-			continue;
-
 		PushHook(gL, hookp);
-		if (lua_pcall(gL, 0, 0, 1)) {
+		if (CallHook(hookp, 0, 0)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -513,15 +636,16 @@ UINT8 LUAh_MobjCollideHook(mobj_t *thing1, mobj_t *thing2, enum hook which)
 
 	I_Assert(thing1->type < NUMMOBJTYPES);
 
+	// Nothing to do for this type?
+	if (!mobjhooks[which][MT_NULL] && !mobjhooks[which][thing1->type])
+		return 0;
+
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic mobj collision hooks
-	for (hookp = mobjcollidehooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[which][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != which)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, thing1, META_MOBJ);
@@ -530,7 +654,7 @@ UINT8 LUAh_MobjCollideHook(mobj_t *thing1, mobj_t *thing2, enum hook which)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -547,11 +671,8 @@ UINT8 LUAh_MobjCollideHook(mobj_t *thing1, mobj_t *thing2, enum hook which)
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjcollidehooks[thing1->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[which][thing1->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != which)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, thing1, META_MOBJ);
@@ -560,7 +681,7 @@ UINT8 LUAh_MobjCollideHook(mobj_t *thing1, mobj_t *thing2, enum hook which)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -590,15 +711,16 @@ UINT8 LUAh_MobjLineCollideHook(mobj_t *thing, line_t *line, enum hook which)
 
 	I_Assert(thing->type < NUMMOBJTYPES);
 
+	// Nothing to do for this type?
+	if (!mobjhooks[which][MT_NULL] && !mobjhooks[which][thing->type])
+		return 0;
+
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic mobj collision hooks
-	for (hookp = mobjcollidehooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[which][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != which)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, thing, META_MOBJ);
@@ -607,7 +729,7 @@ UINT8 LUAh_MobjLineCollideHook(mobj_t *thing, line_t *line, enum hook which)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -624,11 +746,8 @@ UINT8 LUAh_MobjLineCollideHook(mobj_t *thing, line_t *line, enum hook which)
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjcollidehooks[thing->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[which][thing->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != which)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, thing, META_MOBJ);
@@ -637,7 +756,7 @@ UINT8 LUAh_MobjLineCollideHook(mobj_t *thing, line_t *line, enum hook which)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -668,17 +787,21 @@ boolean LUAh_MobjThinker(mobj_t *mo)
 
 	I_Assert(mo->type < NUMMOBJTYPES);
 
+	// Nothing to do for this type?
+	if (!mobjhooks[hook_MobjThinker][MT_NULL] && !mobjhooks[hook_MobjThinker][mo->type])
+		return false;
+
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic mobj thinker hooks
-	for (hookp = mobjthinkerhooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_MobjThinker][MT_NULL]; hookp; hookp = hookp->next)
 	{
 		if (lua_gettop(gL) == 1)
 			LUA_PushUserdata(gL, mo, META_MOBJ);
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2);
-		if (lua_pcall(gL, 1, 1, 1)) {
+		if (CallHook(hookp, 1, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -690,13 +813,13 @@ boolean LUAh_MobjThinker(mobj_t *mo)
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjthinkerhooks[mo->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_MobjThinker][mo->type]; hookp; hookp = hookp->next)
 	{
 		if (lua_gettop(gL) == 1)
 			LUA_PushUserdata(gL, mo, META_MOBJ);
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2);
-		if (lua_pcall(gL, 1, 1, 1)) {
+		if (CallHook(hookp, 1, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -726,11 +849,8 @@ boolean LUAh_TouchSpecial(mobj_t *special, mobj_t *toucher)
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic touch special hooks
-	for (hookp = mobjhooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_TouchSpecial][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_TouchSpecial)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, special, META_MOBJ);
@@ -739,7 +859,7 @@ boolean LUAh_TouchSpecial(mobj_t *special, mobj_t *toucher)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -751,11 +871,8 @@ boolean LUAh_TouchSpecial(mobj_t *special, mobj_t *toucher)
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjhooks[special->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_TouchSpecial][special->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_TouchSpecial)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, special, META_MOBJ);
@@ -764,7 +881,7 @@ boolean LUAh_TouchSpecial(mobj_t *special, mobj_t *toucher)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -794,11 +911,8 @@ UINT8 LUAh_ShouldDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic should damage hooks
-	for (hookp = mobjhooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_ShouldDamage][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_ShouldDamage)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, target, META_MOBJ);
@@ -813,7 +927,7 @@ UINT8 LUAh_ShouldDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
-		if (lua_pcall(gL, 5, 1, 1)) {
+		if (CallHook(hookp, 5, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -830,10 +944,8 @@ UINT8 LUAh_ShouldDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjhooks[target->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_ShouldDamage][target->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_ShouldDamage)
-			continue;
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, target, META_MOBJ);
@@ -848,7 +960,7 @@ UINT8 LUAh_ShouldDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
-		if (lua_pcall(gL, 5, 1, 1)) {
+		if (CallHook(hookp, 5, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -883,11 +995,8 @@ boolean LUAh_MobjDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic mobj damage hooks
-	for (hookp = mobjhooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_MobjDamage][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_MobjDamage)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, target, META_MOBJ);
@@ -902,7 +1011,7 @@ boolean LUAh_MobjDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
-		if (lua_pcall(gL, 5, 1, 1)) {
+		if (CallHook(hookp, 5, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -914,11 +1023,8 @@ boolean LUAh_MobjDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjhooks[target->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_MobjDamage][target->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_MobjDamage)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, target, META_MOBJ);
@@ -933,7 +1039,7 @@ boolean LUAh_MobjDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
-		if (lua_pcall(gL, 5, 1, 1)) {
+		if (CallHook(hookp, 5, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -963,11 +1069,8 @@ boolean LUAh_MobjDeath(mobj_t *target, mobj_t *inflictor, mobj_t *source, UINT8
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic mobj death hooks
-	for (hookp = mobjhooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_MobjDeath][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_MobjDeath)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, target, META_MOBJ);
@@ -980,7 +1083,7 @@ boolean LUAh_MobjDeath(mobj_t *target, mobj_t *inflictor, mobj_t *source, UINT8
 		lua_pushvalue(gL, -5);
 		lua_pushvalue(gL, -5);
 		lua_pushvalue(gL, -5);
-		if (lua_pcall(gL, 4, 1, 1)) {
+		if (CallHook(hookp, 4, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -992,11 +1095,8 @@ boolean LUAh_MobjDeath(mobj_t *target, mobj_t *inflictor, mobj_t *source, UINT8
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjhooks[target->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_MobjDeath][target->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_MobjDeath)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, target, META_MOBJ);
@@ -1009,7 +1109,7 @@ boolean LUAh_MobjDeath(mobj_t *target, mobj_t *inflictor, mobj_t *source, UINT8
 		lua_pushvalue(gL, -5);
 		lua_pushvalue(gL, -5);
 		lua_pushvalue(gL, -5);
-		if (lua_pcall(gL, 4, 1, 1)) {
+		if (CallHook(hookp, 4, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1036,11 +1136,8 @@ boolean LUAh_BotTiccmd(player_t *bot, ticcmd_t *cmd)
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_BotTiccmd]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_BotTiccmd)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, bot, META_PLAYER);
@@ -1049,7 +1146,7 @@ boolean LUAh_BotTiccmd(player_t *bot, ticcmd_t *cmd)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1076,10 +1173,9 @@ boolean LUAh_BotAI(mobj_t *sonic, mobj_t *tails, ticcmd_t *cmd)
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_BotAI]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_BotAI
-		|| (hookp->s.str && strcmp(hookp->s.str, ((skin_t*)tails->skin)->name)))
+		if (hookp->s.str && strcmp(hookp->s.str, ((skin_t*)tails->skin)->name))
 			continue;
 
 		if (lua_gettop(gL) == 1)
@@ -1090,7 +1186,7 @@ boolean LUAh_BotAI(mobj_t *sonic, mobj_t *tails, ticcmd_t *cmd)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 8, 1)) {
+		if (CallHook(hookp, 2, 8)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1139,11 +1235,8 @@ boolean LUAh_BotRespawn(mobj_t *sonic, mobj_t *tails)
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_BotRespawn]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_BotRespawn)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, sonic, META_MOBJ);
@@ -1152,7 +1245,7 @@ boolean LUAh_BotRespawn(mobj_t *sonic, mobj_t *tails)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1184,7 +1277,7 @@ boolean LUAh_LinedefExecute(line_t *line, mobj_t *mo, sector_t *sector)
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = linedefexecutorhooks; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_LinedefExecute]; hookp; hookp = hookp->next)
 	{
 		if (strcmp(hookp->s.str, line->text))
 			continue;
@@ -1199,7 +1292,7 @@ boolean LUAh_LinedefExecute(line_t *line, mobj_t *mo, sector_t *sector)
 		lua_pushvalue(gL, -4);
 		lua_pushvalue(gL, -4);
 		lua_pushvalue(gL, -4);
-		if (lua_pcall(gL, 3, 0, 1)) {
+		if (CallHook(hookp, 3, 0)) {
 			CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
 		}
@@ -1221,11 +1314,8 @@ boolean LUAh_PlayerMsg(int source, int target, int flags, char *msg)
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_PlayerMsg]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_PlayerMsg)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, &players[source], META_PLAYER); // Source player
@@ -1249,7 +1339,7 @@ boolean LUAh_PlayerMsg(int source, int target, int flags, char *msg)
 		lua_pushvalue(gL, -5);
 		lua_pushvalue(gL, -5);
 		lua_pushvalue(gL, -5);
-		if (lua_pcall(gL, 4, 1, 1)) {
+		if (CallHook(hookp, 4, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1277,10 +1367,9 @@ boolean LUAh_HurtMsg(player_t *player, mobj_t *inflictor, mobj_t *source, UINT8
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_HurtMsg]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_HurtMsg
-		|| (hookp->s.mt && !(inflictor && hookp->s.mt == inflictor->type)))
+		if (hookp->s.mt && !(inflictor && hookp->s.mt == inflictor->type))
 			continue;
 
 		if (lua_gettop(gL) == 1)
@@ -1295,7 +1384,7 @@ boolean LUAh_HurtMsg(player_t *player, mobj_t *inflictor, mobj_t *source, UINT8
 		lua_pushvalue(gL, -5);
 		lua_pushvalue(gL, -5);
 		lua_pushvalue(gL, -5);
-		if (lua_pcall(gL, 4, 1, 1)) {
+		if (CallHook(hookp, 4, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1330,11 +1419,8 @@ void LUAh_NetArchiveHook(lua_CFunction archFunc)
 	lua_pushcclosure(gL, archFunc, 1);
 	// stack: tables, archFunc
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_NetVars]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_NetVars)
-			continue;
-
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -2); // archFunc
 		if (lua_pcall(gL, 1, 0, errorhandlerindex)) {
@@ -1358,11 +1444,8 @@ boolean LUAh_MapThingSpawn(mobj_t *mo, mapthing_t *mthing)
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic mobj map thing spawn hooks
-	for (hookp = mobjhooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_MapThingSpawn][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_MapThingSpawn)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, mo, META_MOBJ);
@@ -1371,7 +1454,7 @@ boolean LUAh_MapThingSpawn(mobj_t *mo, mapthing_t *mthing)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1383,11 +1466,8 @@ boolean LUAh_MapThingSpawn(mobj_t *mo, mapthing_t *mthing)
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjhooks[mo->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_MapThingSpawn][mo->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_MapThingSpawn)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, mo, META_MOBJ);
@@ -1396,7 +1476,7 @@ boolean LUAh_MapThingSpawn(mobj_t *mo, mapthing_t *mthing)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1424,11 +1504,8 @@ boolean LUAh_FollowMobj(player_t *player, mobj_t *mobj)
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
 	// Look for all generic mobj follow item hooks
-	for (hookp = mobjhooks[MT_NULL]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_FollowMobj][MT_NULL]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_FollowMobj)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, player, META_PLAYER);
@@ -1437,7 +1514,7 @@ boolean LUAh_FollowMobj(player_t *player, mobj_t *mobj)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1449,11 +1526,8 @@ boolean LUAh_FollowMobj(player_t *player, mobj_t *mobj)
 		lua_pop(gL, 1);
 	}
 
-	for (hookp = mobjhooks[mobj->type]; hookp; hookp = hookp->next)
+	for (hookp = mobjhooks[hook_FollowMobj][mobj->type]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_FollowMobj)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, player, META_PLAYER);
@@ -1462,7 +1536,7 @@ boolean LUAh_FollowMobj(player_t *player, mobj_t *mobj)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1489,11 +1563,8 @@ UINT8 LUAh_PlayerCanDamage(player_t *player, mobj_t *mobj)
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = playerhooks; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_PlayerCanDamage]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_PlayerCanDamage)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, player, META_PLAYER);
@@ -1502,7 +1573,7 @@ UINT8 LUAh_PlayerCanDamage(player_t *player, mobj_t *mobj)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1532,11 +1603,8 @@ void LUAh_PlayerQuit(player_t *plr, kickreason_t reason)
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_PlayerQuit]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_PlayerQuit)
-			continue;
-
 	    if (lua_gettop(gL) == 1)
 	    {
 	        LUA_PushUserdata(gL, plr, META_PLAYER); // Player that quit
@@ -1545,7 +1613,7 @@ void LUAh_PlayerQuit(player_t *plr, kickreason_t reason)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 0, 1)) {
+		if (CallHook(hookp, 2, 0)) {
 			CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
 		}
@@ -1563,13 +1631,10 @@ void LUAh_IntermissionThinker(void)
 
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_IntermissionThinker]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_IntermissionThinker)
-			continue;
-
 		PushHook(gL, hookp);
-		if (lua_pcall(gL, 0, 0, 1)) {
+		if (CallHook(hookp, 0, 0)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1592,11 +1657,8 @@ boolean LUAh_TeamSwitch(player_t *player, int newteam, boolean fromspectators, b
 	lua_settop(gL, 0);
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = playerhooks; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_TeamSwitch]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_TeamSwitch)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, player, META_PLAYER);
@@ -1611,7 +1673,7 @@ boolean LUAh_TeamSwitch(player_t *player, int newteam, boolean fromspectators, b
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
 		lua_pushvalue(gL, -6);
-		if (lua_pcall(gL, 5, 1, 1)) {
+		if (CallHook(hookp, 5, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1640,11 +1702,8 @@ UINT8 LUAh_ViewpointSwitch(player_t *player, player_t *newdisplayplayer, boolean
 
 	hud_running = true; // local hook
 
-	for (hookp = playerhooks; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_ViewpointSwitch]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_ViewpointSwitch)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, player, META_PLAYER);
@@ -1655,7 +1714,7 @@ UINT8 LUAh_ViewpointSwitch(player_t *player, player_t *newdisplayplayer, boolean
 		lua_pushvalue(gL, -4);
 		lua_pushvalue(gL, -4);
 		lua_pushvalue(gL, -4);
-		if (lua_pcall(gL, 3, 1, 1)) {
+		if (CallHook(hookp, 3, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1693,11 +1752,8 @@ boolean LUAh_SeenPlayer(player_t *player, player_t *seenfriend)
 
 	hud_running = true; // local hook
 
-	for (hookp = playerhooks; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_SeenPlayer]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_SeenPlayer)
-			continue;
-
 		if (lua_gettop(gL) == 1)
 		{
 			LUA_PushUserdata(gL, player, META_PLAYER);
@@ -1706,7 +1762,7 @@ boolean LUAh_SeenPlayer(player_t *player, player_t *seenfriend)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1738,10 +1794,9 @@ boolean LUAh_ShouldJingleContinue(player_t *player, const char *musname)
 
 	hud_running = true; // local hook
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_ShouldJingleContinue]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_ShouldJingleContinue
-			|| (hookp->s.str && strcmp(hookp->s.str, musname)))
+		if (hookp->s.str && strcmp(hookp->s.str, musname))
 			continue;
 
 		if (lua_gettop(gL) == 1)
@@ -1752,7 +1807,7 @@ boolean LUAh_ShouldJingleContinue(player_t *player, const char *musname)
 		PushHook(gL, hookp);
 		lua_pushvalue(gL, -3);
 		lua_pushvalue(gL, -3);
-		if (lua_pcall(gL, 2, 1, 1)) {
+		if (CallHook(hookp, 2, 1)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -1780,13 +1835,10 @@ void LUAh_GameQuit(void)
 
 	lua_pushcfunction(gL, LUA_GetErrorMessage);
 
-	for (hookp = roothook; hookp; hookp = hookp->next)
+	for (hookp = hooklists[hook_GameQuit]; hookp; hookp = hookp->next)
 	{
-		if (hookp->type != hook_GameQuit)
-			continue;
-
 		PushHook(gL, hookp);
-		if (lua_pcall(gL, 0, 0, 1)) {
+		if (CallHook(hookp, 0, 0)) {
 			if (!hookp->error || cv_debug & DBG_LUA)
 				CONS_Alert(CONS_WARNING,"%s\n",lua_tostring(gL, -1));
 			lua_pop(gL, 1);
@@ -27,6 +27,8 @@
 #include "lua_script.h"
 #include "lua_libs.h"
 #include "lua_hud.h"
+#include "lua_hook.h" // luaprofile_t
+#include "i_system.h" // I_GetTimeMicros
 
 #define HUDONLY if (!hud_running) return luaL_error(L, "HUD rendering code should not be called outside of rendering hooks!");
 
@@ -111,6 +113,11 @@ static const char *const hudhook_opt[] = {
 	"title",
 	"titlecard",
 	NULL};
+#define NUMHUDHOOKS (hudhook_titlecard+1)
+
+// Profile entries for each HUD function, in the same order as in their tables
+static luaprofile_t **hudprofiles[NUMHUDHOOKS];
+static size_t numhudprofiles[NUMHUDHOOKS];
 
 // alignment types for v.drawString
 enum align {
@@ -1227,10 +1234,22 @@ static int lib_hudadd(lua_State *L)
 	lua_pushvalue(L, 1);
 	lua_rawseti(L, -2, (int)(lua_objlen(L, -2) + 1));
 
+	hudprofiles[field] = Z_Realloc(hudprofiles[field], (numhudprofiles[field] + 1) * sizeof (*hudprofiles[field]), PU_STATIC, NULL);
+	hudprofiles[field][numhudprofiles[field]++] = LUA_NewProfile(L, va("HUD %s", hudhook_opt[field]));
+
 	hudAvailable |= 1<<field;
 	return 0;
 }
 
+// Counts a call to the HUD function whose table index is at the top of the stack.
+static void LUA_ProfileHUD(enum hudhook field, int start)
+{
+	lua_Integer n = lua_tointeger(gL, -1);
+
+	if (n >= 1 && (size_t)n <= numhudprofiles[field])
+		LUA_ProfileCall(hudprofiles[field][n-1], (UINT32)(I_GetTimeMicros() - start));
+}
+
 static luaL_Reg lib_hud[] = {
 	{"enable", lib_hudenable},
 	{"disable", lib_huddisable},
@@ -1348,10 +1367,13 @@ void LUAh_GameHUD(player_t *stplayr)
 
 	lua_pushnil(gL);
 	while (lua_next(gL, -5) != 0) {
+		int start = luaprofiling ? I_GetTimeMicros() : 0;
 		lua_pushvalue(gL, -5); // graphics library (HUD[1])
 		lua_pushvalue(gL, -5); // stplayr
 		lua_pushvalue(gL, -5); // camera
 		LUA_Call(gL, 3);
+		if (luaprofiling)
+			LUA_ProfileHUD(hudhook_game, start);
 	}
 	lua_pop(gL, -1);
 	hud_running = false;
@@ -1375,8 +1397,11 @@ void LUAh_ScoresHUD(void)
 	lua_remove(gL, -3); // pop HUD
 	lua_pushnil(gL);
 	while (lua_next(gL, -3) != 0) {
+		int start = luaprofiling ? I_GetTimeMicros() : 0;
 		lua_pushvalue(gL, -3); // graphics library (HUD[1])
 		LUA_Call(gL, 1);
+		if (luaprofiling)
+			LUA_ProfileHUD(hudhook_scores, start);
 	}
 	lua_pop(gL, -1);
 	hud_running = false;
@@ -1400,8 +1425,11 @@ void LUAh_TitleHUD(void)
 	lua_remove(gL, -3); // pop HUD
 	lua_pushnil(gL);
 	while (lua_next(gL, -3) != 0) {
+		int start = luaprofiling ? I_GetTimeMicros() : 0;
 		lua_pushvalue(gL, -3); // graphics library (HUD[1])
 		LUA_Call(gL, 1);
+		if (luaprofiling)
+			LUA_ProfileHUD(hudhook_title, start);
 	}
 	lua_pop(gL, -1);
 	hud_running = false;
@@ -1430,11 +1458,14 @@ void LUAh_TitleCardHUD(player_t *stplayr)
 	lua_pushnil(gL);
 
 	while (lua_next(gL, -6) != 0) {
+		int start = luaprofiling ? I_GetTimeMicros() : 0;
 		lua_pushvalue(gL, -6); // graphics library (HUD[1])
 		lua_pushvalue(gL, -6); // stplayr
 		lua_pushvalue(gL, -6); // lt_ticker
 		lua_pushvalue(gL, -6); // lt_endtime
 		LUA_Call(gL, 4);
+		if (luaprofiling)
+			LUA_ProfileHUD(hudhook_titlecard, start);
 	}
 
 	lua_pop(gL, -1);
@@ -1459,8 +1490,11 @@ void LUAh_IntermissionHUD(void)
 	lua_remove(gL, -3); // pop HUD
 	lua_pushnil(gL);
 	while (lua_next(gL, -3) != 0) {
+		int start = luaprofiling ? I_GetTimeMicros() : 0;
 		lua_pushvalue(gL, -3); // graphics library (HUD[1])
 		LUA_Call(gL, 1);
+		if (luaprofiling)
+			LUA_ProfileHUD(hudhook_intermission, start);
 	}
 	lua_pop(gL, -1);
 	hud_running = false;
@@ -484,7 +484,7 @@ static int sectorlines_num(lua_State *L)
 static int sector_get(lua_State *L)
 {
 	sector_t *sector = *((sector_t **)luaL_checkudata(L, 1, META_SECTOR));
-	enum sector_e field = luaL_checkoption(L, 2, sector_opt[0], sector_opt);
+	enum sector_e field = Lua_checkfield(L, 2, sector_opt[0], sector_opt);
 	INT16 i;
 
 	if (!sector)
@@ -570,7 +570,7 @@ static int sector_get(lua_State *L)
 static int sector_set(lua_State *L)
 {
 	sector_t *sector = *((sector_t **)luaL_checkudata(L, 1, META_SECTOR));
-	enum sector_e field = luaL_checkoption(L, 2, sector_opt[0], sector_opt);
+	enum sector_e field = Lua_checkfield(L, 2, sector_opt[0], sector_opt);
 
 	if (!sector)
 		return luaL_error(L, "accessed sector_t doesn't exist anymore.");
@@ -694,7 +694,7 @@ static int subsector_num(lua_State *L)
 static int line_get(lua_State *L)
 {
 	line_t *line = *((line_t **)luaL_checkudata(L, 1, META_LINE));
-	enum line_e field = luaL_checkoption(L, 2, line_opt[0], line_opt);
+	enum line_e field = Lua_checkfield(L, 2, line_opt[0], line_opt);
 
 	if (!line)
 	{
@@ -2117,10 +2117,13 @@ int LUA_MapLib(lua_State *L)
 	lua_pop(L, 1);
 
 	luaL_newmetatable(L, META_SECTOR);
-		lua_pushcfunction(L, sector_get);
-		lua_setfield(L, -2, "__index");
+		Lua_PushFieldTable(L, sector_opt);
+
+		lua_pushvalue(L, -1);
+		lua_pushcclosure(L, sector_get, 1);
+		lua_setfield(L, -3, "__index");
 
-		lua_pushcfunction(L, sector_set);
+		lua_pushcclosure(L, sector_set, 1);
 		lua_setfield(L, -2, "__newindex");
 
 		lua_pushcfunction(L, sector_num);
@@ -2136,7 +2139,8 @@ int LUA_MapLib(lua_State *L)
 	lua_pop(L, 1);
 
 	luaL_newmetatable(L, META_LINE);
-		lua_pushcfunction(L, line_get);
+		Lua_PushFieldTable(L, line_opt);
+		lua_pushcclosure(L, line_get, 1);
 		lua_setfield(L, -2, "__index");
 
 		lua_pushcfunction(L, line_num);
@@ -162,7 +162,7 @@ static const char *const mobj_opt[] = {
 static int mobj_get(lua_State *L)
 {
 	mobj_t *mo = *((mobj_t **)luaL_checkudata(L, 1, META_MOBJ));
-	enum mobj_e field = Lua_optoption(L, 2, NULL, mobj_opt);
+	enum mobj_e field = Lua_optfield(L, 2, NULL, mobj_opt);
 	lua_settop(L, 2);
 
 	INLEVEL
@@ -416,7 +416,7 @@ static int mobj_get(lua_State *L)
 static int mobj_set(lua_State *L)
 {
 	mobj_t *mo = *((mobj_t **)luaL_checkudata(L, 1, META_MOBJ));
-	enum mobj_e field = Lua_optoption(L, 2, mobj_opt[0], mobj_opt);
+	enum mobj_e field = Lua_optfield(L, 2, mobj_opt[0], mobj_opt);
 	lua_settop(L, 3);
 
 	INLEVEL
@@ -490,6 +490,7 @@ static int mobj_set(lua_State *L)
 		mo->radius = luaL_checkfixed(L, 3);
 		if (mo->radius < 0)
 			mo->radius = 0;
+		P_UpdateBlockThing(mo);
 		P_CheckPosition(mo, mo->x, mo->y);
 		mo->floorz = tmfloorz;
 		mo->ceilingz = tmceilingz;
@@ -895,10 +896,13 @@ static int lib_nummapthings(lua_State *L)
 int LUA_MobjLib(lua_State *L)
 {
 	luaL_newmetatable(L, META_MOBJ);
-		lua_pushcfunction(L, mobj_get);
-		lua_setfield(L, -2, "__index");
+		Lua_PushFieldTable(L, mobj_opt);
+
+		lua_pushvalue(L, -1);
+		lua_pushcclosure(L, mobj_get, 1);
+		lua_setfield(L, -3, "__index");
 
-		lua_pushcfunction(L, mobj_set);
+		lua_pushcclosure(L, mobj_set, 1);
 		lua_setfield(L, -2, "__newindex");
 	lua_pop(L,1);
 
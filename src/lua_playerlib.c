@@ -79,298 +79,578 @@ static int lib_lenPlayer(lua_State *L)
 	return 1;
 }
 
+enum player_e
+{
+	player_valid,
+	player_name,
+	player_realmo,
+	player_mo,
+	player_cmd,
+	player_playerstate,
+	player_camerascale,
+	player_shieldscale,
+	player_viewz,
+	player_viewheight,
+	player_deltaviewheight,
+	player_bob,
+	player_viewrollangle,
+	player_aiming,
+	player_drawangle,
+	player_rings,
+	player_spheres,
+	player_pity,
+	player_currentweapon,
+	player_ringweapons,
+	player_ammoremoval,
+	player_ammoremovaltimer,
+	player_ammoremovalweapon,
+	player_powers,
+	player_pflags,
+	player_panim,
+	player_flashcount,
+	player_flashpal,
+	player_skincolor,
+	player_score,
+	player_dashspeed,
+	player_normalspeed,
+	player_runspeed,
+	player_thrustfactor,
+	player_accelstart,
+	player_acceleration,
+	player_charability,
+	player_charability2,
+	player_charflags,
+	player_thokitem,
+	player_spinitem,
+	player_revitem,
+	player_followitem,
+	player_followmobj,
+	player_actionspd,
+	player_mindash,
+	player_maxdash,
+	player_jumpfactor,
+	player_height,
+	player_spinheight,
+	player_lives,
+	player_continues,
+	player_xtralife,
+	player_gotcontinue,
+	player_speed,
+	player_secondjump,
+	player_fly1,
+	player_scoreadd,
+	player_glidetime,
+	player_climbing,
+	player_deadtimer,
+	player_exiting,
+	player_homing,
+	player_dashmode,
+	player_skidtime,
+	player_cmomx,
+	player_cmomy,
+	player_rmomx,
+	player_rmomy,
+	player_numboxes,
+	player_totalring,
+	player_realtime,
+	player_laps,
+	player_ctfteam,
+	player_gotflag,
+	player_weapondelay,
+	player_tossdelay,
+	player_starpostx,
+	player_starposty,
+	player_starpostz,
+	player_starpostnum,
+	player_starposttime,
+	player_starpostangle,
+	player_starpostscale,
+	player_angle_pos,
+	player_old_angle_pos,
+	player_axis1,
+	player_axis2,
+	player_bumpertime,
+	player_flyangle,
+	player_drilltimer,
+	player_linkcount,
+	player_linktimer,
+	player_anotherflyangle,
+	player_nightstime,
+	player_drillmeter,
+	player_drilldelay,
+	player_bonustime,
+	player_capsule,
+	player_drone,
+	player_oldscale,
+	player_mare,
+	player_marelap,
+	player_marebonuslap,
+	player_marebegunat,
+	player_startedtime,
+	player_finishedtime,
+	player_lapbegunat,
+	player_lapstartedtime,
+	player_finishedspheres,
+	player_finishedrings,
+	player_marescore,
+	player_lastmarescore,
+	player_totalmarescore,
+	player_lastmare,
+	player_lastmarelap,
+	player_lastmarebonuslap,
+	player_totalmarelap,
+	player_totalmarebonuslap,
+	player_maxlink,
+	player_texttimer,
+	player_textvar,
+	player_lastsidehit,
+	player_lastlinehit,
+	player_losstime,
+	player_timeshit,
+	player_onconveyor,
+	player_awayviewmobj,
+	player_awayviewtics,
+	player_awayviewaiming,
+	player_spectator,
+	player_outofcoop,
+	player_bot,
+	player_jointime,
+	player_quittime,
+	player_fovadd,
+};
+
+static const char *const player_opt[] = {
+	"valid",
+	"name",
+	"realmo",
+	"mo",
+	"cmd",
+	"playerstate",
+	"camerascale",
+	"shieldscale",
+	"viewz",
+	"viewheight",
+	"deltaviewheight",
+	"bob",
+	"viewrollangle",
+	"aiming",
+	"drawangle",
+	"rings",
+	"spheres",
+	"pity",
+	"currentweapon",
+	"ringweapons",
+	"ammoremoval",
+	"ammoremovaltimer",
+	"ammoremovalweapon",
+	"powers",
+	"pflags",
+	"panim",
+	"flashcount",
+	"flashpal",
+	"skincolor",
+	"score",
+	"dashspeed",
+	"normalspeed",
+	"runspeed",
+	"thrustfactor",
+	"accelstart",
+	"acceleration",
+	"charability",
+	"charability2",
+	"charflags",
+	"thokitem",
+	"spinitem",
+	"revitem",
+	"followitem",
+	"followmobj",
+	"actionspd",
+	"mindash",
+	"maxdash",
+	"jumpfactor",
+	"height",
+	"spinheight",
+	"lives",
+	"continues",
+	"xtralife",
+	"gotcontinue",
+	"speed",
+	"secondjump",
+	"fly1",
+	"scoreadd",
+	"glidetime",
+	"climbing",
+	"deadtimer",
+	"exiting",
+	"homing",
+	"dashmode",
+	"skidtime",
+	"cmomx",
+	"cmomy",
+	"rmomx",
+	"rmomy",
+	"numboxes",
+	"totalring",
+	"realtime",
+	"laps",
+	"ctfteam",
+	"gotflag",
+	"weapondelay",
+	"tossdelay",
+	"starpostx",
+	"starposty",
+	"starpostz",
+	"starpostnum",
+	"starposttime",
+	"starpostangle",
+	"starpostscale",
+	"angle_pos",
+	"old_angle_pos",
+	"axis1",
+	"axis2",
+	"bumpertime",
+	"flyangle",
+	"drilltimer",
+	"linkcount",
+	"linktimer",
+	"anotherflyangle",
+	"nightstime",
+	"drillmeter",
+	"drilldelay",
+	"bonustime",
+	"capsule",
+	"drone",
+	"oldscale",
+	"mare",
+	"marelap",
+	"marebonuslap",
+	"marebegunat",
+	"startedtime",
+	"finishedtime",
+	"lapbegunat",
+	"lapstartedtime",
+	"finishedspheres",
+	"finishedrings",
+	"marescore",
+	"lastmarescore",
+	"totalmarescore",
+	"lastmare",
+	"lastmarelap",
+	"lastmarebonuslap",
+	"totalmarelap",
+	"totalmarebonuslap",
+	"maxlink",
+	"texttimer",
+	"textvar",
+	"lastsidehit",
+	"lastlinehit",
+	"losstime",
+	"timeshit",
+	"onconveyor",
+	"awayviewmobj",
+	"awayviewtics",
+	"awayviewaiming",
+	"spectator",
+	"outofcoop",
+	"bot",
+	"jointime",
+	"quittime",
+	"fovadd",
+	NULL};
+
 static int player_get(lua_State *L)
 {
 	player_t *plr = *((player_t **)luaL_checkudata(L, 1, META_PLAYER));
 	const char *field = luaL_checkstring(L, 2);
+	enum player_e fieldid = Lua_optfield(L, 2, NULL, player_opt);
 
 	if (!plr) {
-		if (fastcmp(field,"valid")) {
+		if (fieldid == player_valid) {
 			lua_pushboolean(L, false);
 			return 1;
 		}
 		return LUA_ErrInvalid(L, "player_t");
 	}
 
-	if (fastcmp(field,"valid"))
+	if (fieldid == player_valid)
 		lua_pushboolean(L, true);
-	else if (fastcmp(field,"name"))
+	else if (fieldid == player_name)
 		lua_pushstring(L, player_names[plr-players]);
-	else if (fastcmp(field,"realmo"))
+	else if (fieldid == player_realmo)
 		LUA_PushUserdata(L, plr->mo, META_MOBJ);
 	// Kept for backward-compatibility
 	// Should be fixed to work like "realmo" later
-	else if (fastcmp(field,"mo"))
+	else if (fieldid == player_mo)
 	{
 		if (plr->spectator)
 			lua_pushnil(L);
 		else
 			LUA_PushUserdata(L, plr->mo, META_MOBJ);
 	}
-	else if (fastcmp(field,"cmd"))
+	else if (fieldid == player_cmd)
 		LUA_PushUserdata(L, &plr->cmd, META_TICCMD);
-	else if (fastcmp(field,"playerstate"))
+	else if (fieldid == player_playerstate)
 		lua_pushinteger(L, plr->playerstate);
-	else if (fastcmp(field,"camerascale"))
+	else if (fieldid == player_camerascale)
 		lua_pushfixed(L, plr->camerascale);
-	else if (fastcmp(field,"shieldscale"))
+	else if (fieldid == player_shieldscale)
 		lua_pushfixed(L, plr->shieldscale);
-	else if (fastcmp(field,"viewz"))
+	else if (fieldid == player_viewz)
 		lua_pushfixed(L, plr->viewz);
-	else if (fastcmp(field,"viewheight"))
+	else if (fieldid == player_viewheight)
 		lua_pushfixed(L, plr->viewheight);
-	else if (fastcmp(field,"deltaviewheight"))
+	else if (fieldid == player_deltaviewheight)
 		lua_pushfixed(L, plr->deltaviewheight);
-	else if (fastcmp(field,"bob"))
+	else if (fieldid == player_bob)
 		lua_pushfixed(L, plr->bob);
-	else if (fastcmp(field,"viewrollangle"))
+	else if (fieldid == player_viewrollangle)
 		lua_pushangle(L, plr->viewrollangle);
-	else if (fastcmp(field,"aiming"))
+	else if (fieldid == player_aiming)
 		lua_pushangle(L, plr->aiming);
-	else if (fastcmp(field,"drawangle"))
+	else if (fieldid == player_drawangle)
 		lua_pushangle(L, plr->drawangle);
-	else if (fastcmp(field,"rings"))
+	else if (fieldid == player_rings)
 		lua_pushinteger(L, plr->rings);
-	else if (fastcmp(field,"spheres"))
+	else if (fieldid == player_spheres)
 		lua_pushinteger(L, plr->spheres);
-	else if (fastcmp(field,"pity"))
+	else if (fieldid == player_pity)
 		lua_pushinteger(L, plr->pity);
-	else if (fastcmp(field,"currentweapon"))
+	else if (fieldid == player_currentweapon)
 		lua_pushinteger(L, plr->currentweapon);
-	else if (fastcmp(field,"ringweapons"))
+	else if (fieldid == player_ringweapons)
 		lua_pushinteger(L, plr->ringweapons);
-	else if (fastcmp(field,"ammoremoval"))
+	else if (fieldid == player_ammoremoval)
 		lua_pushinteger(L, plr->ammoremoval);
-	else if (fastcmp(field,"ammoremovaltimer"))
+	else if (fieldid == player_ammoremovaltimer)
 		lua_pushinteger(L, plr->ammoremovaltimer);
-	else if (fastcmp(field,"ammoremovalweapon"))
+	else if (fieldid == player_ammoremovalweapon)
 		lua_pushinteger(L, plr->ammoremovalweapon);
-	else if (fastcmp(field,"powers"))
+	else if (fieldid == player_powers)
 		LUA_PushUserdata(L, plr->powers, META_POWERS);
-	else if (fastcmp(field,"pflags"))
+	else if (fieldid == player_pflags)
 		lua_pushinteger(L, plr->pflags);
-	else if (fastcmp(field,"panim"))
+	else if (fieldid == player_panim)
 		lua_pushinteger(L, plr->panim);
-	else if (fastcmp(field,"flashcount"))
+	else if (fieldid == player_flashcount)
 		lua_pushinteger(L, plr->flashcount);
-	else if (fastcmp(field,"flashpal"))
+	else if (fieldid == player_flashpal)
 		lua_pushinteger(L, plr->flashpal);
-	else if (fastcmp(field,"skincolor"))
+	else if (fieldid == player_skincolor)
 		lua_pushinteger(L, plr->skincolor);
-	else if (fastcmp(field,"score"))
+	else if (fieldid == player_score)
 		lua_pushinteger(L, plr->score);
-	else if (fastcmp(field,"dashspeed"))
+	else if (fieldid == player_dashspeed)
 		lua_pushfixed(L, plr->dashspeed);
-	else if (fastcmp(field,"normalspeed"))
+	else if (fieldid == player_normalspeed)
 		lua_pushfixed(L, plr->normalspeed);
-	else if (fastcmp(field,"runspeed"))
+	else if (fieldid == player_runspeed)
 		lua_pushfixed(L, plr->runspeed);
-	else if (fastcmp(field,"thrustfactor"))
+	else if (fieldid == player_thrustfactor)
 		lua_pushinteger(L, plr->thrustfactor);
-	else if (fastcmp(field,"accelstart"))
+	else if (fieldid == player_accelstart)
 		lua_pushinteger(L, plr->accelstart);
-	else if (fastcmp(field,"acceleration"))
+	else if (fieldid == player_acceleration)
 		lua_pushinteger(L, plr->acceleration);
-	else if (fastcmp(field,"charability"))
+	else if (fieldid == player_charability)
 		lua_pushinteger(L, plr->charability);
-	else if (fastcmp(field,"charability2"))
+	else if (fieldid == player_charability2)
 		lua_pushinteger(L, plr->charability2);
-	else if (fastcmp(field,"charflags"))
+	else if (fieldid == player_charflags)
 		lua_pushinteger(L, plr->charflags);
-	else if (fastcmp(field,"thokitem"))
+	else if (fieldid == player_thokitem)
 		lua_pushinteger(L, plr->thokitem);
-	else if (fastcmp(field,"spinitem"))
+	else if (fieldid == player_spinitem)
 		lua_pushinteger(L, plr->spinitem);
-	else if (fastcmp(field,"revitem"))
+	else if (fieldid == player_revitem)
 		lua_pushinteger(L, plr->revitem);
-	else if (fastcmp(field,"followitem"))
+	else if (fieldid == player_followitem)
 		lua_pushinteger(L, plr->followitem);
-	else if (fastcmp(field,"followmobj"))
+	else if (fieldid == player_followmobj)
 		LUA_PushUserdata(L, plr->followmobj, META_MOBJ);
-	else if (fastcmp(field,"actionspd"))
+	else if (fieldid == player_actionspd)
 		lua_pushfixed(L, plr->actionspd);
-	else if (fastcmp(field,"mindash"))
+	else if (fieldid == player_mindash)
 		lua_pushfixed(L, plr->mindash);
-	else if (fastcmp(field,"maxdash"))
+	else if (fieldid == player_maxdash)
 		lua_pushfixed(L, plr->maxdash);
-	else if (fastcmp(field,"jumpfactor"))
+	else if (fieldid == player_jumpfactor)
 		lua_pushfixed(L, plr->jumpfactor);
-	else if (fastcmp(field,"height"))
+	else if (fieldid == player_height)
 		lua_pushfixed(L, plr->height);
-	else if (fastcmp(field,"spinheight"))
+	else if (fieldid == player_spinheight)
 		lua_pushfixed(L, plr->spinheight);
-	else if (fastcmp(field,"lives"))
+	else if (fieldid == player_lives)
 		lua_pushinteger(L, plr->lives);
-	else if (fastcmp(field,"continues"))
+	else if (fieldid == player_continues)
 		lua_pushinteger(L, plr->continues);
-	else if (fastcmp(field,"xtralife"))
+	else if (fieldid == player_xtralife)
 		lua_pushinteger(L, plr->xtralife);
-	else if (fastcmp(field,"gotcontinue"))
+	else if (fieldid == player_gotcontinue)
 		lua_pushinteger(L, plr->gotcontinue);
-	else if (fastcmp(field,"speed"))
+	else if (fieldid == player_speed)
 		lua_pushfixed(L, plr->speed);
-	else if (fastcmp(field,"secondjump"))
+	else if (fieldid == player_secondjump)
 		lua_pushinteger(L, plr->secondjump);
-	else if (fastcmp(field,"fly1"))
+	else if (fieldid == player_fly1)
 		lua_pushinteger(L, plr->fly1);
-	else if (fastcmp(field,"scoreadd"))
+	else if (fieldid == player_scoreadd)
 		lua_pushinteger(L, plr->scoreadd);
-	else if (fastcmp(field,"glidetime"))
+	else if (fieldid == player_glidetime)
 		lua_pushinteger(L, plr->glidetime);
-	else if (fastcmp(field,"climbing"))
+	else if (fieldid == player_climbing)
 		lua_pushinteger(L, plr->climbing);
-	else if (fastcmp(field,"deadtimer"))
+	else if (fieldid == player_deadtimer)
 		lua_pushinteger(L, plr->deadtimer);
-	else if (fastcmp(field,"exiting"))
+	else if (fieldid == player_exiting)
 		lua_pushinteger(L, plr->exiting);
-	else if (fastcmp(field,"homing"))
+	else if (fieldid == player_homing)
 		lua_pushinteger(L, plr->homing);
-	else if (fastcmp(field,"dashmode"))
+	else if (fieldid == player_dashmode)
 		lua_pushinteger(L, plr->dashmode);
-	else if (fastcmp(field,"skidtime"))
+	else if (fieldid == player_skidtime)
 		lua_pushinteger(L, plr->skidtime);
-	else if (fastcmp(field,"cmomx"))
+	else if (fieldid == player_cmomx)
 		lua_pushfixed(L, plr->cmomx);
-	else if (fastcmp(field,"cmomy"))
+	else if (fieldid == player_cmomy)
 		lua_pushfixed(L, plr->cmomy);
-	else if (fastcmp(field,"rmomx"))
+	else if (fieldid == player_rmomx)
 		lua_pushfixed(L, plr->rmomx);
-	else if (fastcmp(field,"rmomy"))
+	else if (fieldid == player_rmomy)
 		lua_pushfixed(L, plr->rmomy);
-	else if (fastcmp(field,"numboxes"))
+	else if (fieldid == player_numboxes)
 		lua_pushinteger(L, plr->numboxes);
-	else if (fastcmp(field,"totalring"))
+	else if (fieldid == player_totalring)
 		lua_pushinteger(L, plr->totalring);
-	else if (fastcmp(field,"realtime"))
+	else if (fieldid == player_realtime)
 		lua_pushinteger(L, plr->realtime);
-	else if (fastcmp(field,"laps"))
+	else if (fieldid == player_laps)
 		lua_pushinteger(L, plr->laps);
-	else if (fastcmp(field,"ctfteam"))
+	else if (fieldid == player_ctfteam)
 		lua_pushinteger(L, plr->ctfteam);
-	else if (fastcmp(field,"gotflag"))
+	else if (fieldid == player_gotflag)
 		lua_pushinteger(L, plr->gotflag);
-	else if (fastcmp(field,"weapondelay"))
+	else if (fieldid == player_weapondelay)
 		lua_pushinteger(L, plr->weapondelay);
-	else if (fastcmp(field,"tossdelay"))
+	else if (fieldid == player_tossdelay)
 		lua_pushinteger(L, plr->tossdelay);
-	else if (fastcmp(field,"starpostx"))
+	else if (fieldid == player_starpostx)
 		lua_pushinteger(L, plr->starpostx);
-	else if (fastcmp(field,"starposty"))
+	else if (fieldid == player_starposty)
 		lua_pushinteger(L, plr->starposty);
-	else if (fastcmp(field,"starpostz"))
+	else if (fieldid == player_starpostz)
 		lua_pushinteger(L, plr->starpostz);
-	else if (fastcmp(field,"starpostnum"))
+	else if (fieldid == player_starpostnum)
 		lua_pushinteger(L, plr->starpostnum);
-	else if (fastcmp(field,"starposttime"))
+	else if (fieldid == player_starposttime)
 		lua_pushinteger(L, plr->starposttime);
-	else if (fastcmp(field,"starpostangle"))
+	else if (fieldid == player_starpostangle)
 		lua_pushangle(L, plr->starpostangle);
-	else if (fastcmp(field,"starpostscale"))
+	else if (fieldid == player_starpostscale)
 		lua_pushfixed(L, plr->starpostscale);
-	else if (fastcmp(field,"angle_pos"))
+	else if (fieldid == player_angle_pos)
 		lua_pushangle(L, plr->angle_pos);
-	else if (fastcmp(field,"old_angle_pos"))
+	else if (fieldid == player_old_angle_pos)
 		lua_pushangle(L, plr->old_angle_pos);
-	else if (fastcmp(field,"axis1"))
+	else if (fieldid == player_axis1)
 		LUA_PushUserdata(L, plr->axis1, META_MOBJ);
-	else if (fastcmp(field,"axis2"))
+	else if (fieldid == player_axis2)
 		LUA_PushUserdata(L, plr->axis2, META_MOBJ);
-	else if (fastcmp(field,"bumpertime"))
+	else if (fieldid == player_bumpertime)
 		lua_pushinteger(L, plr->bumpertime);
-	else if (fastcmp(field,"flyangle"))
+	else if (fieldid == player_flyangle)
 		lua_pushinteger(L, plr->flyangle);
-	else if (fastcmp(field,"drilltimer"))
+	else if (fieldid == player_drilltimer)
 		lua_pushinteger(L, plr->drilltimer);
-	else if (fastcmp(field,"linkcount"))
+	else if (fieldid == player_linkcount)
 		lua_pushinteger(L, plr->linkcount);
-	else if (fastcmp(field,"linktimer"))
+	else if (fieldid == player_linktimer)
 		lua_pushinteger(L, plr->linktimer);
-	else if (fastcmp(field,"anotherflyangle"))
+	else if (fieldid == player_anotherflyangle)
 		lua_pushinteger(L, plr->anotherflyangle);
-	else if (fastcmp(field,"nightstime"))
+	else if (fieldid == player_nightstime)
 		lua_pushinteger(L, plr->nightstime);
-	else if (fastcmp(field,"drillmeter"))
+	else if (fieldid == player_drillmeter)
 		lua_pushinteger(L, plr->drillmeter);
-	else if (fastcmp(field,"drilldelay"))
+	else if (fieldid == player_drilldelay)
 		lua_pushinteger(L, plr->drilldelay);
-	else if (fastcmp(field,"bonustime"))
+	else if (fieldid == player_bonustime)
 		lua_pushboolean(L, plr->bonustime);
-	else if (fastcmp(field,"capsule"))
+	else if (fieldid == player_capsule)
 		LUA_PushUserdata(L, plr->capsule, META_MOBJ);
-	else if (fastcmp(field,"drone"))
+	else if (fieldid == player_drone)
 		LUA_PushUserdata(L, plr->drone, META_MOBJ);
-	else if (fastcmp(field,"oldscale"))
+	else if (fieldid == player_oldscale)
 		lua_pushfixed(L, plr->oldscale);
-	else if (fastcmp(field,"mare"))
+	else if (fieldid == player_mare)
 		lua_pushinteger(L, plr->mare);
-	else if (fastcmp(field,"marelap"))
+	else if (fieldid == player_marelap)
 		lua_pushinteger(L, plr->marelap);
-	else if (fastcmp(field,"marebonuslap"))
+	else if (fieldid == player_marebonuslap)
 		lua_pushinteger(L, plr->marebonuslap);
-	else if (fastcmp(field,"marebegunat"))
+	else if (fieldid == player_marebegunat)
 		lua_pushinteger(L, plr->marebegunat);
-	else if (fastcmp(field,"startedtime"))
+	else if (fieldid == player_startedtime)
 		lua_pushinteger(L, plr->startedtime);
-	else if (fastcmp(field,"finishedtime"))
+	else if (fieldid == player_finishedtime)
 		lua_pushinteger(L, plr->finishedtime);
-	else if (fastcmp(field,"lapbegunat"))
+	else if (fieldid == player_lapbegunat)
 		lua_pushinteger(L, plr->lapbegunat);
-	else if (fastcmp(field,"lapstartedtime"))
+	else if (fieldid == player_lapstartedtime)
 		lua_pushinteger(L, plr->lapstartedtime);
-	else if (fastcmp(field,"finishedspheres"))
+	else if (fieldid == player_finishedspheres)
 		lua_pushinteger(L, plr->finishedspheres);
-	else if (fastcmp(field,"finishedrings"))
+	else if (fieldid == player_finishedrings)
 		lua_pushinteger(L, plr->finishedrings);
-	else if (fastcmp(field,"marescore"))
+	else if (fieldid == player_marescore)
 		lua_pushinteger(L, plr->marescore);
-	else if (fastcmp(field,"lastmarescore"))
+	else if (fieldid == player_lastmarescore)
 		lua_pushinteger(L, plr->lastmarescore);
-	else if (fastcmp(field,"totalmarescore"))
+	else if (fieldid == player_totalmarescore)
 		lua_pushinteger(L, plr->totalmarescore);
-	else if (fastcmp(field,"lastmare"))
+	else if (fieldid == player_lastmare)
 		lua_pushinteger(L, plr->lastmare);
-	else if (fastcmp(field,"lastmarelap"))
+	else if (fieldid == player_lastmarelap)
 		lua_pushinteger(L, plr->lastmarelap);
-	else if (fastcmp(field,"lastmarebonuslap"))
+	else if (fieldid == player_lastmarebonuslap)
 		lua_pushinteger(L, plr->lastmarebonuslap);
-	else if (fastcmp(field,"totalmarelap"))
+	else if (fieldid == player_totalmarelap)
 		lua_pushinteger(L, plr->totalmarelap);
-	else if (fastcmp(field,"totalmarebonuslap"))
+	else if (fieldid == player_totalmarebonuslap)
 		lua_pushinteger(L, plr->totalmarebonuslap);
-	else if (fastcmp(field,"maxlink"))
+	else if (fieldid == player_maxlink)
 		lua_pushinteger(L, plr->maxlink);
-	else if (fastcmp(field,"texttimer"))
+	else if (fieldid == player_texttimer)
 		lua_pushinteger(L, plr->texttimer);
-	else if (fastcmp(field,"textvar"))
+	else if (fieldid == player_textvar)
 		lua_pushinteger(L, plr->textvar);
-	else if (fastcmp(field,"lastsidehit"))
+	else if (fieldid == player_lastsidehit)
 		lua_pushinteger(L, plr->lastsidehit);
-	else if (fastcmp(field,"lastlinehit"))
+	else if (fieldid == player_lastlinehit)
 		lua_pushinteger(L, plr->lastlinehit);
-	else if (fastcmp(field,"losstime"))
+	else if (fieldid == player_losstime)
 		lua_pushinteger(L, plr->losstime);
-	else if (fastcmp(field,"timeshit"))
+	else if (fieldid == player_timeshit)
 		lua_pushinteger(L, plr->timeshit);
-	else if (fastcmp(field,"onconveyor"))
+	else if (fieldid == player_onconveyor)
 		lua_pushinteger(L, plr->onconveyor);
-	else if (fastcmp(field,"awayviewmobj"))
+	else if (fieldid == player_awayviewmobj)
 		LUA_PushUserdata(L, plr->awayviewmobj, META_MOBJ);
-	else if (fastcmp(field,"awayviewtics"))
+	else if (fieldid == player_awayviewtics)
 		lua_pushinteger(L, plr->awayviewtics);
-	else if (fastcmp(field,"awayviewaiming"))
+	else if (fieldid == player_awayviewaiming)
 		lua_pushangle(L, plr->awayviewaiming);
-	else if (fastcmp(field,"spectator"))
+	else if (fieldid == player_spectator)
 		lua_pushboolean(L, plr->spectator);
-	else if (fastcmp(field,"outofcoop"))
+	else if (fieldid == player_outofcoop)
 		lua_pushboolean(L, plr->outofcoop);
-	else if (fastcmp(field,"bot"))
+	else if (fieldid == player_bot)
 		lua_pushinteger(L, plr->bot);
-	else if (fastcmp(field,"jointime"))
+	else if (fieldid == player_jointime)
 		lua_pushinteger(L, plr->jointime);
-	else if (fastcmp(field,"quittime"))
+	else if (fieldid == player_quittime)
 		lua_pushinteger(L, plr->quittime);
 #ifdef HWRENDER
-	else if (fastcmp(field,"fovadd"))
+	else if (fieldid == player_fovadd)
 		lua_pushfixed(L, plr->fovadd);
 #endif
 	else {
@@ -395,325 +675,326 @@ static int player_set(lua_State *L)
 {
 	player_t *plr = *((player_t **)luaL_checkudata(L, 1, META_PLAYER));
 	const char *field = luaL_checkstring(L, 2);
+	enum player_e fieldid = Lua_optfield(L, 2, NULL, player_opt);
 	if (!plr)
 		return LUA_ErrInvalid(L, "player_t");
 
 	if (hud_running)
 		return luaL_error(L, "Do not alter player_t in HUD rendering code!");
 
-	if (fastcmp(field,"mo") || fastcmp(field,"realmo")) {
+	if (fieldid == player_mo || fieldid == player_realmo) {
 		mobj_t *newmo = *((mobj_t **)luaL_checkudata(L, 3, META_MOBJ));
 		plr->mo->player = NULL; // remove player pointer from old mobj
 		(newmo->player = plr)->mo = newmo; // set player pointer for new mobj, and set new mobj as the player's mobj
 	}
-	else if (fastcmp(field,"cmd"))
+	else if (fieldid == player_cmd)
 		return NOSET;
-	else if (fastcmp(field,"playerstate"))
+	else if (fieldid == player_playerstate)
 		plr->playerstate = luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"camerascale"))
+	else if (fieldid == player_camerascale)
 		plr->camerascale = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"shieldscale"))
+	else if (fieldid == player_shieldscale)
 		plr->shieldscale = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"viewz"))
+	else if (fieldid == player_viewz)
 		plr->viewz = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"viewheight"))
+	else if (fieldid == player_viewheight)
 		plr->viewheight = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"deltaviewheight"))
+	else if (fieldid == player_deltaviewheight)
 		plr->deltaviewheight = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"bob"))
+	else if (fieldid == player_bob)
 		plr->bob = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"viewrollangle"))
+	else if (fieldid == player_viewrollangle)
 		plr->viewrollangle = luaL_checkangle(L, 3);
-	else if (fastcmp(field,"aiming")) {
+	else if (fieldid == player_aiming) {
 		plr->aiming = luaL_checkangle(L, 3);
 		if (plr == &players[consoleplayer])
 			localaiming = plr->aiming;
 		else if (plr == &players[secondarydisplayplayer])
 			localaiming2 = plr->aiming;
 	}
-	else if (fastcmp(field,"drawangle"))
+	else if (fieldid == player_drawangle)
 		plr->drawangle = luaL_checkangle(L, 3);
-	else if (fastcmp(field,"rings"))
+	else if (fieldid == player_rings)
 		plr->rings = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"spheres"))
+	else if (fieldid == player_spheres)
 		plr->spheres = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"pity"))
+	else if (fieldid == player_pity)
 		plr->pity = (SINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"currentweapon"))
+	else if (fieldid == player_currentweapon)
 		plr->currentweapon = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"ringweapons"))
+	else if (fieldid == player_ringweapons)
 		plr->ringweapons = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"ammoremoval"))
+	else if (fieldid == player_ammoremoval)
 		plr->ammoremoval = (UINT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"ammoremovaltimer"))
+	else if (fieldid == player_ammoremovaltimer)
 		plr->ammoremovaltimer = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"ammoremovalweapon"))
+	else if (fieldid == player_ammoremovalweapon)
 		plr->ammoremovalweapon = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"powers"))
+	else if (fieldid == player_powers)
 		return NOSET;
-	else if (fastcmp(field,"pflags"))
+	else if (fieldid == player_pflags)
 		plr->pflags = luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"panim"))
+	else if (fieldid == player_panim)
 		plr->panim = luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"flashcount"))
+	else if (fieldid == player_flashcount)
 		plr->flashcount = (UINT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"flashpal"))
+	else if (fieldid == player_flashpal)
 		plr->flashpal = (UINT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"skincolor"))
+	else if (fieldid == player_skincolor)
 	{
 		UINT16 newcolor = (UINT16)luaL_checkinteger(L,3);
 		if (newcolor >= numskincolors)
 			return luaL_error(L, "player.skincolor %d out of range (0 - %d).", newcolor, numskincolors-1);
 		plr->skincolor = newcolor;
 	}
-	else if (fastcmp(field,"score"))
+	else if (fieldid == player_score)
 		plr->score = (UINT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"dashspeed"))
+	else if (fieldid == player_dashspeed)
 		plr->dashspeed = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"normalspeed"))
+	else if (fieldid == player_normalspeed)
 		plr->normalspeed = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"runspeed"))
+	else if (fieldid == player_runspeed)
 		plr->runspeed = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"thrustfactor"))
+	else if (fieldid == player_thrustfactor)
 		plr->thrustfactor = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"accelstart"))
+	else if (fieldid == player_accelstart)
 		plr->accelstart = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"acceleration"))
+	else if (fieldid == player_acceleration)
 		plr->acceleration = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"charability"))
+	else if (fieldid == player_charability)
 		plr->charability = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"charability2"))
+	else if (fieldid == player_charability2)
 		plr->charability2 = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"charflags"))
+	else if (fieldid == player_charflags)
 		plr->charflags = (UINT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"thokitem"))
+	else if (fieldid == player_thokitem)
 		plr->thokitem = luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"spinitem"))
+	else if (fieldid == player_spinitem)
 		plr->spinitem = luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"revitem"))
+	else if (fieldid == player_revitem)
 		plr->revitem = luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"followitem"))
+	else if (fieldid == player_followitem)
 		plr->followitem = luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"followmobj"))
+	else if (fieldid == player_followmobj)
 	{
 		mobj_t *mo = NULL;
 		if (!lua_isnil(L, 3))
 			mo = *((mobj_t **)luaL_checkudata(L, 3, META_MOBJ));
 		P_SetTarget(&plr->followmobj, mo);
 	}
-	else if (fastcmp(field,"actionspd"))
+	else if (fieldid == player_actionspd)
 		plr->actionspd = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"mindash"))
+	else if (fieldid == player_mindash)
 		plr->mindash = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"maxdash"))
+	else if (fieldid == player_maxdash)
 		plr->maxdash = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"jumpfactor"))
+	else if (fieldid == player_jumpfactor)
 		plr->jumpfactor = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"height"))
+	else if (fieldid == player_height)
 		plr->height = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"spinheight"))
+	else if (fieldid == player_spinheight)
 		plr->spinheight = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"lives"))
+	else if (fieldid == player_lives)
 		plr->lives = (SINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"continues"))
+	else if (fieldid == player_continues)
 		plr->continues = (SINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"xtralife"))
+	else if (fieldid == player_xtralife)
 		plr->xtralife = (SINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"gotcontinue"))
+	else if (fieldid == player_gotcontinue)
 		plr->gotcontinue = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"speed"))
+	else if (fieldid == player_speed)
 		plr->speed = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"secondjump"))
+	else if (fieldid == player_secondjump)
 		plr->secondjump = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"fly1"))
+	else if (fieldid == player_fly1)
 		plr->fly1 = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"scoreadd"))
+	else if (fieldid == player_scoreadd)
 		plr->scoreadd = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"glidetime"))
+	else if (fieldid == player_glidetime)
 		plr->glidetime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"climbing"))
+	else if (fieldid == player_climbing)
 		plr->climbing = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"deadtimer"))
+	else if (fieldid == player_deadtimer)
 		plr->deadtimer = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"exiting"))
+	else if (fieldid == player_exiting)
 		plr->exiting = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"homing"))
+	else if (fieldid == player_homing)
 		plr->homing = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"dashmode"))
+	else if (fieldid == player_dashmode)
 		plr->dashmode = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"skidtime"))
+	else if (fieldid == player_skidtime)
 		plr->skidtime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"cmomx"))
+	else if (fieldid == player_cmomx)
 		plr->cmomx = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"cmomy"))
+	else if (fieldid == player_cmomy)
 		plr->cmomy = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"rmomx"))
+	else if (fieldid == player_rmomx)
 		plr->rmomx = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"rmomy"))
+	else if (fieldid == player_rmomy)
 		plr->rmomy = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"numboxes"))
+	else if (fieldid == player_numboxes)
 		plr->numboxes = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"totalring"))
+	else if (fieldid == player_totalring)
 		plr->totalring = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"realtime"))
+	else if (fieldid == player_realtime)
 		plr->realtime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"laps"))
+	else if (fieldid == player_laps)
 		plr->laps = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"ctfteam"))
+	else if (fieldid == player_ctfteam)
 		plr->ctfteam = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"gotflag"))
+	else if (fieldid == player_gotflag)
 		plr->gotflag = (UINT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"weapondelay"))
+	else if (fieldid == player_weapondelay)
 		plr->weapondelay = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"tossdelay"))
+	else if (fieldid == player_tossdelay)
 		plr->tossdelay = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"starpostx"))
+	else if (fieldid == player_starpostx)
 		plr->starpostx = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"starposty"))
+	else if (fieldid == player_starposty)
 		plr->starposty = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"starpostz"))
+	else if (fieldid == player_starpostz)
 		plr->starpostz = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"starpostnum"))
+	else if (fieldid == player_starpostnum)
 		plr->starpostnum = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"starposttime"))
+	else if (fieldid == player_starposttime)
 		plr->starposttime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"starpostangle"))
+	else if (fieldid == player_starpostangle)
 		plr->starpostangle = luaL_checkangle(L, 3);
-	else if (fastcmp(field,"starpostscale"))
+	else if (fieldid == player_starpostscale)
 		plr->starpostscale = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"angle_pos"))
+	else if (fieldid == player_angle_pos)
 		plr->angle_pos = luaL_checkangle(L, 3);
-	else if (fastcmp(field,"old_angle_pos"))
+	else if (fieldid == player_old_angle_pos)
 		plr->old_angle_pos = luaL_checkangle(L, 3);
-	else if (fastcmp(field,"axis1"))
+	else if (fieldid == player_axis1)
 	{
 		mobj_t *mo = NULL;
 		if (!lua_isnil(L, 3))
 			mo = *((mobj_t **)luaL_checkudata(L, 3, META_MOBJ));
 		P_SetTarget(&plr->axis1, mo);
 	}
-	else if (fastcmp(field,"axis2"))
+	else if (fieldid == player_axis2)
 	{
 		mobj_t *mo = NULL;
 		if (!lua_isnil(L, 3))
 			mo = *((mobj_t **)luaL_checkudata(L, 3, META_MOBJ));
 		P_SetTarget(&plr->axis2, mo);
 	}
-	else if (fastcmp(field,"bumpertime"))
+	else if (fieldid == player_bumpertime)
 		plr->bumpertime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"flyangle"))
+	else if (fieldid == player_flyangle)
 		plr->flyangle = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"drilltimer"))
+	else if (fieldid == player_drilltimer)
 		plr->drilltimer = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"linkcount"))
+	else if (fieldid == player_linkcount)
 		plr->linkcount = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"linktimer"))
+	else if (fieldid == player_linktimer)
 		plr->linktimer = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"anotherflyangle"))
+	else if (fieldid == player_anotherflyangle)
 		plr->anotherflyangle = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"nightstime"))
+	else if (fieldid == player_nightstime)
 		plr->nightstime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"drillmeter"))
+	else if (fieldid == player_drillmeter)
 		plr->drillmeter = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"drilldelay"))
+	else if (fieldid == player_drilldelay)
 		plr->drilldelay = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"bonustime"))
+	else if (fieldid == player_bonustime)
 		plr->bonustime = luaL_checkboolean(L, 3);
-	else if (fastcmp(field,"capsule"))
+	else if (fieldid == player_capsule)
 	{
 		mobj_t *mo = NULL;
 		if (!lua_isnil(L, 3))
 			mo = *((mobj_t **)luaL_checkudata(L, 3, META_MOBJ));
 		P_SetTarget(&plr->capsule, mo);
 	}
-	else if (fastcmp(field,"drone"))
+	else if (fieldid == player_drone)
 	{
 		mobj_t *mo = NULL;
 		if (!lua_isnil(L, 3))
 			mo = *((mobj_t **)luaL_checkudata(L, 3, META_MOBJ));
 		P_SetTarget(&plr->drone, mo);
 	}
-	else if (fastcmp(field,"oldscale"))
+	else if (fieldid == player_oldscale)
 		plr->oldscale = luaL_checkfixed(L, 3);
-	else if (fastcmp(field,"mare"))
+	else if (fieldid == player_mare)
 		plr->mare = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"marelap"))
+	else if (fieldid == player_marelap)
 		plr->marelap = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"marebonuslap"))
+	else if (fieldid == player_marebonuslap)
 		plr->marebonuslap = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"marebegunat"))
+	else if (fieldid == player_marebegunat)
 		plr->marebegunat = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"startedtime"))
+	else if (fieldid == player_startedtime)
 		plr->startedtime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"finishedtime"))
+	else if (fieldid == player_finishedtime)
 		plr->finishedtime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"lapbegunat"))
+	else if (fieldid == player_lapbegunat)
 		plr->lapbegunat = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"lapstartedtime"))
+	else if (fieldid == player_lapstartedtime)
 		plr->lapstartedtime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"finishedspheres"))
+	else if (fieldid == player_finishedspheres)
 		plr->finishedspheres = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"finishedrings"))
+	else if (fieldid == player_finishedrings)
 		plr->finishedrings = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"marescore"))
+	else if (fieldid == player_marescore)
 		plr->marescore = (UINT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"lastmarescore"))
+	else if (fieldid == player_lastmarescore)
 		plr->lastmarescore = (UINT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"totalmarescore"))
+	else if (fieldid == player_totalmarescore)
 		plr->totalmarescore = (UINT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"lastmare"))
+	else if (fieldid == player_lastmare)
 		plr->lastmare = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"lastmarelap"))
+	else if (fieldid == player_lastmarelap)
 		plr->lastmarelap = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"lastmarebonuslap"))
+	else if (fieldid == player_lastmarebonuslap)
 		plr->lastmarebonuslap = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"totalmarelap"))
+	else if (fieldid == player_totalmarelap)
 		plr->totalmarelap = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"totalmarebonuslap"))
+	else if (fieldid == player_totalmarebonuslap)
 		plr->totalmarebonuslap = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"maxlink"))
+	else if (fieldid == player_maxlink)
 		plr->maxlink = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"texttimer"))
+	else if (fieldid == player_texttimer)
 		plr->texttimer = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"textvar"))
+	else if (fieldid == player_textvar)
 		plr->textvar = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"lastsidehit"))
+	else if (fieldid == player_lastsidehit)
 		plr->lastsidehit = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"lastlinehit"))
+	else if (fieldid == player_lastlinehit)
 		plr->lastlinehit = (INT16)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"losstime"))
+	else if (fieldid == player_losstime)
 		plr->losstime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"timeshit"))
+	else if (fieldid == player_timeshit)
 		plr->timeshit = (UINT8)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"onconveyor"))
+	else if (fieldid == player_onconveyor)
 		plr->onconveyor = (INT32)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"awayviewmobj"))
+	else if (fieldid == player_awayviewmobj)
 	{
 		mobj_t *mo = NULL;
 		if (!lua_isnil(L, 3))
 			mo = *((mobj_t **)luaL_checkudata(L, 3, META_MOBJ));
 		P_SetTarget(&plr->awayviewmobj, mo);
 	}
-	else if (fastcmp(field,"awayviewtics"))
+	else if (fieldid == player_awayviewtics)
 	{
 		plr->awayviewtics = (INT32)luaL_checkinteger(L, 3);
 		if (plr->awayviewtics && !plr->awayviewmobj) // awayviewtics must ALWAYS have an awayviewmobj set!!
 			P_SetTarget(&plr->awayviewmobj, plr->mo); // but since the script might set awayviewmobj immediately AFTER setting awayviewtics, use player mobj as filler for now.
 	}
-	else if (fastcmp(field,"awayviewaiming"))
+	else if (fieldid == player_awayviewaiming)
 		plr->awayviewaiming = luaL_checkangle(L, 3);
-	else if (fastcmp(field,"spectator"))
+	else if (fieldid == player_spectator)
 		plr->spectator = lua_toboolean(L, 3);
-	else if (fastcmp(field,"outofcoop"))
+	else if (fieldid == player_outofcoop)
 		plr->outofcoop = lua_toboolean(L, 3);
-	else if (fastcmp(field,"bot"))
+	else if (fieldid == player_bot)
 		return NOSET;
-	else if (fastcmp(field,"jointime"))
+	else if (fieldid == player_jointime)
 		plr->jointime = (tic_t)luaL_checkinteger(L, 3);
-	else if (fastcmp(field,"quittime"))
+	else if (fieldid == player_quittime)
 		plr->quittime = (tic_t)luaL_checkinteger(L, 3);
 #ifdef HWRENDER
-	else if (fastcmp(field,"fovadd"))
+	else if (fieldid == player_fovadd)
 		plr->fovadd = luaL_checkfixed(L, 3);
 #endif
 	else {
@@ -837,10 +1118,13 @@ static int ticcmd_set(lua_State *L)
 int LUA_PlayerLib(lua_State *L)
 {
 	luaL_newmetatable(L, META_PLAYER);
-		lua_pushcfunction(L, player_get);
-		lua_setfield(L, -2, "__index");
+		Lua_PushFieldTable(L, player_opt);
+
+		lua_pushvalue(L, -1);
+		lua_pushcclosure(L, player_get, 1);
+		lua_setfield(L, -3, "__index");
 
-		lua_pushcfunction(L, player_set);
+		lua_pushcclosure(L, player_set, 1);
 		lua_setfield(L, -2, "__newindex");
 
 		lua_pushcfunction(L, player_num);
@@ -1546,3 +1546,53 @@ int Lua_optoption(lua_State *L, int narg,
 			return i;
 	return -1;
 }
+
+// Field lookup for the __index and __newindex of userdata types.
+// The field names are put in a table, mapping each one to its index, which is
+// given to those functions as their first upvalue. Since Lua strings are
+// interned, looking a field up is then a single hash lookup instead of a
+// comparison against every name in the list.
+void Lua_PushFieldTable(lua_State *L, const char *const lst[])
+{
+	int i;
+
+	for (i = 0; lst[i]; i++)
+		;
+	lua_createtable(L, 0, i);
+	for (i = 0; lst[i]; i++)
+	{
+		lua_pushinteger(L, i);
+		lua_setfield(L, -2, lst[i]);
+	}
+}
+
+// Like Lua_optoption, using the field table in upvalue 1.
+int Lua_optfield(lua_State *L, int narg,
+	const char *def, const char *const lst[])
+{
+	int i;
+
+	if (lua_type(L, narg) != LUA_TSTRING)
+		return Lua_optoption(L, narg, def, lst);
+
+	lua_pushvalue(L, narg);
+	lua_rawget(L, lua_upvalueindex(1));
+	i = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : -1;
+	lua_pop(L, 1);
+	return i;
+}
+
+// Like luaL_checkoption, using the field table in upvalue 1.
+int Lua_checkfield(lua_State *L, int narg,
+	const char *def, const char *const lst[])
+{
+	int i;
+
+	if (lua_type(L, narg) != LUA_TSTRING)
+		return luaL_checkoption(L, narg, def, lst);
+
+	i = Lua_optfield(L, narg, def, lst);
+	if (i < 0)
+		return luaL_argerror(L, narg, lua_pushfstring(L, "invalid option " LUA_QS, lua_tostring(L, narg)));
+	return i;
+}
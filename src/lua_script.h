@@ -60,7 +60,13 @@ void Got_Luacmd(UINT8 **cp, INT32 playernum); // lua_consolelib.c
 void LUA_CVarChanged(const char *name); // lua_consolelib.c
 int Lua_optoption(lua_State *L, int narg,
 	const char *def, const char *const lst[]);
+void Lua_PushFieldTable(lua_State *L, const char *const lst[]);
+int Lua_optfield(lua_State *L, int narg,
+	const char *def, const char *const lst[]);
+int Lua_checkfield(lua_State *L, int narg,
+	const char *def, const char *const lst[]);
 void LUAh_NetArchiveHook(lua_CFunction archFunc);
+struct luaprofile_s *LUA_NewProfile(lua_State *L, const char *hook); // lua_hooklib.c
 
 // Console wrapper
 void COM_Lua_f(void);
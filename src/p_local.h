@@ -76,6 +76,32 @@ void P_InitThinkers(void);
 void P_AddThinker(const thinklistnum_t n, thinker_t *thinker);
 void P_RemoveThinker(thinker_t *thinker);
 
+typedef enum
+{
+	TICKSTAT_TOTAL,
+	TICKSTAT_PRETHINK, // LUAh_PreThinkFrame, demo ticcmds
+	TICKSTAT_PLAYERS, // P_PlayerThink
+	TICKSTAT_THINKERS, // P_RunThinkers, all lists
+	TICKSTAT_THLIST, // one per thinker list from here
+	TICKSTAT_AFTERTHINK = TICKSTAT_THLIST + NUM_THINKERLISTS, // P_PlayerAfterThink
+	TICKSTAT_THINKFRAME, // LUAh_ThinkFrame
+	TICKSTAT_SHIELDS, // P_RunShields, P_RunOverlays
+	TICKSTAT_SPECIALS, // P_UpdateSpecials
+	TICKSTAT_RESPAWN, // P_RespawnSpecials
+	TICKSTAT_LEVEL, // gametype logic, countdowns, precipitation, demos and ghosts
+	TICKSTAT_POSTTHINK, // LUAh_PostThinkFrame
+	NUMTICKSTATS
+} tickstat_t; /**< Parts of P_Ticker timed by tickstats. */
+
+typedef struct
+{
+	UINT32 min, avg, max, p99; // microseconds
+} tickstatsummary_t;
+
+extern consvar_t cv_tickstats;
+extern const char *const tickstatnames[NUMTICKSTATS];
+size_t P_GetTickStats(const tickstatsummary_t **summary);
+
 //
 // P_USER
 //
@@ -276,6 +302,18 @@ void P_RespawnSpecials(void);
 
 mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type);
 
+mobj_t *P_AllocMobj(void);
+void P_FreeMobj(mobj_t *mobj);
+void P_ClearMobjPool(void);
+
+// World state hashes for desynch checking, kept up to date as things change
+extern UINT32 synch_mobjhash, synch_sectorhash;
+
+void P_UpdateMobjSynchHash(mobj_t *mobj);
+void P_UpdateSectorSynchHash(sector_t *sector);
+UINT32 P_PolyobjSynchHash(void);
+void P_RefreshSynchHashes(void);
+
 void P_RecalcPrecipInSector(sector_t *sector);
 void P_PrecipitationEffects(void);
 
@@ -411,6 +449,7 @@ boolean P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y, fixed_t z);
 void P_SlideMove(mobj_t *mo);
 void P_BounceMove(mobj_t *mo);
 boolean P_CheckSight(mobj_t *t1, mobj_t *t2);
+UINT8 *P_BuildRejectMatrix(void);
 void P_CheckHoopPosition(mobj_t *hoopthing, fixed_t x, fixed_t y, fixed_t z, fixed_t radius);
 
 boolean P_CheckSector(sector_t *sector, boolean crunch);
@@ -440,6 +479,22 @@ extern fixed_t bmaporgx;
 extern fixed_t bmaporgy; // origin of block map
 extern mobj_t **blocklinks; // for thing chains
 
+// The same things as blocklinks, kept as one array per cell so they can
+// be walked without chasing bnext through every mobj.
+typedef struct
+{
+	mobj_t *mobj; // NULL once unlinked, until the cell is compacted
+	fixed_t x, y, radius; // kept up to date for broad-phase rejection
+} blockthing_t;
+
+typedef struct
+{
+	blockthing_t *things; // oldest first; walk backwards for blocklinks order
+	INT32 count, capacity;
+} blockcell_t;
+
+extern blockcell_t *blockthings;
+
 //
 // P_INTER
 //
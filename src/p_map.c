@@ -2241,7 +2241,7 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
 		for (bx = xl; bx <= xh; bx++)
 			for (by = yl; by <= yh; by++)
 			{
-				if (!P_BlockThingsIterator(bx, by, PIT_CheckThing))
+				if (!P_BlockThingsIteratorNear(bx, by, PIT_CheckThing))
 					blockval = false;
 				if (P_MobjWasRemoved(tmthing))
 					return false;
@@ -2253,7 +2253,7 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
 	// check lines
 	for (bx = xl; bx <= xh; bx++)
 		for (by = yl; by <= yh; by++)
-			if (!P_BlockLinesIterator(bx, by, PIT_CheckLine))
+			if (!P_BlockLinesIteratorBox(bx, by, tmbbox, PIT_CheckLine))
 				blockval = false;
 
 	return blockval;
@@ -2454,7 +2454,7 @@ boolean P_CheckCameraPosition(fixed_t x, fixed_t y, camera_t *thiscam)
 	// check lines
 	for (bx = xl; bx <= xh; bx++)
 		for (by = yl; by <= yh; by++)
-			if (!P_BlockLinesIterator(bx, by, PIT_CheckCameraLine))
+			if (!P_BlockLinesIteratorBox(bx, by, tmbbox, PIT_CheckCameraLine))
 				return false;
 
 	return true;
@@ -4248,6 +4248,8 @@ boolean P_CheckSector(sector_t *sector, boolean crunch)
 	nofit = false;
 	crushchange = crunch;
 
+	P_UpdateSectorSynchHash(sector);
+
 	// killough 4/4/98: scan list front-to-back until empty or exhausted,
 	// restarting from beginning after each thing is processed. Avoids
 	// crashes, and is sure to examine all things in the sector, and only
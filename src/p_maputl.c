@@ -684,6 +684,86 @@ void P_LineOpening(line_t *linedef, mobj_t *mobj)
 // THING POSITION SETTING
 //
 
+//
+// BLOCKTHINGS
+// Each blockmap cell's things with their positions and radii, newest last,
+// so walking a cell backwards visits things in blocklinks order. Unlinking
+// only clears the entry; cells are compacted when they fill up.
+//
+
+static void P_CompactBlockCell(blockcell_t *bc)
+{
+	INT32 i, n = 0;
+
+	for (i = 0; i < bc->count; i++)
+		if (bc->things[i].mobj)
+		{
+			bc->things[n] = bc->things[i];
+			bc->things[n].mobj->blockindex = n;
+			n++;
+		}
+	bc->count = n;
+}
+
+static void P_LinkBlockThing(mobj_t *thing, INT32 cell)
+{
+	blockcell_t *bc = &blockthings[cell];
+	blockthing_t *bt;
+
+	if (bc->count == bc->capacity)
+	{
+		P_CompactBlockCell(bc);
+		if (bc->count >= bc->capacity - bc->capacity/4)
+		{
+			bc->capacity = bc->capacity ? bc->capacity * 2 : 4;
+			bc->things = Z_Realloc(bc->things, bc->capacity * sizeof (*bc->things), PU_LEVEL, NULL);
+		}
+	}
+
+	thing->blockcell = cell;
+	thing->blockindex = bc->count;
+	bt = &bc->things[bc->count++];
+	bt->mobj = thing;
+	bt->x = thing->x;
+	bt->y = thing->y;
+	bt->radius = thing->radius;
+}
+
+static void P_UnlinkBlockThing(mobj_t *thing)
+{
+	blockcell_t *bc;
+
+	if (thing->blockcell < 0)
+		return; // already out, bprev isn't cleared
+
+	bc = &blockthings[thing->blockcell];
+	if (bc->things[thing->blockindex].mobj != thing)
+		I_Error("P_UnlinkBlockThing: thing not in its blockmap cell\n");
+
+	bc->things[thing->blockindex].mobj = NULL;
+	if (thing->blockindex == bc->count - 1)
+		bc->count--;
+	thing->blockcell = -1;
+}
+
+/** Brings a thing's blockmap entry up to date after its position or
+  * radius was changed without going through P_SetThingPosition.
+  *
+  * \param thing The thing; does nothing if it's not in the blockmap.
+  */
+void P_UpdateBlockThing(mobj_t *thing)
+{
+	blockthing_t *bt;
+
+	if (thing->blockcell < 0)
+		return;
+
+	bt = &blockthings[thing->blockcell].things[thing->blockindex];
+	bt->x = thing->x;
+	bt->y = thing->y;
+	bt->radius = thing->radius;
+}
+
 //
 // P_UnsetThingPosition
 // Unlinks a thing from block map and sectors.
@@ -741,8 +821,12 @@ void P_UnsetThingPosition(mobj_t *thing)
 		*/
 
 		mobj_t *bnext, **bprev = thing->bprev;
-		if (bprev && (*bprev = bnext = thing->bnext) != NULL)  // unlink from block map
-			bnext->bprev = bprev;
+		if (bprev)
+		{
+			if ((*bprev = bnext = thing->bnext) != NULL)  // unlink from block map
+				bnext->bprev = bprev;
+			P_UnlinkBlockThing(thing);
+		}
 	}
 }
 
@@ -828,6 +912,8 @@ void P_SetThingPosition(mobj_t *thing)
 				bnext->bprev = &thing->bnext;
 			thing->bprev = link;
 			*link = thing;
+
+			P_LinkBlockThing(thing, blocky*bmapwidth + blockx);
 		}
 		else // thing is off the map
 			thing->bnext = NULL, thing->bprev = NULL;
@@ -908,25 +994,10 @@ void P_SetPrecipitationThingPosition(precipmobj_t *thing)
 //
 
 
-//
-// P_BlockLinesIterator
-// The validcount flags are used to avoid checking lines
-// that are marked in multiple mapblocks,
-// so increment validcount before the first call
-// to P_BlockLinesIterator, then make one or more calls
-// to it.
-//
-boolean P_BlockLinesIterator(INT32 x, INT32 y, boolean (*func)(line_t *))
+// Runs func on the polyobject lines in a block, for the iterators below.
+static boolean P_BlockPolyLinesIterator(INT32 offset, boolean (*func)(line_t *))
 {
-	INT32 offset;
-	const INT32 *list; // Big blockmap
 	polymaplink_t *plink; // haleyjd 02/22/06
-	line_t *ld;
-
-	if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
-		return true;
-
-	offset = y*bmapwidth + x;
 
 	// haleyjd 02/22/06: consider polyobject lines
 	plink = polyblocklinks[offset];
@@ -952,6 +1023,31 @@ boolean P_BlockLinesIterator(INT32 x, INT32 y, boolean (*func)(line_t *))
 		plink = (polymaplink_t *)(plink->link.next);
 	}
 
+	return true;
+}
+
+//
+// P_BlockLinesIterator
+// The validcount flags are used to avoid checking lines
+// that are marked in multiple mapblocks,
+// so increment validcount before the first call
+// to P_BlockLinesIterator, then make one or more calls
+// to it.
+//
+boolean P_BlockLinesIterator(INT32 x, INT32 y, boolean (*func)(line_t *))
+{
+	INT32 offset;
+	const INT32 *list; // Big blockmap
+	line_t *ld;
+
+	if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+		return true;
+
+	offset = y*bmapwidth + x;
+
+	if (!P_BlockPolyLinesIterator(offset, func))
+		return false;
+
 	offset = *(blockmap + offset); // offset = blockmap[y*bmapwidth+x];
 
 	// First index is really empty, so +1 it.
@@ -970,19 +1066,179 @@ boolean P_BlockLinesIterator(INT32 x, INT32 y, boolean (*func)(line_t *))
 	return true; // Everything was checked.
 }
 
+//
+// BLOCKMAP LINE BOXES
+// The bounding box of every line in every blockmap list, stored by
+// side in arrays that line up with blockmaplump. A block's boxes are
+// then contiguous, and can be checked against a box several at a time
+// without touching line_t at all.
+//
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCKBOX_SSE2
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define BLOCKBOX_NEON
+#include <arm_neon.h>
+#endif
+
+static fixed_t *blocklinebox[4]; // [BOXTOP] etc.; PU_LEVEL
+
+/** Fills in the blockmap line boxes for the current level.
+  * Polyobject lines move around, so they get boxes that match anything.
+  * Called once the blockmap is loaded, and again once polyobjects exist.
+  */
+void P_BuildBlockLineBoxes(void)
+{
+	const INT32 numblocks = bmapwidth * bmapheight;
+	size_t count = 0;
+	INT32 i, j;
+
+	// Find the end of the last list
+	for (i = 0; i < numblocks; i++)
+	{
+		for (j = blockmap[i] + 1; blockmaplump[j] != -1; j++)
+			;
+		count = max(count, (size_t)j);
+	}
+
+	if (blocklinebox[0])
+		Z_Free(blocklinebox[0]);
+	Z_Malloc(4 * count * sizeof (fixed_t), PU_LEVEL, &blocklinebox[0]);
+	for (i = 1; i < 4; i++)
+		blocklinebox[i] = blocklinebox[0] + i*count;
+
+	for (i = 0; i < numblocks; i++)
+		for (j = blockmap[i] + 1; blockmaplump[j] != -1; j++)
+		{
+			const line_t *ld = &lines[blockmaplump[j]];
+
+			if (ld->polyobj)
+			{
+				blocklinebox[BOXTOP][j] = blocklinebox[BOXRIGHT][j] = INT32_MAX;
+				blocklinebox[BOXBOTTOM][j] = blocklinebox[BOXLEFT][j] = INT32_MIN;
+			}
+			else
+			{
+				blocklinebox[BOXTOP][j] = ld->bbox[BOXTOP];
+				blocklinebox[BOXBOTTOM][j] = ld->bbox[BOXBOTTOM];
+				blocklinebox[BOXLEFT][j] = ld->bbox[BOXLEFT];
+				blocklinebox[BOXRIGHT][j] = ld->bbox[BOXRIGHT];
+			}
+		}
+}
+
+// Which of the count (up to 32) line boxes from blockmaplump[start]
+// overlap bbox, as a bitmask.
+static UINT32 P_BlockLineBoxMask(INT32 start, INT32 count, const fixed_t *bbox)
+{
+	const fixed_t *top = blocklinebox[BOXTOP] + start, *bottom = blocklinebox[BOXBOTTOM] + start;
+	const fixed_t *left = blocklinebox[BOXLEFT] + start, *right = blocklinebox[BOXRIGHT] + start;
+	UINT32 mask = 0;
+	INT32 i = 0;
+
+	if (count > 32)
+		count = 32;
+
+#if defined (BLOCKBOX_SSE2)
+	{
+		const __m128i bt = _mm_set1_epi32(bbox[BOXTOP]), bb = _mm_set1_epi32(bbox[BOXBOTTOM]);
+		const __m128i bl = _mm_set1_epi32(bbox[BOXLEFT]), br = _mm_set1_epi32(bbox[BOXRIGHT]);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i hit = _mm_and_si128(
+				_mm_and_si128(_mm_cmplt_epi32(_mm_loadu_si128((const __m128i *)(left + i)), br),
+					_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(right + i)), bl)),
+				_mm_and_si128(_mm_cmplt_epi32(_mm_loadu_si128((const __m128i *)(bottom + i)), bt),
+					_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(top + i)), bb)));
+			mask |= (UINT32)_mm_movemask_ps(_mm_castsi128_ps(hit)) << i;
+		}
+	}
+#elif defined (BLOCKBOX_NEON)
+	{
+		static const uint32_t lanebits[4] = {1, 2, 4, 8};
+		const uint32x4_t bits = vld1q_u32(lanebits);
+		const int32x4_t bt = vdupq_n_s32(bbox[BOXTOP]), bb = vdupq_n_s32(bbox[BOXBOTTOM]);
+		const int32x4_t bl = vdupq_n_s32(bbox[BOXLEFT]), br = vdupq_n_s32(bbox[BOXRIGHT]);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			uint32x4_t hit = vandq_u32(
+				vandq_u32(vcltq_s32(vld1q_s32(left + i), br), vcgtq_s32(vld1q_s32(right + i), bl)),
+				vandq_u32(vcltq_s32(vld1q_s32(bottom + i), bt), vcgtq_s32(vld1q_s32(top + i), bb)));
+			uint32x2_t sum = vpadd_u32(vget_low_u32(vandq_u32(hit, bits)), vget_high_u32(vandq_u32(hit, bits)));
+			mask |= (vget_lane_u32(sum, 0) | vget_lane_u32(sum, 1)) << i;
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		if (left[i] < bbox[BOXRIGHT] && right[i] > bbox[BOXLEFT]
+		&& bottom[i] < bbox[BOXTOP] && top[i] > bbox[BOXBOTTOM])
+			mask |= 1u << i;
+
+	return mask;
+}
 
 //
-// P_BlockThingsIterator
+// P_BlockLinesIteratorBox
+// Same as P_BlockLinesIterator, but skips lines whose bounding box
+// doesn't overlap bbox, without looking at them or marking them. Only
+// for callbacks that would immediately return true for such lines.
 //
-boolean P_BlockThingsIterator(INT32 x, INT32 y, boolean (*func)(mobj_t *))
+boolean P_BlockLinesIteratorBox(INT32 x, INT32 y, const fixed_t *bbox, boolean (*func)(line_t *))
 {
-	mobj_t *mobj, *bnext = NULL;
+	INT32 offset, start, count, i;
+	line_t *ld;
+
+	if (!blocklinebox[0])
+		return P_BlockLinesIterator(x, y, func);
 
 	if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
 		return true;
 
-	// Check interaction with the objects in the blockmap.
-	for (mobj = blocklinks[y*bmapwidth + x]; mobj; mobj = bnext)
+	offset = y*bmapwidth + x;
+
+	if (!P_BlockPolyLinesIterator(offset, func))
+		return false;
+
+	// First index is really empty, so +1 it.
+	start = blockmap[offset] + 1;
+	for (count = 0; blockmaplump[start + count] != -1; count++)
+		;
+
+	for (i = 0; i < count; i += 32)
+	{
+		UINT32 mask = P_BlockLineBoxMask(start + i, count - i, bbox);
+		INT32 b;
+
+		for (b = 0; mask; b++, mask >>= 1)
+		{
+			if (!(mask & 1))
+				continue;
+
+			ld = &lines[blockmaplump[start + i + b]];
+
+			if (ld->validcount == validcount)
+				continue; // Line has already been checked.
+
+			ld->validcount = validcount;
+
+			if (!func(ld))
+				return false;
+		}
+	}
+	return true; // Everything was checked.
+}
+
+
+// Walks a blocklinks chain from mobj on, for P_BlockThingsIterator.
+static boolean P_BlockThingsChain(mobj_t *mobj, boolean (*func)(mobj_t *))
+{
+	mobj_t *bnext = NULL;
+
+	for (; mobj; mobj = bnext)
 	{
 		P_SetTarget(&bnext, mobj->bnext); // We want to note our reference to bnext here incase it is MF_NOTHINK and gets removed!
 		if (!func(mobj))
@@ -1000,6 +1256,92 @@ boolean P_BlockThingsIterator(INT32 x, INT32 y, boolean (*func)(mobj_t *))
 	return true;
 }
 
+//
+// P_BlockThingsIterator
+//
+boolean P_BlockThingsIterator(INT32 x, INT32 y, boolean (*func)(mobj_t *))
+{
+	if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+		return true;
+
+	// Check interaction with the objects in the blockmap.
+	return P_BlockThingsChain(blocklinks[y*bmapwidth + x], func);
+}
+
+/** Like P_BlockThingsIterator, but leaves out things too far from tmthing
+  * at (tmx, tmy) to touch it: those whose distance on either axis is at
+  * least the sum of the two radii. That's the test PIT_CheckThing makes
+  * before anything else that matters, so func must not care about such
+  * things either. The test uses the positions kept in blockthings, so
+  * the things it rejects never get looked at.
+  *
+  * The visiting order, the references held and the reasons to stop are
+  * the same as P_BlockThingsIterator's, just with rejected things left out.
+  *
+  * \param x Block x.
+  * \param y Block y.
+  * \param func Function to call on each thing that's close enough.
+  * 
+eturn False if func returned false, true otherwise.
+  */
+boolean P_BlockThingsIteratorNear(INT32 x, INT32 y, boolean (*func)(mobj_t *))
+{
+	const blockcell_t *bc;
+	mobj_t *mobj, *bnext = NULL;
+	INT32 i;
+
+	if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+		return true;
+
+	bc = &blockthings[y*bmapwidth + x];
+	i = bc->count - 1;
+
+	for (;;)
+	{
+		// Find the next thing in blocklinks order that could touch.
+		// Callbacks can change tmthing, so read it every time.
+		for (; i >= 0; i--)
+		{
+			const blockthing_t *bt = &bc->things[i];
+
+			if (!bt->mobj)
+				continue;
+			if (!tmthing)
+				break;
+			if (abs(bt->x - tmx) < bt->radius + tmthing->radius
+			&& abs(bt->y - tmy) < bt->radius + tmthing->radius)
+				break;
+		}
+		if (i < 0)
+			return true;
+		mobj = bc->things[i].mobj;
+
+		P_SetTarget(&bnext, mobj->bnext); // as in P_BlockThingsChain
+		if (!func(mobj))
+		{
+			P_SetTarget(&bnext, NULL);
+			return false;
+		}
+		if (P_MobjWasRemoved(tmthing) || !bnext || P_MobjWasRemoved(bnext))
+		{
+			P_SetTarget(&bnext, NULL);
+			return true;
+		}
+
+		// Carry on from bnext, even if func moved it to another cell.
+		// If it left the blockmap, only its old chain says what's next.
+		if (bnext->blockcell < 0)
+		{
+			mobj = bnext;
+			P_SetTarget(&bnext, NULL);
+			return P_BlockThingsChain(mobj, func);
+		}
+		bc = &blockthings[bnext->blockcell];
+		i = bnext->blockindex;
+		P_SetTarget(&bnext, NULL);
+	}
+}
+
 //
 // INTERCEPT ROUTINES
 //
@@ -61,7 +61,11 @@ extern ffloor_t *openfloorrover, *openceilingrover;
 void P_LineOpening(line_t *plinedef, mobj_t *mobj);
 
 boolean P_BlockLinesIterator(INT32 x, INT32 y, boolean(*func)(line_t *));
+boolean P_BlockLinesIteratorBox(INT32 x, INT32 y, const fixed_t *bbox, boolean(*func)(line_t *));
+void P_BuildBlockLineBoxes(void);
 boolean P_BlockThingsIterator(INT32 x, INT32 y, boolean(*func)(mobj_t *));
+boolean P_BlockThingsIteratorNear(INT32 x, INT32 y, boolean(*func)(mobj_t *));
+void P_UpdateBlockThing(mobj_t *thing);
 
 #define PT_ADDLINES     1
 #define PT_ADDTHINGS    2
@@ -30,6 +30,7 @@
 #include "info.h"
 #include "i_video.h"
 #include "lua_hook.h"
+#include "lua_script.h"
 #include "b_bot.h"
 #include "p_slopes.h"
 #include "f_finale.h"
@@ -6396,6 +6397,7 @@ void P_SetScale(mobj_t *mobj, fixed_t newscale)
 
 	mobj->radius = FixedMul(FixedDiv(mobj->radius, oldscale), newscale);
 	mobj->height = FixedMul(FixedDiv(mobj->height, oldscale), newscale);
+	P_UpdateBlockThing(mobj);
 
 	player = mobj->player;
 
@@ -10024,6 +10026,8 @@ void P_MobjThinker(mobj_t *mobj)
 	I_Assert(mobj != NULL);
 	I_Assert(!P_MobjWasRemoved(mobj));
 
+	P_UpdateMobjSynchHash(mobj);
+
 	if (mobj->flags & MF_NOTHINK)
 		return;
 
@@ -10452,6 +10456,76 @@ static fixed_t P_DefaultMobjShadowScale (mobj_t *thing)
 	}
 }
 
+//
+// Mobj pool
+//
+// Mobjs are carved out of big PU_LEVEL chunks instead of being allocated
+// one by one, so that the mobj thinker list mostly walks through memory in
+// order. Freed mobjs go on a free list, linked through thinker.next, and
+// get handed out again before a new chunk is started.
+//
+#define MOBJCHUNKSIZE 256
+
+static mobj_t *mobjchunk = NULL; // chunk currently being handed out
+static size_t mobjchunkused = 0;
+static mobj_t *mobjfreelist = NULL;
+
+/** Gets a zeroed mobj from the pool.
+  * Its address stays valid until it's given back with P_FreeMobj or the level ends.
+  *
+  * \return The new mobj.
+  */
+mobj_t *P_AllocMobj(void)
+{
+	mobj_t *mobj;
+
+	if (mobjfreelist)
+	{
+		mobj = mobjfreelist;
+		mobjfreelist = (mobj_t *)mobj->thinker.next;
+	}
+	else
+	{
+		if (!mobjchunk || mobjchunkused == MOBJCHUNKSIZE)
+		{
+			mobjchunk = Z_Malloc(MOBJCHUNKSIZE * sizeof (*mobjchunk), PU_LEVEL, NULL);
+			mobjchunkused = 0;
+		}
+		mobj = &mobjchunk[mobjchunkused++];
+	}
+
+	memset(mobj, 0, sizeof (*mobj));
+	mobj->blockcell = -1;
+	return mobj;
+}
+
+/** Gives a mobj from P_AllocMobj back to the pool.
+  *
+  * \param mobj The mobj, which must no longer be in any thinker list.
+  */
+void P_FreeMobj(mobj_t *mobj)
+{
+#ifdef PARANOIA
+	memset(mobj, 0xff, sizeof (*mobj));
+#endif
+	// Lua handles to it must not follow it into its next life
+	LUA_InvalidateUserdata(mobj);
+
+	// keep it looking removed to anything still holding on to it
+	mobj->thinker.function.acp1 = (actionf_p1)P_RemoveThinkerDelayed;
+	mobj->thinker.next = (thinker_t *)mobjfreelist;
+	mobjfreelist = mobj;
+}
+
+/** Forgets about every pooled mobj.
+  * Call this right after the PU_LEVEL chunks have been purged.
+  */
+void P_ClearMobjPool(void)
+{
+	mobjchunk = mobjfreelist = NULL;
+	mobjchunkused = 0;
+}
+
 //
 // P_SpawnMobj
 //
@@ -10460,7 +10534,7 @@ mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
 	const mobjinfo_t *info = &mobjinfo[type];
 	SINT8 sc = -1;
 	state_t *st;
-	mobj_t *mobj = Z_Calloc(sizeof (*mobj), PU_LEVEL, NULL);
+	mobj_t *mobj = P_AllocMobj();
 
 	// this is officially a mobj, declared as soon as possible.
 	mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
@@ -10923,6 +10997,9 @@ void P_RemoveMobj(mobj_t *mobj)
 	LUAh_MobjRemoved(mobj);
 	mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker; // needed for P_UnsetThingPosition, etc. to work.
 
+	synch_mobjhash -= mobj->synchhash;
+	mobj->synchhash = 0;
+
 	// Rings only, please!
 	if (mobj->spawnpoint &&
 		(mobj->type == MT_RING
@@ -10991,7 +11068,7 @@ void P_RemoveMobj(mobj_t *mobj)
 		INT32 prevreferences;
 		if (!mobj->thinker.references)
 		{
-			Z_Free(mobj); // No refrrences? Can be removed immediately! :D
+			P_FreeMobj(mobj); // No refrrences? Can be removed immediately! :D
 			return;
 		}
 
@@ -11415,6 +11492,7 @@ void P_SpawnPlayer(INT32 playernum)
 	// Set bounds accurately.
 	mobj->radius = FixedMul(skins[p->skin].radius, mobj->scale);
 	mobj->height = P_GetPlayerHeight(p);
+	P_UpdateBlockThing(mobj);
 
 	if (!leveltime && !p->spectator && ((maptol & TOL_NIGHTS) == TOL_NIGHTS) != (G_IsSpecialStage(gamemap))) // non-special NiGHTS stage or special non-NiGHTS stage
 	{
@@ -12421,7 +12499,10 @@ static boolean P_SetupNiGHTSDrone(mapthing_t* mthing, mobj_t* mobj)
 		mobj->health = timelimit;
 
 	if (hitboxradius > 0)
+	{
 		mobj->radius = hitboxradius;
+		P_UpdateBlockThing(mobj);
+	}
 
 	if (hitboxheight > 0)
 		mobj->height = hitboxheight;
@@ -12843,7 +12924,10 @@ static boolean P_SetupSpawnedMapThing(mapthing_t *mthing, mobj_t *mobj, boolean
 			mobj->flags2 |= MF2_AMBUSH;
 
 		if (mthing->angle > 0)
+		{
 			mobj->radius = (mthing->angle & 16383) << FRACBITS;
+			P_UpdateBlockThing(mobj);
+		}
 		// FALLTHRU
 	case MT_AXISTRANSFER:
 	case MT_AXISTRANSFERLINE:
@@ -318,6 +318,8 @@ typedef struct mobj_s
 	// Links in blocks (if needed).
 	struct mobj_s *bnext;
 	struct mobj_s **bprev; // killough 8/11/98: change to ptr-to-ptr
+	INT32 blockcell; // index into blockthings, -1 when not in the blockmap
+	INT32 blockindex; // and into that cell's things
 
 	// Additional pointers for NiGHTS hoops
 	struct mobj_s *hnext;
@@ -376,6 +378,8 @@ typedef struct mobj_s
 	boolean mirrored; // The object's rotations will be mirrored left to right, e.g., see frame AL from the right and AR from the left
 	fixed_t shadowscale; // If this object casts a shadow, and the size relative to radius
 
+	UINT32 synchhash; // This mobj's part of synch_mobjhash. Not saved; see P_RefreshSynchHashes.
+
 	// WARNING: New fields must be added separately to savegame and Lua.
 } mobj_t;
 
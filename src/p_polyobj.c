@@ -1366,6 +1366,9 @@ void Polyobj_InitLevel(void)
 			Polyobj_linkToBlockmap(&PolyObjects[i]);
 	}
 
+	// polyobject lines move, so they can't be prefiltered
+	P_BuildBlockLineBoxes();
+
 #if 0
 	// haleyjd 02/22/06: temporary debug
 	printf("DEBUG: numPolyObjects = %d\n", numPolyObjects);
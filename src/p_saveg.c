@@ -2367,6 +2367,55 @@ static void P_NetArchiveThinkers(void)
 	}
 }
 
+// While a netgame is being loaded, mobjs are looked up by their saved
+// mobjnum through this table, instead of searching the whole mobj list
+// for every pointer that needs relinking. It's open addressed, with a
+// power of two size.
+static mobj_t **mobjnumindex = NULL;
+static UINT32 mobjnumindexmask;
+
+#define MOBJNUMHASH(num) (((num) * 2654435761u) & mobjnumindexmask)
+
+static void P_BuildMobjnumIndex(void)
+{
+	thinker_t *th;
+	mobj_t *mobj;
+	UINT32 count = 0, size = 16, slot;
+
+	for (th = thlist[THINK_MOBJ].next; th != &thlist[THINK_MOBJ]; th = th->next)
+		if (th->function.acp1 != (actionf_p1)P_RemoveThinkerDelayed)
+			count++;
+
+	while (size < count*2)
+		size <<= 1;
+
+	mobjnumindex = Z_Calloc(size * sizeof (*mobjnumindex), PU_STATIC, NULL);
+	mobjnumindexmask = size - 1;
+
+	for (th = thlist[THINK_MOBJ].next; th != &thlist[THINK_MOBJ]; th = th->next)
+	{
+		if (th->function.acp1 == (actionf_p1)P_RemoveThinkerDelayed)
+			continue;
+
+		mobj = (mobj_t *)th;
+		if (!mobj->mobjnum)
+			continue;
+
+		// The first mobj in the list wins, as it would with a search.
+		for (slot = MOBJNUMHASH(mobj->mobjnum); mobjnumindex[slot]; slot = (slot + 1) & mobjnumindexmask)
+			if (mobjnumindex[slot]->mobjnum == mobj->mobjnum)
+				break;
+		if (!mobjnumindex[slot])
+			mobjnumindex[slot] = mobj;
+	}
+}
+
+static void P_FreeMobjnumIndex(void)
+{
+	Z_Free(mobjnumindex);
+	mobjnumindex = NULL;
+}
+
 // Now save the pointers, tracer and target, but at load time we must
 // relink to this; the savegame contains the old position in the pointer
 // field copyed in the info field temporarily, but finally we just search
@@ -2376,6 +2425,18 @@ mobj_t *P_FindNewPosition(UINT32 oldposition)
 	thinker_t *th;
 	mobj_t *mobj;
 
+	if (mobjnumindex)
+	{
+		UINT32 slot;
+
+		for (slot = MOBJNUMHASH(oldposition); (mobj = mobjnumindex[slot]) != NULL; slot = (slot + 1) & mobjnumindexmask)
+			if (mobj->mobjnum == oldposition)
+				return mobj;
+
+		CONS_Debug(DBG_GAMELOGIC, "mobj not found\n");
+		return NULL;
+	}
+
 	for (th = thlist[THINK_MOBJ].next; th != &thlist[THINK_MOBJ]; th = th->next)
 	{
 		if (th->function.acp1 == (actionf_p1)P_RemoveThinkerDelayed)
@@ -2473,13 +2534,13 @@ static thinker_t* LoadMobjThinker(actionf_p1 thinker)
 			return NULL;
 		}
 
-		mobj = Z_Calloc(sizeof (*mobj), PU_LEVEL, NULL);
+		mobj = P_AllocMobj();
 
 		mobj->spawnpoint = &mapthings[spawnpointnum];
 		mapthings[spawnpointnum].mobj = mobj;
 	}
 	else
-		mobj = Z_Calloc(sizeof (*mobj), PU_LEVEL, NULL);
+		mobj = P_AllocMobj();
 
 	// declare this as a valid mobj as soon as possible.
 	mobj->thinker.function.acp1 = thinker;
@@ -3290,6 +3351,8 @@ static void P_NetUnArchiveThinkers(void)
 
 			if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
 				P_RemoveSavegameMobj((mobj_t *)currentthinker); // item isn't saved, don't remove it
+			else if (i == THINK_MOBJ)
+				P_FreeMobj((mobj_t *)currentthinker);
 			else
 				Z_Free(currentthinker);
 		}
@@ -3493,6 +3556,8 @@ static void P_NetUnArchiveThinkers(void)
 		CONS_Debug(DBG_NETPLAY, "%u thinkers loaded in list %d\n", numloaded, i);
 	}
 
+	P_BuildMobjnumIndex();
+
 	if (restoreNum)
 	{
 		executor_t *delay = NULL;
@@ -4119,8 +4184,11 @@ boolean P_LoadNetGame(void)
 		P_NetUnArchiveWaypoints();
 		P_RelinkPointers();
 		P_FinishMobjs();
+		P_RefreshSynchHashes();
 	}
 	LUA_UnArchive();
+	if (mobjnumindex)
+		P_FreeMobjnumIndex();
 
 	// This is stupid and hacky, but maybe it'll work!
 	P_SetRandSeed(P_GetInitSeed());
@@ -25,6 +25,7 @@
 #include "i_video.h" // for I_FinishUpdate()..
 #include "r_sky.h"
 #include "i_system.h"
+#include "i_threads.h"
 
 #include "r_data.h"
 #include "r_things.h" // for R_AddSpriteDefs
@@ -128,6 +129,7 @@ INT32 *blockmaplump; // Big blockmap
 fixed_t bmaporgx, bmaporgy;
 // for thing chains
 mobj_t **blocklinks;
+blockcell_t *blockthings;
 
 // REJECT
 // For fast sight rejection.
@@ -1383,252 +1385,679 @@ static void P_LoadThings(UINT8 *data)
 	}
 }
 
-// Stores positions for relevant map data spread through a TEXTMAP.
-UINT32 mapthingsPos[UINT16_MAX];
-UINT32 linesPos[UINT16_MAX];
-UINT32 sidesPos[UINT16_MAX];
-UINT32 vertexesPos[UINT16_MAX];
-UINT32 sectorsPos[UINT16_MAX];
+// Every UDMF keyword the TEXTMAP loader understands. Tokens are looked up
+// once, straight out of the lump, through a perfect hash of these names.
+typedef enum
+{
+	TMK_UNKNOWN = 0,
+
+	TMK_NAMESPACE,
+	// Blocks, in the same order as the textmap index's block lists.
+	TMK_THING,
+	TMK_LINEDEF,
+	TMK_SIDEDEF,
+	TMK_VERTEX,
+	TMK_SECTOR,
+
+	// Fields
+	TMK_X,
+	TMK_Y,
+	TMK_ZFLOOR,
+	TMK_ZCEILING,
+	TMK_HEIGHTFLOOR,
+	TMK_HEIGHTCEILING,
+	TMK_TEXTUREFLOOR,
+	TMK_TEXTURECEILING,
+	TMK_LIGHTLEVEL,
+	TMK_SPECIAL,
+	TMK_ID,
+	TMK_XPANNINGFLOOR,
+	TMK_YPANNINGFLOOR,
+	TMK_XPANNINGCEILING,
+	TMK_YPANNINGCEILING,
+	TMK_ROTATIONFLOOR,
+	TMK_ROTATIONCEILING,
+	TMK_OFFSETX,
+	TMK_OFFSETY,
+	TMK_TEXTURETOP,
+	TMK_TEXTUREBOTTOM,
+	TMK_TEXTUREMIDDLE,
+	TMK_REPEATCNT,
+	TMK_V1,
+	TMK_V2,
+	TMK_SIDEFRONT,
+	TMK_SIDEBACK,
+	TMK_BLOCKING,
+	TMK_BLOCKMONSTERS,
+	TMK_TWOSIDED,
+	TMK_DONTPEGTOP,
+	TMK_DONTPEGBOTTOM,
+	TMK_SKEWTD,
+	TMK_NOCLIMB,
+	TMK_NOSKEW,
+	TMK_MIDPEG,
+	TMK_MIDSOLID,
+	TMK_WRAPMIDTEX,
+	TMK_EFFECT6,
+	TMK_NONET,
+	TMK_NETONLY,
+	TMK_BOUNCY,
+	TMK_TRANSFER,
+	TMK_HEIGHT,
+	TMK_ANGLE,
+	TMK_TYPE,
+	TMK_EXTRA,
+	TMK_FLIP,
+	TMK_AMBUSH,
+
+	NUMTEXTMAPKEYS
+} textmapkey_t;
+
+static const char *const textmapkeynames[NUMTEXTMAPKEYS] = {
+	NULL,
+
+	"namespace",
+	"thing",
+	"linedef",
+	"sidedef",
+	"vertex",
+	"sector",
+
+	"x",
+	"y",
+	"zfloor",
+	"zceiling",
+	"heightfloor",
+	"heightceiling",
+	"texturefloor",
+	"textureceiling",
+	"lightlevel",
+	"special",
+	"id",
+	"xpanningfloor",
+	"ypanningfloor",
+	"xpanningceiling",
+	"ypanningceiling",
+	"rotationfloor",
+	"rotationceiling",
+	"offsetx",
+	"offsety",
+	"texturetop",
+	"texturebottom",
+	"texturemiddle",
+	"repeatcnt",
+	"v1",
+	"v2",
+	"sidefront",
+	"sideback",
+	"blocking",
+	"blockmonsters",
+	"twosided",
+	"dontpegtop",
+	"dontpegbottom",
+	"skewtd",
+	"noclimb",
+	"noskew",
+	"midpeg",
+	"midsolid",
+	"wrapmidtex",
+	"effect6",
+	"nonet",
+	"netonly",
+	"bouncy",
+	"transfer",
+	"height",
+	"angle",
+	"type",
+	"extra",
+	"flip",
+	"ambush",
+};
+
+#define NUMTEXTMAPBLOCKS (TMK_SECTOR - TMK_THING + 1)
+
+// FNV-1a, started from a seed picked so that no two of the names above
+// share a slot. Adding a keyword may need a new seed; TextmapInitKeys
+// will complain if so.
+#define TEXTMAPHASHBITS 7
+#define TEXTMAPHASHSEED 0x829d96
+
+static UINT8 textmaphash[1<<TEXTMAPHASHBITS];
+
+static UINT32 TextmapHashKey(const char *s, size_t len)
+{
+	UINT32 hash = TEXTMAPHASHSEED;
 
-// Determine total amount of map data in TEXTMAP.
-static boolean TextmapCount(UINT8 *data, size_t size)
+	while (len--)
+		hash = (hash ^ (UINT8)*s++) * 16777619u;
+
+	return hash >> (32 - TEXTMAPHASHBITS);
+}
+
+static void TextmapInitKeys(void)
+{
+	UINT8 key;
+
+	for (key = TMK_UNKNOWN + 1; key < NUMTEXTMAPKEYS; key++)
+	{
+		UINT32 slot = TextmapHashKey(textmapkeynames[key], strlen(textmapkeynames[key]));
+		if (textmaphash[slot])
+			I_Error("TextmapInitKeys: '%s' and '%s' share a slot, TEXTMAPHASHSEED needs to change", textmapkeynames[key], textmapkeynames[textmaphash[slot]]);
+		textmaphash[slot] = key;
+	}
+}
+
+static textmapkey_t TextmapLookupKey(const char *s, size_t len)
+{
+	UINT8 key = textmaphash[TextmapHashKey(s, len)];
+
+	if (key == TMK_UNKNOWN
+		|| strncmp(textmapkeynames[key], s, len) || textmapkeynames[key][len])
+		return TMK_UNKNOWN;
+
+	return key;
+}
+
+// Splits a TEXTMAP up the same way M_GetToken does, but hands back
+// pointers into the lump instead of copies.
+typedef struct
+{
+	const char *data;
+	size_t pos, size;
+
+	const char *tkn; // not NUL-terminated!
+	size_t len;
+	boolean quoted;
+} textmaptokenizer_t;
+
+static void TextmapStartTokens(textmaptokenizer_t *tok, const char *data, size_t size)
+{
+	const char *end = memchr(data, '\0', size);
+
+	tok->data = data;
+	tok->pos = 0;
+	tok->size = end ? (size_t)(end - data) : size;
+	tok->tkn = NULL;
+	tok->len = 0;
+	tok->quoted = false;
+}
+
+#define TEXTMAPCOMMENT(p, n, data) ((p) + 1 < (n) && (data)[p] == '/' && ((data)[(p)+1] == '/' || (data)[(p)+1] == '*'))
+
+static boolean TextmapNextToken(textmaptokenizer_t *tok)
+{
+	const char *data = tok->data;
+	size_t pos = tok->pos, size = tok->size, start;
+
+	// Skip whitespace, UDMF's = and ; separators, and comments.
+	while (pos < size)
+	{
+		char c = data[pos];
+
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '=' || c == ';')
+			pos++;
+		else if (!TEXTMAPCOMMENT(pos, size, data))
+			break;
+		else if (data[pos+1] == '/')
+		{
+			while (pos < size && data[pos] != '\n')
+				pos++;
+		}
+		else
+		{
+			for (pos += 2; pos + 1 < size && !(data[pos] == '*' && data[pos+1] == '/'); pos++)
+				;
+			pos = min(pos + 2, size);
+		}
+	}
+
+	tok->quoted = false;
+
+	if (pos >= size)
+	{
+		tok->pos = size;
+		tok->tkn = NULL;
+		tok->len = 0;
+		return false;
+	}
+
+	if (data[pos] == ',' || data[pos] == '{' || data[pos] == '}')
+		start = pos++;
+	else if (data[pos] == '"')
+	{
+		// Everything within quotes, except the quotes.
+		start = ++pos;
+		while (pos < size && data[pos] != '"')
+			pos++;
+		tok->quoted = true;
+		tok->tkn = data + start;
+		tok->len = pos - start;
+		tok->pos = min(pos + 1, size);
+		return true;
+	}
+	else
+	{
+		start = pos++;
+		while (pos < size
+			&& data[pos] != ' ' && data[pos] != '\t' && data[pos] != '\r' && data[pos] != '\n'
+			&& data[pos] != ',' && data[pos] != '{' && data[pos] != '}'
+			&& data[pos] != '=' && data[pos] != ';'
+			&& !TEXTMAPCOMMENT(pos, size, data))
+			pos++;
+	}
+
+	tok->tkn = data + start;
+	tok->len = pos - start;
+	tok->pos = pos;
+	return true;
+}
+
+#undef TEXTMAPCOMMENT
+
+// Is the current token this exact (unquoted) punctuation?
+#define TextmapTokenIsChar(tok, c) (!(tok)->quoted && (tok)->len == 1 && (tok)->tkn[0] == (c))
+
+// One "key = value;" out of a block, with the value left in the lump.
+typedef struct
+{
+	UINT8 key; // textmapkey_t
+	UINT32 val, len;
+} textmapfield_t;
+
+typedef struct
+{
+	UINT32 first, count; // into the index's fields
+} textmapblock_t;
+
+// Everything TextmapIndex found in a TEXTMAP, ready to be applied.
+typedef struct
+{
+	const char *data;
+
+	textmapfield_t *fields;
+	size_t numfields, maxfields;
+
+	textmapblock_t *blocks[NUMTEXTMAPBLOCKS];
+	size_t numblocks[NUMTEXTMAPBLOCKS], maxblocks[NUMTEXTMAPBLOCKS];
+} textmapindex_t;
+
+static textmapindex_t textmapindex;
+
+static void TextmapFreeIndex(textmapindex_t *index)
+{
+	size_t i;
+
+	if (index->fields)
+		Z_Free(index->fields);
+	for (i = 0; i < NUMTEXTMAPBLOCKS; i++)
+		if (index->blocks[i])
+			Z_Free(index->blocks[i]);
+
+	memset(index, 0, sizeof (*index));
+}
+
+static textmapblock_t *TextmapAddBlock(textmapindex_t *index, size_t kind)
+{
+	textmapblock_t *block;
+
+	if (index->numblocks[kind] == index->maxblocks[kind])
+	{
+		index->maxblocks[kind] = index->maxblocks[kind] ? index->maxblocks[kind]*2 : 1024;
+		index->blocks[kind] = Z_Realloc(index->blocks[kind], index->maxblocks[kind] * sizeof (textmapblock_t), PU_STATIC, NULL);
+	}
+
+	block = &index->blocks[kind][index->numblocks[kind]++];
+	block->first = (UINT32)index->numfields;
+	block->count = 0;
+	return block;
+}
+
+static void TextmapAddField(textmapindex_t *index, textmapblock_t *block, textmapkey_t key, const textmaptokenizer_t *val)
+{
+	textmapfield_t *field;
+
+	if (index->numfields == index->maxfields)
+	{
+		index->maxfields = index->maxfields ? index->maxfields*2 : 8192;
+		index->fields = Z_Realloc(index->fields, index->maxfields * sizeof (textmapfield_t), PU_STATIC, NULL);
+	}
+
+	field = &index->fields[index->numfields++];
+	field->key = (UINT8)key;
+	field->val = (UINT32)(val->tkn - index->data);
+	field->len = (UINT32)val->len;
+	block->count++;
+}
+
+// Reads the { ... } after a block keyword into the index.
+static boolean TextmapIndexBlock(textmapindex_t *index, textmaptokenizer_t *tok, textmapkey_t kind)
+{
+	textmapblock_t *block = TextmapAddBlock(index, kind - TMK_THING);
+	size_t pos = tok->pos;
+
+	if (!TextmapNextToken(tok) || !TextmapTokenIsChar(tok, '{'))
+	{
+		// Leave it at its defaults, and carry on from whatever this was.
+		CONS_Alert(CONS_WARNING, "Invalid UDMF data capsule!\n");
+		tok->pos = pos;
+		return true;
+	}
+
+	while (true)
+	{
+		textmapkey_t key;
+
+		if (!TextmapNextToken(tok))
+			return false;
+		if (TextmapTokenIsChar(tok, '}'))
+			return true;
+
+		key = tok->quoted ? TMK_UNKNOWN : TextmapLookupKey(tok->tkn, tok->len);
+
+		if (!TextmapNextToken(tok))
+			return false;
+
+		// Fields nobody reads are dropped here.
+		if (key != TMK_UNKNOWN)
+			TextmapAddField(index, block, key, tok);
+	}
+}
+
+/** Goes through a TEXTMAP once, counting its blocks and noting down where
+  * every field's value is, without copying anything out of the lump.
+  *
+  * \param index Filled in with the blocks and fields found.
+  * \param data TEXTMAP lump, which has to outlive the index.
+  * \param size Size of the lump.
+  * \return false if the lump is unusable.
+  */
+static boolean TextmapIndex(textmapindex_t *index, const char *data, size_t size)
 {
-	char *tkn = M_GetToken((char *)data);
-	UINT8 brackets = 0;
+	textmaptokenizer_t tok;
+	size_t depth = 0;
 
-	nummapthings = 0;
-	numlines = 0;
-	numsides = 0;
-	numvertexes = 0;
-	numsectors = 0;
+	if (!textmaphash[TextmapHashKey("namespace", 9)])
+		TextmapInitKeys();
+
+	memset(index, 0, sizeof (*index));
+	index->data = data;
+	TextmapStartTokens(&tok, data, size);
 
 	// Look for namespace at the beginning.
-	if (!fastcmp(tkn, "namespace"))
+	if (!TextmapNextToken(&tok) || tok.quoted || TextmapLookupKey(tok.tkn, tok.len) != TMK_NAMESPACE)
 	{
-		Z_Free(tkn);
 		CONS_Alert(CONS_ERROR, "No namespace at beginning of lump!\n");
 		return false;
 	}
-	Z_Free(tkn);
 
 	// Check if namespace is valid.
-	tkn = M_GetToken(NULL);
-	if (!fastcmp(tkn, "srb2"))
-		CONS_Alert(CONS_WARNING, "Invalid namespace '%s', only 'srb2' is supported.\n", tkn);
-	Z_Free(tkn);
+	if (!TextmapNextToken(&tok))
+		CONS_Alert(CONS_WARNING, "Invalid namespace '', only 'srb2' is supported.\n");
+	else if (tok.len != 4 || strncmp(tok.tkn, "srb2", 4))
+		CONS_Alert(CONS_WARNING, "Invalid namespace '%.*s', only 'srb2' is supported.\n", (int)tok.len, tok.tkn);
 
-	tkn = M_GetToken(NULL);
-	while (tkn && M_GetTokenPos() < size)
+	while (TextmapNextToken(&tok))
 	{
+		textmapkey_t key;
+
 		// Avoid anything inside bracketed stuff, only look for external keywords.
-		if (brackets)
+		if (depth)
 		{
-			if (fastcmp(tkn, "}"))
-				brackets--;
+			if (TextmapTokenIsChar(&tok, '{'))
+				depth++;
+			else if (TextmapTokenIsChar(&tok, '}'))
+				depth--;
+			continue;
+		}
+		else if (TextmapTokenIsChar(&tok, '{'))
+		{
+			depth++;
+			continue;
 		}
-		else if (fastcmp(tkn, "{"))
-			brackets++;
+
+		key = tok.quoted ? TMK_UNKNOWN : TextmapLookupKey(tok.tkn, tok.len);
+
 		// Check for valid fields.
-		else if (fastcmp(tkn, "thing"))
-			mapthingsPos[nummapthings++] = M_GetTokenPos();
-		else if (fastcmp(tkn, "linedef"))
-			linesPos[numlines++] = M_GetTokenPos();
-		else if (fastcmp(tkn, "sidedef"))
-			sidesPos[numsides++] = M_GetTokenPos();
-		else if (fastcmp(tkn, "vertex"))
-			vertexesPos[numvertexes++] = M_GetTokenPos();
-		else if (fastcmp(tkn, "sector"))
-			sectorsPos[numsectors++] = M_GetTokenPos();
+		if (key >= TMK_THING && key <= TMK_SECTOR)
+		{
+			if (!TextmapIndexBlock(index, &tok, key))
+			{
+				depth = 1;
+				break;
+			}
+		}
 		else
-			CONS_Alert(CONS_NOTICE, "Unknown field '%s'.\n", tkn);
-
-		Z_Free(tkn);
-		tkn = M_GetToken(NULL);
+			CONS_Alert(CONS_NOTICE, "Unknown field '%.*s'.\n", (int)tok.len, tok.tkn);
 	}
 
-	Z_Free(tkn);
-
-	if (brackets)
+	if (depth)
 	{
 		CONS_Alert(CONS_ERROR, "Unclosed brackets detected in textmap lump.\n");
+		TextmapFreeIndex(index);
 		return false;
 	}
 
 	return true;
 }
 
-static void ParseTextmapVertexParameter(UINT32 i, char *param, char *val)
+// Determine total amount of map data in TEXTMAP.
+static boolean TextmapCount(UINT8 *data, size_t size)
+{
+	TextmapFreeIndex(&textmapindex); // in case the last load was cut short
+
+	if (!TextmapIndex(&textmapindex, (const char *)data, size))
+		return false;
+
+	nummapthings = textmapindex.numblocks[TMK_THING - TMK_THING];
+	numlines = textmapindex.numblocks[TMK_LINEDEF - TMK_THING];
+	numsides = textmapindex.numblocks[TMK_SIDEDEF - TMK_THING];
+	numvertexes = textmapindex.numblocks[TMK_VERTEX - TMK_THING];
+	numsectors = textmapindex.numblocks[TMK_SECTOR - TMK_THING];
+
+	return true;
+}
+
+static void ParseTextmapVertexParameter(UINT32 i, UINT8 key, const char *val)
 {
-	if (fastcmp(param, "x"))
+	switch (key)
+	{
+	case TMK_X:
 		vertexes[i].x = FLOAT_TO_FIXED(atof(val));
-	else if (fastcmp(param, "y"))
+		break;
+	case TMK_Y:
 		vertexes[i].y = FLOAT_TO_FIXED(atof(val));
-	else if (fastcmp(param, "zfloor"))
-	{
+		break;
+	case TMK_ZFLOOR:
 		vertexes[i].floorz = FLOAT_TO_FIXED(atof(val));
 		vertexes[i].floorzset = true;
-	}
-	else if (fastcmp(param, "zceiling"))
-	{
+		break;
+	case TMK_ZCEILING:
 		vertexes[i].ceilingz = FLOAT_TO_FIXED(atof(val));
 		vertexes[i].ceilingzset = true;
+		break;
 	}
 }
 
-static void ParseTextmapSectorParameter(UINT32 i, char *param, char *val)
+static void ParseTextmapSectorParameter(UINT32 i, UINT8 key, const char *val)
 {
-	if (fastcmp(param, "heightfloor"))
+	switch (key)
+	{
+	case TMK_HEIGHTFLOOR:
 		sectors[i].floorheight = atol(val) << FRACBITS;
-	else if (fastcmp(param, "heightceiling"))
+		break;
+	case TMK_HEIGHTCEILING:
 		sectors[i].ceilingheight = atol(val) << FRACBITS;
-	if (fastcmp(param, "texturefloor"))
+		break;
+	case TMK_TEXTUREFLOOR:
 		sectors[i].floorpic = P_AddLevelFlat(val, foundflats);
-	else if (fastcmp(param, "textureceiling"))
+		break;
+	case TMK_TEXTURECEILING:
 		sectors[i].ceilingpic = P_AddLevelFlat(val, foundflats);
-	else if (fastcmp(param, "lightlevel"))
+		break;
+	case TMK_LIGHTLEVEL:
 		sectors[i].lightlevel = atol(val);
-	else if (fastcmp(param, "special"))
+		break;
+	case TMK_SPECIAL:
 		sectors[i].special = atol(val);
-	else if (fastcmp(param, "id"))
+		break;
+	case TMK_ID:
 		sectors[i].tag = atol(val);
-	else if (fastcmp(param, "xpanningfloor"))
+		break;
+	case TMK_XPANNINGFLOOR:
 		sectors[i].floor_xoffs = FLOAT_TO_FIXED(atof(val));
-	else if (fastcmp(param, "ypanningfloor"))
+		break;
+	case TMK_YPANNINGFLOOR:
 		sectors[i].floor_yoffs = FLOAT_TO_FIXED(atof(val));
-	else if (fastcmp(param, "xpanningceiling"))
+		break;
+	case TMK_XPANNINGCEILING:
 		sectors[i].ceiling_xoffs = FLOAT_TO_FIXED(atof(val));
-	else if (fastcmp(param, "ypanningceiling"))
+		break;
+	case TMK_YPANNINGCEILING:
 		sectors[i].ceiling_yoffs = FLOAT_TO_FIXED(atof(val));
-	else if (fastcmp(param, "rotationfloor"))
+		break;
+	case TMK_ROTATIONFLOOR:
 		sectors[i].floorpic_angle = FixedAngle(FLOAT_TO_FIXED(atof(val)));
-	else if (fastcmp(param, "rotationceiling"))
+		break;
+	case TMK_ROTATIONCEILING:
 		sectors[i].ceilingpic_angle = FixedAngle(FLOAT_TO_FIXED(atof(val)));
+		break;
+	}
 }
 
-static void ParseTextmapSidedefParameter(UINT32 i, char *param, char *val)
+static void ParseTextmapSidedefParameter(UINT32 i, UINT8 key, const char *val)
 {
-	if (fastcmp(param, "offsetx"))
+	switch (key)
+	{
+	case TMK_OFFSETX:
 		sides[i].textureoffset = atol(val)<<FRACBITS;
-	else if (fastcmp(param, "offsety"))
+		break;
+	case TMK_OFFSETY:
 		sides[i].rowoffset = atol(val)<<FRACBITS;
-	else if (fastcmp(param, "texturetop"))
+		break;
+	case TMK_TEXTURETOP:
 		sides[i].toptexture = R_TextureNumForName(val);
-	else if (fastcmp(param, "texturebottom"))
+		break;
+	case TMK_TEXTUREBOTTOM:
 		sides[i].bottomtexture = R_TextureNumForName(val);
-	else if (fastcmp(param, "texturemiddle"))
+		break;
+	case TMK_TEXTUREMIDDLE:
 		sides[i].midtexture = R_TextureNumForName(val);
-	else if (fastcmp(param, "sector"))
+		break;
+	case TMK_SECTOR:
 		P_SetSidedefSector(i, atol(val));
-	else if (fastcmp(param, "repeatcnt"))
+		break;
+	case TMK_REPEATCNT:
 		sides[i].repeatcnt = atol(val);
+		break;
+	}
 }
 
-static void ParseTextmapLinedefParameter(UINT32 i, char *param, char *val)
+static void ParseTextmapLinedefParameter(UINT32 i, UINT8 key, const char *val)
 {
-	if (fastcmp(param, "id"))
+	INT32 flag = 0;
+
+	switch (key)
+	{
+	case TMK_ID:
 		lines[i].tag = atol(val);
-	else if (fastcmp(param, "special"))
+		return;
+	case TMK_SPECIAL:
 		lines[i].special = atol(val);
-	else if (fastcmp(param, "v1"))
+		return;
+	case TMK_V1:
 		P_SetLinedefV1(i, atol(val));
-	else if (fastcmp(param, "v2"))
+		return;
+	case TMK_V2:
 		P_SetLinedefV2(i, atol(val));
-	else if (fastcmp(param, "sidefront"))
+		return;
+	case TMK_SIDEFRONT:
 		lines[i].sidenum[0] = atol(val);
-	else if (fastcmp(param, "sideback"))
+		return;
+	case TMK_SIDEBACK:
 		lines[i].sidenum[1] = atol(val);
+		return;
 
 	// Flags
-	else if (fastcmp(param, "blocking") && fastcmp("true", val))
-		lines[i].flags |= ML_IMPASSIBLE;
-	else if (fastcmp(param, "blockmonsters") && fastcmp("true", val))
-		lines[i].flags |= ML_BLOCKMONSTERS;
-	else if (fastcmp(param, "twosided") && fastcmp("true", val))
-		lines[i].flags |= ML_TWOSIDED;
-	else if (fastcmp(param, "dontpegtop") && fastcmp("true", val))
-		lines[i].flags |= ML_DONTPEGTOP;
-	else if (fastcmp(param, "dontpegbottom") && fastcmp("true", val))
-		lines[i].flags |= ML_DONTPEGBOTTOM;
-	else if (fastcmp(param, "skewtd") && fastcmp("true", val))
-		lines[i].flags |= ML_EFFECT1;
-	else if (fastcmp(param, "noclimb") && fastcmp("true", val))
-		lines[i].flags |= ML_NOCLIMB;
-	else if (fastcmp(param, "noskew") && fastcmp("true", val))
-		lines[i].flags |= ML_EFFECT2;
-	else if (fastcmp(param, "midpeg") && fastcmp("true", val))
-		lines[i].flags |= ML_EFFECT3;
-	else if (fastcmp(param, "midsolid") && fastcmp("true", val))
-		lines[i].flags |= ML_EFFECT4;
-	else if (fastcmp(param, "wrapmidtex") && fastcmp("true", val))
-		lines[i].flags |= ML_EFFECT5;
-	else if (fastcmp(param, "effect6") && fastcmp("true", val))
-		lines[i].flags |= ML_EFFECT6;
-	else if (fastcmp(param, "nonet") && fastcmp("true", val))
-		lines[i].flags |= ML_NONET;
-	else if (fastcmp(param, "netonly") && fastcmp("true", val))
-		lines[i].flags |= ML_NETONLY;
-	else if (fastcmp(param, "bouncy") && fastcmp("true", val))
-		lines[i].flags |= ML_BOUNCY;
-	else if (fastcmp(param, "transfer") && fastcmp("true", val))
-		lines[i].flags |= ML_TFERLINE;
+	case TMK_BLOCKING:      flag = ML_IMPASSIBLE;     break;
+	case TMK_BLOCKMONSTERS: flag = ML_BLOCKMONSTERS;  break;
+	case TMK_TWOSIDED:      flag = ML_TWOSIDED;       break;
+	case TMK_DONTPEGTOP:    flag = ML_DONTPEGTOP;     break;
+	case TMK_DONTPEGBOTTOM: flag = ML_DONTPEGBOTTOM;  break;
+	case TMK_SKEWTD:        flag = ML_EFFECT1;        break;
+	case TMK_NOCLIMB:       flag = ML_NOCLIMB;        break;
+	case TMK_NOSKEW:        flag = ML_EFFECT2;        break;
+	case TMK_MIDPEG:        flag = ML_EFFECT3;        break;
+	case TMK_MIDSOLID:      flag = ML_EFFECT4;        break;
+	case TMK_WRAPMIDTEX:    flag = ML_EFFECT5;        break;
+	case TMK_EFFECT6:       flag = ML_EFFECT6;        break;
+	case TMK_NONET:         flag = ML_NONET;          break;
+	case TMK_NETONLY:       flag = ML_NETONLY;        break;
+	case TMK_BOUNCY:        flag = ML_BOUNCY;         break;
+	case TMK_TRANSFER:      flag = ML_TFERLINE;       break;
+	default:
+		return;
+	}
+
+	if (fastcmp("true", val))
+		lines[i].flags |= flag;
 }
 
-static void ParseTextmapThingParameter(UINT32 i, char *param, char *val)
+static void ParseTextmapThingParameter(UINT32 i, UINT8 key, const char *val)
 {
-	if (fastcmp(param, "x"))
+	INT32 flag = 0;
+
+	switch (key)
+	{
+	case TMK_X:
 		mapthings[i].x = atol(val);
-	else if (fastcmp(param, "y"))
+		return;
+	case TMK_Y:
 		mapthings[i].y = atol(val);
-	else if (fastcmp(param, "height"))
+		return;
+	case TMK_HEIGHT:
 		mapthings[i].z = atol(val);
-	else if (fastcmp(param, "angle"))
+		return;
+	case TMK_ANGLE:
 		mapthings[i].angle = atol(val);
-	else if (fastcmp(param, "type"))
+		return;
+	case TMK_TYPE:
 		mapthings[i].type = atol(val);
+		return;
 
 	// Flags
-	else if (fastcmp(param, "extra") && fastcmp("true", val))
-		mapthings[i].options |= MTF_EXTRA;
-	else if (fastcmp(param, "flip") && fastcmp("true", val))
-		mapthings[i].options |= MTF_OBJECTFLIP;
-	else if (fastcmp(param, "special") && fastcmp("true", val))
-		mapthings[i].options |= MTF_OBJECTSPECIAL;
-	else if (fastcmp(param, "ambush") && fastcmp("true", val))
-		mapthings[i].options |= MTF_AMBUSH;
+	case TMK_EXTRA:   flag = MTF_EXTRA;         break;
+	case TMK_FLIP:    flag = MTF_OBJECTFLIP;    break;
+	case TMK_SPECIAL: flag = MTF_OBJECTSPECIAL; break;
+	case TMK_AMBUSH:  flag = MTF_AMBUSH;        break;
+	default:
+		return;
+	}
+
+	if (fastcmp("true", val))
+		mapthings[i].options |= flag;
 }
 
-/** From a given position table, run a specified parser function through a {}-encapsuled text.
+/** Runs a specified parser function over the fields of an indexed block.
   *
-  * \param Position of the data to parse, in the textmap.
+  * \param Index the block was found in.
+  * \param Block to parse.
   * \param Structure number (mapthings, sectors, ...).
   * \param Parser function pointer.
   */
-static void TextmapParse(UINT32 dataPos, size_t num, void (*parser)(UINT32, char *, char *))
+static void TextmapParse(const textmapindex_t *index, const textmapblock_t *block, size_t num, void (*parser)(UINT32, UINT8, const char *))
 {
-	char *param, *val;
+	const textmapfield_t *field = &index->fields[block->first];
+	UINT32 count;
+	char val[256];
 
-	M_SetTokenPos(dataPos);
-	param = M_GetToken(NULL);
-	if (!fastcmp(param, "{"))
+	for (count = block->count; count--; field++)
 	{
-		Z_Free(param);
-		CONS_Alert(CONS_WARNING, "Invalid UDMF data capsule!\n");
-		return;
-	}
-	Z_Free(param);
-
-	while (true)
-	{
-		param = M_GetToken(NULL);
-		if (fastcmp(param, "}"))
-		{
-			Z_Free(param);
-			break;
-		}
-		val = M_GetToken(NULL);
-		parser(num, param, val);
-		Z_Free(param);
-		Z_Free(val);
+		// Values are short (names, numbers, true/false), so a copy on
+		// the stack is enough to hand them on NUL-terminated.
+		size_t len = min(field->len, sizeof val - 1);
+		M_Memcpy(val, index->data + field->val, len);
+		val[len] = '\0';
+		parser((UINT32)num, field->key, val);
 	}
 }
 
@@ -1683,7 +2112,7 @@ static void P_LoadTextmap(void)
 		vt->floorzset = vt->ceilingzset = false;
 		vt->floorz = vt->ceilingz = 0;
 
-		TextmapParse(vertexesPos[i], i, ParseTextmapVertexParameter);
+		TextmapParse(&textmapindex, &textmapindex.blocks[TMK_VERTEX - TMK_THING][i], i, ParseTextmapVertexParameter);
 
 		if (vt->x == INT32_MAX)
 			I_Error("P_LoadTextmap: vertex %s has no x value set!\n", sizeu1(i));
@@ -1710,7 +2139,7 @@ static void P_LoadTextmap(void)
 
 		sc->floorpic_angle = sc->ceilingpic_angle = 0;
 
-		TextmapParse(sectorsPos[i], i, ParseTextmapSectorParameter);
+		TextmapParse(&textmapindex, &textmapindex.blocks[TMK_SECTOR - TMK_THING][i], i, ParseTextmapSectorParameter);
 		P_InitializeSector(sc);
 		TextmapFixFlatOffsets(sc);
 	}
@@ -1725,7 +2154,7 @@ static void P_LoadTextmap(void)
 		ld->sidenum[0] = 0xffff;
 		ld->sidenum[1] = 0xffff;
 
-		TextmapParse(linesPos[i], i, ParseTextmapLinedefParameter);
+		TextmapParse(&textmapindex, &textmapindex.blocks[TMK_LINEDEF - TMK_THING][i], i, ParseTextmapLinedefParameter);
 
 		if (!ld->v1)
 			I_Error("P_LoadTextmap: linedef %s has no v1 value set!\n", sizeu1(i));
@@ -1748,7 +2177,7 @@ static void P_LoadTextmap(void)
 		sd->sector = NULL;
 		sd->repeatcnt = 0;
 
-		TextmapParse(sidesPos[i], i, ParseTextmapSidedefParameter);
+		TextmapParse(&textmapindex, &textmapindex.blocks[TMK_SIDEDEF - TMK_THING][i], i, ParseTextmapSidedefParameter);
 
 		if (!sd->sector)
 			I_Error("P_LoadTextmap: sidedef %s has no sector value set!\n", sizeu1(i));
@@ -1767,10 +2196,93 @@ static void P_LoadTextmap(void)
 		mt->extrainfo = 0;
 		mt->mobj = NULL;
 
-		TextmapParse(mapthingsPos[i], i, ParseTextmapThingParameter);
+		TextmapParse(&textmapindex, &textmapindex.blocks[TMK_THING - TMK_THING][i], i, ParseTextmapThingParameter);
 	}
+
+	TextmapFreeIndex(&textmapindex);
 }
 
+#ifdef DEVELOP
+/** Times the TEXTMAP tokenizer on a made-up map, next to M_GetToken
+  * going over the same text, so load speed can be checked without a big
+  * UDMF map at hand.
+  * Usage: textmapbench [linedefs]
+  */
+void Command_Textmapbench_f(void)
+{
+	size_t numlinedefs = 100000, numverts, numsidedefs, numthings, numsecs;
+	size_t i, j, size, tokens = 0, fields = 0;
+	textmapindex_t index;
+	char *buf, *p, *tkn;
+	char val[256];
+	UINT32 t, oldtime, indextime, valuetime;
+	INT32 sum = 0;
+
+	if (COM_Argc() > 1)
+		numlinedefs = max(atoi(COM_Argv(1)), 1);
+
+	numverts = min(numlinedefs + 1, 0xfffe);
+	numsidedefs = min(numlinedefs, 0xfffe);
+	numsecs = numlinedefs/64 + 1;
+	numthings = numlinedefs/10 + 1;
+
+	p = buf = Z_Malloc((numverts + numsidedefs + numlinedefs + numsecs + numthings) * 128 + 64, PU_STATIC, NULL);
+	p += sprintf(p, "namespace = \"srb2\";\n");
+	for (i = 0; i < numverts; i++)
+		p += sprintf(p, "vertex // %s\n{\nx = %d.000;\ny = %d.500;\n}\n", sizeu1(i), (INT32)(i % 256)*64, (INT32)(i / 256)*64);
+	for (i = 0; i < numsecs; i++)
+		p += sprintf(p, "sector\n{\nheightfloor = 0;\nheightceiling = 256;\ntexturefloor = \"FLOOR0_1\";\ntextureceiling = \"F_SKY1\";\nlightlevel = 192;\n}\n");
+	for (i = 0; i < numsidedefs; i++)
+		p += sprintf(p, "sidedef\n{\nsector = %s;\ntexturemiddle = \"GFZROCK\";\noffsetx = 16;\n}\n", sizeu1(i % numsecs));
+	for (i = 0; i < numlinedefs; i++)
+		p += sprintf(p, "linedef\n{\nv1 = %s;\nv2 = %s;\nsidefront = %s;\nblocking = true;\n}\n", sizeu1(i % numverts), sizeu2((i + 1) % numverts), sizeu3(i % numsidedefs));
+	for (i = 0; i < numthings; i++)
+		p += sprintf(p, "thing\n{\nx = %d;\ny = %d;\ntype = 1;\nangle = 90;\n}\n", (INT32)(i % 256)*64, (INT32)(i / 256)*64);
+	size = p - buf;
+
+	t = (UINT32)I_GetTimeMicros();
+	for (tkn = M_GetToken(buf); tkn; tkn = M_GetToken(NULL))
+	{
+		tokens++;
+		Z_Free(tkn);
+	}
+	oldtime = (UINT32)I_GetTimeMicros() - t;
+
+	t = (UINT32)I_GetTimeMicros();
+	if (!TextmapIndex(&index, buf, size))
+	{
+		Z_Free(buf);
+		return;
+	}
+	indextime = (UINT32)I_GetTimeMicros() - t;
+
+	// What TextmapParse does, minus touching the level.
+	t = (UINT32)I_GetTimeMicros();
+	for (i = 0; i < NUMTEXTMAPBLOCKS; i++)
+		for (j = 0; j < index.numblocks[i]; j++)
+		{
+			const textmapfield_t *field = &index.fields[index.blocks[i][j].first];
+			UINT32 count;
+
+			for (count = index.blocks[i][j].count; count--; field++, fields++)
+			{
+				size_t len = min(field->len, sizeof val - 1);
+				M_Memcpy(val, index.data + field->val, len);
+				val[len] = '\0';
+				sum += atol(val);
+			}
+		}
+	valuetime = (UINT32)I_GetTimeMicros() - t;
+
+	CONS_Printf("%s linedefs, %s bytes of TEXTMAP (checksum %d)\n", sizeu1(numlinedefs), sizeu2(size), sum);
+	CONS_Printf("M_GetToken:   %u.%03u ms for %s tokens\n", oldtime/1000, oldtime%1000, sizeu1(tokens));
+	CONS_Printf("TextmapIndex: %u.%03u ms, values %u.%03u ms, for %s fields\n", indextime/1000, indextime%1000, valuetime/1000, valuetime%1000, sizeu1(fields));
+
+	TextmapFreeIndex(&index);
+	Z_Free(buf);
+}
+#endif
+
 static void P_ProcessLinedefsAfterSidedefs(void)
 {
 	size_t i = numlines;
@@ -2349,6 +2861,7 @@ static boolean P_LoadBlockMap(UINT8 *data, size_t count)
 	// clear out mobj chains
 	count = sizeof (*blocklinks)* bmapwidth*bmapheight;
 	blocklinks = Z_Calloc(count, PU_LEVEL, NULL);
+	blockthings = Z_Calloc(sizeof (*blockthings) * bmapwidth * bmapheight, PU_LEVEL, NULL);
 	blockmap = blockmaplump+4;
 
 	// haleyjd 2/22/06: setup polyobject blockmap
@@ -2408,6 +2921,260 @@ static boolean LineInBlock(fixed_t cx1, fixed_t cy1, fixed_t cx2, fixed_t cy2, f
 	return P_BoxOnLineSide(bbox, &testline) == -1;
 }
 
+// Generated lookup tables get cached in srb2home, one folder per kind of
+// table, under the map's MD5.
+
+// What a generated lookup table depends on, as the map MD5 leaves out
+// VERTEXES for binary maps.
+static UINT32 P_MapGeometryChecksum(void)
+{
+	UINT32 sum = 2166136261u;
+	size_t i;
+
+#define MIX(v) sum = (sum ^ (UINT32)(v)) * 16777619u
+	for (i = 0; i < numlines; i++)
+	{
+		MIX(lines[i].v1->x); MIX(lines[i].v1->y);
+		MIX(lines[i].v2->x); MIX(lines[i].v2->y);
+		MIX(lines[i].frontsector ? lines[i].frontsector - sectors : -1);
+		MIX(lines[i].backsector ? lines[i].backsector - sectors : -1);
+		MIX(lines[i].flags & ML_TWOSIDED);
+	}
+	MIX(numvertexes);
+	MIX(numsubsectors);
+#undef MIX
+
+	return sum;
+}
+
+#ifndef NOMD5
+// Returns a va() string, so copy it if it needs to last.
+static char *P_MapCachePath(const char *kind, const char *ext)
+{
+	char md5hex[33];
+	size_t i;
+
+	for (i = 0; i < 16; i++)
+		sprintf(&md5hex[i*2], "%02x", mapmd5[i]);
+	return va("%s"PATHSEP"%s"PATHSEP"%s.%s", srb2home, kind, md5hex, ext);
+}
+#endif
+
+// A line's box of blocks, worked out once for every row it touches.
+typedef struct
+{
+	INT32 x, y, v2x, v2y; // map units, from the blockmap's origin
+	INT32 bxstart, bxend, bystart, byend;
+	boolean straight;
+} bmapline_t;
+
+typedef struct
+{
+	const bmapline_t *lines;
+	const INT32 *rowlines; // line numbers for each row, ascending
+	const size_t *firstrowline; // bmapheight+1 entries into rowlines
+	INT32 width;
+
+	// Each job's row, malloc'd: how many lines every block has,
+	// and all of them, block after block, ascending.
+	INT32 **cellcounts;
+	INT32 **celllines;
+} bmapbuild_t;
+
+static INT64 P_FloorDiv(INT64 a, INT64 b)
+{
+	INT64 q = a / b;
+	if ((a % b) && ((a < 0) != (b < 0)))
+		q--;
+	return q;
+}
+
+//
+// Fills in one row of blocks.
+//
+// Block numbers are worked out as y * bmapwidth + x, and x can be off
+// the ends of a row (the extra block straight lines get, or a too small
+// bmapwidth, see below), which puts the line in a block of the row above
+// or below. So rows take whatever lands on them, wherever it came from.
+//
+static void P_CreateBlockMapRow(void *userdata, size_t row, INT32 thread)
+{
+	bmapbuild_t *build = userdata;
+	const INT64 w = build->width;
+	const INT64 rowstart = (INT64)row * w;
+	INT32 *pairs = NULL, *newpairs; // block, line, block, line...
+	size_t numpairs = 0, maxpairs = 0, k;
+	INT32 *counts, *list;
+
+	(void)thread;
+
+	for (k = build->firstrowline[row]; k < build->firstrowline[row+1]; k++)
+	{
+		INT32 i = build->rowlines[k];
+		const bmapline_t *ln = &build->lines[i];
+		INT64 cy, cylo, cyhi;
+
+		// Only the block rows that can spill into this one.
+		cylo = max(ln->bystart, -P_FloorDiv(ln->bxend - rowstart, w));
+		cyhi = min(ln->byend, P_FloorDiv(rowstart + w - 1 - ln->bxstart, w));
+
+		for (cy = cylo; cy <= cyhi; cy++)
+		{
+			INT64 cx = max(ln->bxstart, rowstart - cy*w);
+			INT64 cxend = min(ln->bxend, rowstart + w - 1 - cy*w);
+
+			for (; cx <= cxend; cx++)
+			{
+				if (!ln->straight && !(LineInBlock((fixed_t)ln->x, (fixed_t)ln->y, (fixed_t)ln->v2x, (fixed_t)ln->v2y, (fixed_t)(cx << MAPBTOFRAC), (fixed_t)(cy << MAPBTOFRAC))))
+					continue;
+
+				if (numpairs + 2 > maxpairs)
+				{
+					newpairs = realloc(pairs, (maxpairs ? maxpairs*2 : 256) * sizeof (*pairs));
+					if (!newpairs)
+						goto outofmemory;
+					pairs = newpairs;
+					maxpairs = maxpairs ? maxpairs*2 : 256;
+				}
+				pairs[numpairs++] = (INT32)(cy*w + cx - rowstart);
+				pairs[numpairs++] = i;
+			}
+		}
+	}
+
+	// Sort by block, keeping each block's lines in order.
+	counts = calloc((size_t)w + 1, sizeof (*counts));
+	list = malloc(max(numpairs/2, 1) * sizeof (*list));
+	if (counts && list)
+	{
+		for (k = 0; k < numpairs; k += 2)
+			counts[pairs[k] + 1]++;
+		for (k = 0; k < (size_t)w; k++)
+			counts[k + 1] += counts[k];
+		for (k = 0; k < numpairs; k += 2)
+			list[counts[pairs[k]]++] = pairs[k + 1];
+
+		// counts[b] is now where block b ends, make it the count again.
+		for (k = (size_t)w; k > 0; k--)
+			counts[k] = counts[k - 1];
+		counts[0] = 0;
+		for (k = 0; k < (size_t)w; k++)
+			counts[k] = counts[k + 1] - counts[k];
+	}
+	else
+	{
+		free(counts);
+		free(list);
+		counts = list = NULL;
+	}
+
+	free(pairs);
+	build->cellcounts[row] = counts;
+	build->celllines[row] = list;
+	return;
+
+outofmemory:
+	// P_CreateBlockMap errors out on rows left without counts.
+	free(pairs);
+	build->cellcounts[row] = NULL;
+	build->celllines[row] = NULL;
+}
+
+#define BLOCKMAPCACHEMAGIC "SRB2BM01"
+#define BLOCKMAPCACHEHEADER (8 + 4*8)
+
+#define MAPCACHEFILES 256 // per kind, the oldest ones go after that
+
+#ifndef NOMD5
+static boolean P_LoadCachedBlockMap(UINT32 checksum)
+{
+	UINT8 *cache = NULL, *p;
+	size_t size = FIL_ReadFileTag(P_MapCachePath("blockmap", "bmp"), &cache, PU_STATIC);
+	UINT32 count;
+	size_t i;
+
+	if (!cache)
+		return false;
+
+	p = cache + 8;
+	if (size < BLOCKMAPCACHEHEADER || memcmp(cache, BLOCKMAPCACHEMAGIC, 8)
+		|| READUINT32(p) != numlines
+		|| READUINT32(p) != checksum
+		|| READFIXED(p) != bmaporgx || READFIXED(p) != bmaporgy
+		|| READINT32(p) != bmapwidth || READINT32(p) != bmapheight)
+	{
+		Z_Free(cache);
+		return false;
+	}
+
+	count = READUINT32(p);
+	READUINT32(p); // reserved
+	if (size != BLOCKMAPCACHEHEADER + (size_t)count*4
+		|| count < 4 + (size_t)bmapwidth*bmapheight + 2)
+	{
+		Z_Free(cache);
+		return false;
+	}
+
+	blockmaplump = Z_Malloc(sizeof (*blockmaplump) * count, PU_LEVEL, NULL);
+	for (i = 0; i < count; i++)
+		blockmaplump[i] = READINT32(p);
+	Z_Free(cache);
+
+	// Don't trust it any further than that. Every block has to point past
+	// the offsets, and everything after them has to be a line (the list
+	// headers are 0) or the end of a list, with the last list ending at the
+	// end of the lump, so that walking any block's list stays inside it.
+	{
+		const size_t lists = 4 + (size_t)bmapwidth*bmapheight;
+
+		for (i = 4; i < lists; i++)
+			if (blockmaplump[i] < (INT32)lists || (UINT32)blockmaplump[i] >= count - 1)
+				break;
+		if (i == lists)
+			for (i = lists; i < count; i++)
+				if (blockmaplump[i] < -1 || blockmaplump[i] >= (INT32)numlines)
+					break;
+		if (i != count || blockmaplump[count - 1] != -1)
+		{
+			CONS_Debug(DBG_SETUP, "P_CreateBlockMap: cached blockmap is broken, rebuilding it\n");
+			Z_Free(blockmaplump);
+			blockmaplump = NULL;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void P_CacheBlockMap(UINT32 checksum, size_t count)
+{
+	UINT8 *cache = Z_Malloc(BLOCKMAPCACHEHEADER + count*4, PU_STATIC, NULL);
+	UINT8 *p = cache;
+	size_t i;
+
+	M_Memcpy(p, BLOCKMAPCACHEMAGIC, 8);
+	p += 8;
+	WRITEUINT32(p, numlines);
+	WRITEUINT32(p, checksum);
+	WRITEFIXED(p, bmaporgx);
+	WRITEFIXED(p, bmaporgy);
+	WRITEINT32(p, bmapwidth);
+	WRITEINT32(p, bmapheight);
+	WRITEUINT32(p, count);
+	WRITEUINT32(p, 0);
+	for (i = 0; i < count; i++)
+		WRITEINT32(p, blockmaplump[i]);
+
+	I_mkdir(va("%s"PATHSEP"blockmap", srb2home), 0755);
+	if (!FIL_WriteFile(P_MapCachePath("blockmap", "bmp"), cache, p - cache))
+		CONS_Debug(DBG_SETUP, "P_CreateBlockMap: couldn't cache the blockmap\n");
+	else
+		trimfolder(va("%s"PATHSEP"blockmap", srb2home), MAPCACHEFILES);
+	Z_Free(cache);
+}
+#endif
+
 //
 // killough 10/98:
 //
@@ -2419,10 +3186,15 @@ static boolean LineInBlock(fixed_t cx1, fixed_t cy1, fixed_t cx2, fixed_t cy2, f
 //
 // Please note: This section of code is not interchangable with TeamTNT's
 // code which attempts to fix the same problem.
+//
+// The rows are built in parallel, and the result is cached in srb2home so
+// the next load of the same map can skip all of this.
 static void P_CreateBlockMap(void)
 {
 	register size_t i;
 	fixed_t minx = INT32_MAX, miny = INT32_MAX, maxx = INT32_MIN, maxy = INT32_MIN;
+	UINT32 checksum = P_MapGeometryChecksum();
+	UINT32 t = (UINT32)I_GetTimeMicros();
 	// First find limits of map
 
 	for (i = 0; i < numvertexes; i++)
@@ -2449,36 +3221,34 @@ static void P_CreateBlockMap(void)
 	//
 	// For each linedef:
 	//
-	//   Map the starting and ending vertices to blocks.
-	//
-	//   Starting in the starting vertex's block, do:
-	//
-	//     Add linedef to current block's list, dynamically resizing it.
+	//   Draw a box of blocks around it, from its starting vertex's block to
+	//   its ending vertex's, and note down which rows of blocks that box
+	//   can reach.
 	//
-	//     If current block is the same as the ending vertex's block, exit loop.
+	// Then for each row of blocks, in parallel:
 	//
-	//     Move to an adjacent block by moving towards the ending block in
-	//     either the x or y direction, to the block which contains the linedef.
+	//   Add every linedef that passes through a block in the row to that
+	//   block's list, in order.
 
+#ifndef NOMD5
+	if (P_LoadCachedBlockMap(checksum))
+		CONS_Debug(DBG_SETUP, "P_CreateBlockMap: loaded from cache\n");
+	else
+#endif
 	{
-		typedef struct
-		{
-			INT32 n, nalloc;
-			INT32 *list;
-		} bmap_t; // blocklist structure
-
 		size_t tot = bmapwidth * bmapheight; // size of blockmap
-		bmap_t *bmap = calloc(tot, sizeof (*bmap)); // array of blocklists
-		boolean straight;
-
-		if (bmap == NULL) I_Error("%s: Out of memory making blockmap", "P_CreateBlockMap");
+		bmapline_t *bmaplines = Z_Malloc(max(numlines, 1) * sizeof (*bmaplines), PU_STATIC, NULL);
+		size_t *firstrowline = Z_Calloc((bmapheight + 1) * sizeof (*firstrowline), PU_STATIC, NULL);
+		INT32 *rowlines;
+		bmapbuild_t build;
 
 		for (i = 0; i < numlines; i++)
 		{
+			bmapline_t *ln = &bmaplines[i];
 			// starting coordinates
 			INT32 x = (lines[i].v1->x>>FRACBITS) - minx;
 			INT32 y = (lines[i].v1->y>>FRACBITS) - miny;
-			INT32 bxstart, bxend, bystart, byend, v2x, v2y, curblockx, curblocky;
+			INT32 bxstart, bxend, bystart, byend, v2x, v2y;
 
 			v2x = lines[i].v2->x>>FRACBITS;
 			v2y = lines[i].v2->y>>FRACBITS;
@@ -2513,49 +3283,75 @@ static void P_CreateBlockMap(void)
 			// be included in the proper blocks.
 			if (lines[i].v1->y == lines[i].v2->y)
 			{
-				straight = true;
+				ln->straight = true;
 				bystart--;
 				byend++;
 			}
 			else if (lines[i].v1->x == lines[i].v2->x)
 			{
-				straight = true;
+				ln->straight = true;
 				bxstart--;
 				bxend++;
 			}
 			else
-				straight = false;
+				ln->straight = false;
+
+			ln->x = x;
+			ln->y = y;
+			ln->v2x = v2x;
+			ln->v2y = v2y;
+			ln->bxstart = bxstart;
+			ln->bxend = bxend;
+			ln->bystart = bystart;
+			ln->byend = byend;
+		}
 
-			// Now we simply iterate block-by-block until we reach the end block.
-			for (curblockx = bxstart; curblockx <= bxend; curblockx++)
-			for (curblocky = bystart; curblocky <= byend; curblocky++)
-			{
-				size_t b = curblocky * bmapwidth + curblockx;
+		// Sort the lines by the rows their boxes reach. Blocks are numbered
+		// y * bmapwidth + x, which is what decides the row, not y alone.
+#define ROWRANGE(ln, r0, r1) \
+		{ \
+			INT64 bmin = (INT64)(ln)->bystart * bmapwidth + (ln)->bxstart; \
+			INT64 bmax = (INT64)(ln)->byend * bmapwidth + (ln)->bxend; \
+			r0 = max(P_FloorDiv(bmin, bmapwidth), 0); \
+			r1 = min(P_FloorDiv(bmax, bmapwidth), bmapheight - 1); \
+		}
+		for (i = 0; i < numlines; i++)
+		{
+			INT64 r, r0, r1;
+			ROWRANGE(&bmaplines[i], r0, r1);
+			for (r = r0; r <= r1; r++)
+				firstrowline[r + 1]++;
+		}
+		for (i = 0; i < (size_t)bmapheight; i++)
+			firstrowline[i + 1] += firstrowline[i];
 
-				if (b >= tot)
-					continue;
+		rowlines = Z_Malloc(max(firstrowline[bmapheight], 1) * sizeof (*rowlines), PU_STATIC, NULL);
+		{
+			size_t *next = Z_Malloc(bmapheight * sizeof (*next), PU_STATIC, NULL);
+			M_Memcpy(next, firstrowline, bmapheight * sizeof (*next));
+			for (i = 0; i < numlines; i++)
+			{
+				INT64 r, r0, r1;
+				ROWRANGE(&bmaplines[i], r0, r1);
+				for (r = r0; r <= r1; r++)
+					rowlines[next[r]++] = (INT32)i;
+			}
+			Z_Free(next);
+		}
+#undef ROWRANGE
 
-				if (!straight && !(LineInBlock((fixed_t)x, (fixed_t)y, (fixed_t)v2x, (fixed_t)v2y, (fixed_t)(curblockx << MAPBTOFRAC), (fixed_t)(curblocky << MAPBTOFRAC))))
-					continue;
+		build.lines = bmaplines;
+		build.rowlines = rowlines;
+		build.firstrowline = firstrowline;
+		build.width = bmapwidth;
+		build.cellcounts = Z_Calloc(bmapheight * sizeof (*build.cellcounts), PU_STATIC, NULL);
+		build.celllines = Z_Calloc(bmapheight * sizeof (*build.celllines), PU_STATIC, NULL);
 
-				// Increase size of allocated list if necessary
-				if (bmap[b].n >= bmap[b].nalloc)
-				{
-					// Graue 02-29-2004: make code more readable, don't realloc a null pointer
-					// (because it crashes for me, and because the comp.lang.c FAQ says so)
-					if (bmap[b].nalloc == 0)
-						bmap[b].nalloc = 8;
-					else
-						bmap[b].nalloc *= 2;
-					bmap[b].list = Z_Realloc(bmap[b].list, bmap[b].nalloc * sizeof (*bmap->list), PU_CACHE, &bmap[b].list);
-					if (!bmap[b].list)
-						I_Error("Out of Memory in P_CreateBlockMap");
-				}
+		I_RunJobs(P_CreateBlockMapRow, &build, bmapheight, 0);
 
-				// Add linedef to end of list
-				bmap[b].list[bmap[b].n++] = (INT32)i;
-			}
-		}
+		for (i = 0; i < (size_t)bmapheight; i++)
+			if (!build.cellcounts[i])
+				I_Error("%s: Out of memory making blockmap", "P_CreateBlockMap");
 
 		// Compute the total size of the blockmap.
 		//
@@ -2567,8 +3363,11 @@ static void P_CreateBlockMap(void)
 			size_t count = tot + 6; // we need at least 1 word per block, plus reserved's
 
 			for (i = 0; i < tot; i++)
-				if (bmap[i].n)
-					count += bmap[i].n + 2; // 1 header word + 1 trailer word + blocklist
+			{
+				INT32 n = build.cellcounts[i / bmapwidth][i % bmapwidth];
+				if (n)
+					count += n + 2; // 1 header word + 1 trailer word + blocklist
+			}
 
 			// Allocate blockmap lump with computed count
 			blockmaplump = Z_Calloc(sizeof (*blockmaplump) * count, PU_LEVEL, NULL);
@@ -2577,31 +3376,55 @@ static void P_CreateBlockMap(void)
 		// Now compress the blockmap.
 		{
 			size_t ndx = tot += 4; // Advance index to start of linedef lists
-			bmap_t *bp = bmap; // Start of uncompressed blockmap
+			size_t row, col;
 
 			blockmaplump[ndx++] = 0; // Store an empty blockmap list at start
 			blockmaplump[ndx++] = -1; // (Used for compression)
 
-			for (i = 4; i < tot; i++, bp++)
-				if (bp->n) // Non-empty blocklist
+			for (i = 4, row = 0; row < (size_t)bmapheight; row++)
+			{
+				const INT32 *bp = build.celllines[row]; // Start of the row's linedef lists
+
+				for (col = 0; col < (size_t)bmapwidth; col++, i++)
 				{
-					blockmaplump[blockmaplump[i] = (INT32)(ndx++)] = 0; // Store index & header
-					do
-						blockmaplump[ndx++] = bp->list[--bp->n]; // Copy linedef list
-					while (bp->n);
-					blockmaplump[ndx++] = -1; // Store trailer
-					Z_Free(bp->list); // Free linedef list
+					INT32 n = build.cellcounts[row][col];
+
+					if (n) // Non-empty blocklist
+					{
+						blockmaplump[blockmaplump[i] = (INT32)(ndx++)] = 0; // Store index & header
+						do
+							blockmaplump[ndx++] = bp[--n]; // Copy linedef list, last first
+						while (n);
+						bp += build.cellcounts[row][col];
+						blockmaplump[ndx++] = -1; // Store trailer
+					}
+					else // Empty blocklist: point to reserved empty blocklist
+						blockmaplump[i] = (INT32)tot;
 				}
-				else // Empty blocklist: point to reserved empty blocklist
-					blockmaplump[i] = (INT32)tot;
 
-			free(bmap); // Free uncompressed blockmap
+				free(build.cellcounts[row]);
+				free(build.celllines[row]);
+			}
+
+#ifndef NOMD5
+			P_CacheBlockMap(checksum, ndx);
+#endif
 		}
+
+		Z_Free(build.cellcounts);
+		Z_Free(build.celllines);
+		Z_Free(rowlines);
+		Z_Free(firstrowline);
+		Z_Free(bmaplines);
 	}
+
+	CONS_Debug(DBG_SETUP, "P_CreateBlockMap: took %d ms\n", (INT32)(((UINT32)I_GetTimeMicros() - t)/1000));
+
 	{
 		size_t count = sizeof (*blocklinks) * bmapwidth * bmapheight;
 		// clear out mobj chains (copied from from P_LoadBlockMap)
 		blocklinks = Z_Calloc(count, PU_LEVEL, NULL);
+		blockthings = Z_Calloc(sizeof (*blockthings) * bmapwidth * bmapheight, PU_LEVEL, NULL);
 		blockmap = blockmaplump + 4;
 
 		// haleyjd 2/22/06: setup polyobject blockmap
@@ -2621,6 +3444,21 @@ static void P_LoadReject(UINT8 *data, size_t count)
 	}
 	else
 	{
+		size_t i;
+
+		// Node builders that don't make a REJECT often pad it with zeroes
+		// instead, which rejects nothing. Treat it as missing so one gets
+		// generated.
+		for (i = 0; i < count && !data[i]; i++)
+			;
+
+		if (i == count)
+		{
+			rejectmatrix = NULL;
+			CONS_Debug(DBG_SETUP, "P_LoadReject: REJECT lump is empty, will not be loaded\n");
+			return;
+		}
+
 		rejectmatrix = Z_Malloc(count, PU_LEVEL, NULL); // allocate memory for the reject matrix
 		M_Memcpy(rejectmatrix, data, count); // copy the data into it
 	}
@@ -2639,6 +3477,8 @@ static void P_LoadMapLUT(const virtres_t *virt)
 
 	if (!(virtblockmap && P_LoadBlockMap(virtblockmap->data, virtblockmap->size)))
 		P_CreateBlockMap();
+
+	P_BuildBlockLineBoxes();
 }
 
 //
@@ -2785,6 +3625,13 @@ static void P_MakeMapMD5(virtres_t *virt, void *dest)
 		virtlump_t* virtmthings = vres_Find(virt, "THINGS");
 		virtlump_t* virtsides   = vres_Find(virt, "SIDEDEFS");
 
+		// P_LoadMapData complains about missing lumps, right after this
+		if (!virtlines || !virtsectors || !virtmthings || !virtsides)
+		{
+			memset(dest, 0, 16);
+			return;
+		}
+
 		P_MakeBufferMD5((char*)virtlines->data,   virtlines->size, linemd5);
 		P_MakeBufferMD5((char*)virtsectors->data, virtsectors->size,  sectormd5);
 		P_MakeBufferMD5((char*)virtmthings->data, virtmthings->size,   thingmd5);
@@ -2797,10 +3644,82 @@ static void P_MakeMapMD5(virtres_t *virt, void *dest)
 	M_Memcpy(dest, &resmd5, 16);
 }
 
+#define REJECTCACHEMAGIC "SRB2RJ01"
+#define REJECTCACHEHEADER (8 + 4*3)
+
+//
+// P_GenerateReject
+// Builds a REJECT for maps that don't have one, or loads the one built the
+// last time this map was played from srb2home.
+//
+static void P_GenerateReject(void)
+{
+	const size_t size = (numsectors*numsectors + 7)/8;
+	UINT32 checksum = P_MapGeometryChecksum();
+	UINT32 t;
+#ifndef NOMD5
+	char *path = P_MapCachePath("reject", "rej");
+	UINT8 *cache = NULL;
+
+	if (FIL_ReadFileTag(path, &cache, PU_STATIC) == REJECTCACHEHEADER + size)
+	{
+		UINT8 *p = cache + 8;
+		UINT32 cachesectors = READUINT32(p);
+		UINT32 cachelines = READUINT32(p);
+		UINT32 cachesum = READUINT32(p);
+
+		if (!memcmp(cache, REJECTCACHEMAGIC, 8) && cachesectors == numsectors
+			&& cachelines == numlines && cachesum == checksum)
+		{
+			rejectmatrix = Z_Malloc(size, PU_LEVEL, NULL);
+			M_Memcpy(rejectmatrix, p, size);
+			Z_Free(cache);
+			CONS_Debug(DBG_SETUP, "P_GenerateReject: loaded %s\n", path);
+			return;
+		}
+	}
+	if (cache)
+		Z_Free(cache);
+	path = Z_StrDup(path);
+#endif
+
+	t = (UINT32)I_GetTimeMicros();
+	rejectmatrix = P_BuildRejectMatrix();
+	CONS_Debug(DBG_SETUP, "P_GenerateReject: %s for %s sectors in %d ms\n",
+		rejectmatrix ? "built" : "skipped", sizeu1(numsectors),
+		(INT32)(((UINT32)I_GetTimeMicros() - t)/1000));
+
+#ifndef NOMD5
+	if (rejectmatrix)
+	{
+		UINT8 *p;
+
+		cache = Z_Malloc(REJECTCACHEHEADER + size, PU_STATIC, NULL);
+		M_Memcpy(cache, REJECTCACHEMAGIC, 8);
+		p = cache + 8;
+		WRITEUINT32(p, numsectors);
+		WRITEUINT32(p, numlines);
+		WRITEUINT32(p, checksum);
+		M_Memcpy(p, rejectmatrix, size);
+
+		I_mkdir(va("%s"PATHSEP"reject", srb2home), 0755);
+		if (!FIL_WriteFile(path, cache, REJECTCACHEHEADER + size))
+			CONS_Debug(DBG_SETUP, "P_GenerateReject: couldn't write %s\n", path);
+		else
+			trimfolder(va("%s"PATHSEP"reject", srb2home), MAPCACHEFILES);
+		Z_Free(cache);
+	}
+	Z_Free(path);
+#endif
+}
+
 static boolean P_LoadMapFromFile(void)
 {
 	virtres_t *virt = vres_GetMap(lastloadedmaplumpnum);
 
+	// Early, as the generated lookup tables are cached by it.
+	P_MakeMapMD5(virt, &mapmd5);
+
 	if (!P_LoadMapData(virt))
 		return false;
 	P_LoadMapBSP(virt);
@@ -2817,7 +3736,8 @@ static boolean P_LoadMapFromFile(void)
 	memcpy(spawnlines, lines, numlines * sizeof(*lines));
 	memcpy(spawnsides, sides, numsides * sizeof(*sides));
 
-	P_MakeMapMD5(virt, &mapmd5);
+	if (!rejectmatrix)
+		P_GenerateReject();
 
 	vres_Free(virt);
 	return true;
@@ -3640,6 +4560,7 @@ boolean P_LoadLevel(boolean fromnetsave)
 	R_FlushTranslationColormapCache();
 
 	Z_FreeTags(PU_LEVEL, PU_PURGELEVEL - 1);
+	P_ClearMobjPool();
 
 #if defined (WALLSPLATS) || defined (FLOORSPLATS)
 	// clear the splats from previous level
@@ -3764,6 +4685,8 @@ boolean P_LoadLevel(boolean fromnetsave)
 		lastmaploaded = gamemap; // HAS to be set after saving!!
 	}
 
+	P_RefreshSynchHashes();
+
 	if (!fromnetsave) // uglier hack
 	{ // to make a newly loaded level start on the second frame.
 		INT32 buf = gametic % BACKUPTICS;
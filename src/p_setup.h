@@ -98,6 +98,9 @@ void P_ScanThings(INT16 mapnum, INT16 wadnum, INT16 lumpnum);
 #endif
 void P_RespawnThings(void);
 boolean P_LoadLevel(boolean fromnetsave);
+#ifdef DEVELOP
+void Command_Textmapbench_f(void);
+#endif
 #ifdef HWRENDER
 void HWR_SetupLevel(void);
 #endif
@@ -17,6 +17,8 @@
 #include "p_slopes.h"
 #include "r_main.h"
 #include "r_state.h"
+#include "i_threads.h"
+#include "z_zone.h"
 
 //
 // P_CheckSight
@@ -496,3 +498,310 @@ boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
 	// the head node is the last node output
 	return P_CrossBSPNode((INT32)numnodes - 1, &los);
 }
+
+// ==========================================================================
+//                            GENERATED REJECT
+// ==========================================================================
+//
+// Most maps are built without a REJECT table, which leaves P_CheckSight
+// walking the BSP for every pair of sectors. P_BuildRejectMatrix makes a
+// conservative one: a pair is only rejected when no straight line can get
+// from one sector to the other through two-sided lines at all.
+//
+// A sight line leaving sector s crosses some first portal F (a two-sided
+// line, from s's side to the other). Past F it stays on F's far side, so
+// every later portal Q it crosses has to reach F's far side, and F has to
+// reach the near side of Q. That pairwise test is cheap and only ever
+// keeps too much, so flooding out of s through the portals that pass it,
+// once per F, gives a superset of what s can see. Heights are ignored, as
+// they can change at runtime.
+//
+
+#define REJECTSHIFT 3 // keeps the INT64 cross products below from overflowing
+#define REJECTBUDGET (1<<18) // portal checks per sector before giving up and flood filling
+#define MAXREJECTSECTORS 8192 // matrix is numsectors^2 bits
+
+typedef struct
+{
+	INT64 x, y, dx, dy; // oriented so the far side is to the left
+	size_t to; // sector on the far side
+} rejportal_t;
+
+typedef struct
+{
+	UINT32 *stamp; // last flood that reached each sector
+	size_t *queue;
+	UINT8 *seen; // reachable from the current sector by any flood
+	UINT32 flood;
+} rejscratch_t;
+
+typedef struct
+{
+	UINT8 *matrix;
+	size_t numsectors;
+	const size_t *firstportal; // numsectors+1 entries, portals leaving each sector
+	const rejportal_t *portals;
+	const size_t *component; // connected sector groups, for the fallback
+	rejscratch_t *scratch; // one per thread
+} rejectbuild_t;
+
+// Cross product of (x, y) against the portal; positive is its far side.
+// The slack covers the precision dropped by REJECTSHIFT.
+static boolean P_RejectPointPast(const rejportal_t *p, INT64 x, INT64 y, INT64 sign)
+{
+	INT64 rx = x - p->x, ry = y - p->y;
+	INT64 cross = p->dx*ry - p->dy*rx;
+	INT64 slack = ((p->dx < 0 ? -p->dx : p->dx) + (p->dy < 0 ? -p->dy : p->dy)
+		+ (rx < 0 ? -rx : rx) + (ry < 0 ? -ry : ry))*2 + 4;
+
+	return (cross*sign >= -slack);
+}
+
+// Can one straight line cross first, then q?
+static boolean P_RejectPortalsLineUp(const rejportal_t *first, const rejportal_t *q)
+{
+	if (!P_RejectPointPast(first, q->x, q->y, 1)
+	&& !P_RejectPointPast(first, q->x + q->dx, q->y + q->dy, 1))
+		return false;
+
+	return P_RejectPointPast(q, first->x, first->y, -1)
+		|| P_RejectPointPast(q, first->x + first->dx, first->y + first->dy, -1);
+}
+
+// Fills in the rows for sectors job*8 to job*8+7, which is a whole number
+// of bytes, so jobs never share one.
+static void P_RejectJob(void *userdata, size_t job, INT32 thread)
+{
+	rejectbuild_t *build = userdata;
+	rejscratch_t *sc = &build->scratch[thread];
+	const size_t n = build->numsectors;
+	size_t s, send = min(job*8 + 8, n);
+
+	for (s = job*8; s < send; s++)
+	{
+		size_t f, t;
+		INT32 budget = REJECTBUDGET;
+
+		memset(sc->seen, 0, n);
+		sc->seen[s] = 1;
+
+		for (f = build->firstportal[s]; f < build->firstportal[s+1]; f++)
+		{
+			const rejportal_t *first = &build->portals[f];
+			size_t head = 0, tail = 0;
+
+			sc->flood++;
+			sc->stamp[first->to] = sc->flood;
+			sc->seen[first->to] = 1;
+			sc->queue[tail++] = first->to;
+
+			while (head < tail && budget > 0)
+			{
+				size_t x = sc->queue[head++], q;
+
+				for (q = build->firstportal[x]; q < build->firstportal[x+1]; q++)
+				{
+					const rejportal_t *portal = &build->portals[q];
+
+					budget--;
+					if (sc->stamp[portal->to] == sc->flood)
+						continue;
+					if (!P_RejectPortalsLineUp(first, portal))
+						continue;
+
+					sc->stamp[portal->to] = sc->flood;
+					sc->seen[portal->to] = 1;
+					sc->queue[tail++] = portal->to;
+				}
+			}
+
+			if (budget <= 0)
+			{
+				// Too big to be worth it, everything connected stays visible.
+				for (t = 0; t < n; t++)
+					if (build->component[t] == build->component[s])
+						sc->seen[t] = 1;
+				break;
+			}
+		}
+
+		for (t = 0; t < n; t++)
+		{
+			if (!sc->seen[t])
+			{
+				size_t pnum = s*n + t;
+				build->matrix[pnum>>3] |= (UINT8)(1 << (pnum&7));
+			}
+		}
+	}
+}
+
+// Sector boundaries have to be closed for the portal graph to mean
+// anything: every vertex must touch an even number of each sector's sides,
+// and every subsector must agree with the sides of its own segs.
+typedef struct
+{
+	size_t sector, vertex;
+} rejsidevertex_t;
+
+static int P_CompareSideVertex(const void *a, const void *b)
+{
+	const rejsidevertex_t *l = a, *r = b;
+	if (l->sector != r->sector)
+		return (l->sector < r->sector) ? -1 : 1;
+	if (l->vertex != r->vertex)
+		return (l->vertex < r->vertex) ? -1 : 1;
+	return 0;
+}
+
+static boolean P_SectorsAreClosed(void)
+{
+	rejsidevertex_t *ends = Z_Malloc(numlines * 4 * sizeof (*ends), PU_STATIC, NULL);
+	size_t i, j, count = 0;
+	boolean closed = true;
+
+	for (i = 0; i < numlines; i++)
+	{
+		const line_t *ld = &lines[i];
+		const sector_t *side[2] = {ld->frontsector, ld->backsector};
+
+		for (j = 0; j < 2; j++)
+		{
+			if (!side[j])
+				continue;
+			ends[count].sector = side[j] - sectors;
+			ends[count++].vertex = ld->v1 - vertexes;
+			ends[count].sector = side[j] - sectors;
+			ends[count++].vertex = ld->v2 - vertexes;
+		}
+	}
+
+	qsort(ends, count, sizeof (*ends), P_CompareSideVertex);
+	for (i = 0; i < count && closed; i = j)
+	{
+		for (j = i + 1; j < count && !P_CompareSideVertex(&ends[i], &ends[j]); j++)
+			;
+		if ((j - i) & 1)
+			closed = false;
+	}
+	Z_Free(ends);
+
+	for (i = 0; i < numsubsectors && closed; i++)
+	{
+		const seg_t *seg = &segs[subsectors[i].firstline];
+		for (j = 0; j < (size_t)subsectors[i].numlines; j++, seg++)
+			if (!seg->glseg && seg->linedef && seg->frontsector != subsectors[i].sector)
+				closed = false;
+	}
+
+	return closed;
+}
+
+static size_t P_RejectFindComponent(size_t *component, size_t s)
+{
+	while (component[s] != s)
+		s = component[s] = component[component[s]];
+	return s;
+}
+
+/**	\brief	Builds a conservative REJECT table for the current map, using
+	the job threads. Call once the map's lines, segs and subsectors are
+	linked up.
+
+	\return	a PU_LEVEL matrix in the usual REJECT layout, or NULL if
+		the map is too big or its sectors aren't closed
+*/
+UINT8 *P_BuildRejectMatrix(void)
+{
+	rejectbuild_t build;
+	size_t *firstportal, *component;
+	rejportal_t *portals;
+	size_t i, numportals = 0, numthreads;
+
+	if (!numsectors || numsectors > MAXREJECTSECTORS || !P_SectorsAreClosed())
+		return NULL;
+
+	firstportal = Z_Calloc((numsectors + 1) * sizeof (*firstportal), PU_STATIC, NULL);
+	component = Z_Malloc(numsectors * sizeof (*component), PU_STATIC, NULL);
+	for (i = 0; i < numsectors; i++)
+		component[i] = i;
+
+	// Count the portals leaving each sector, then lay them out per sector.
+	for (i = 0; i < numlines; i++)
+	{
+		const line_t *ld = &lines[i];
+		if (!(ld->flags & ML_TWOSIDED) || !ld->backsector || ld->frontsector == ld->backsector)
+			continue;
+		firstportal[ld->frontsector - sectors + 1]++;
+		firstportal[ld->backsector - sectors + 1]++;
+		component[P_RejectFindComponent(component, ld->frontsector - sectors)] =
+			P_RejectFindComponent(component, ld->backsector - sectors);
+	}
+	for (i = 0; i < numsectors; i++)
+		firstportal[i + 1] += firstportal[i];
+	for (i = 0; i < numsectors; i++)
+		component[i] = P_RejectFindComponent(component, i);
+
+	numportals = firstportal[numsectors];
+	portals = Z_Malloc(max(numportals, 1) * sizeof (*portals), PU_STATIC, NULL);
+	{
+		size_t *next = Z_Malloc(numsectors * sizeof (*next), PU_STATIC, NULL);
+		M_Memcpy(next, firstportal, numsectors * sizeof (*next));
+
+		for (i = 0; i < numlines; i++)
+		{
+			const line_t *ld = &lines[i];
+			INT64 x1, y1, x2, y2;
+			rejportal_t *p;
+
+			if (!(ld->flags & ML_TWOSIDED) || !ld->backsector || ld->frontsector == ld->backsector)
+				continue;
+
+			x1 = ld->v1->x >> REJECTSHIFT;
+			y1 = ld->v1->y >> REJECTSHIFT;
+			x2 = ld->v2->x >> REJECTSHIFT;
+			y2 = ld->v2->y >> REJECTSHIFT;
+
+			// The front side is on the right, so going front to back
+			// the far side is on the left as it is...
+			p = &portals[next[ld->frontsector - sectors]++];
+			p->x = x1; p->y = y1; p->dx = x2 - x1; p->dy = y2 - y1;
+			p->to = ld->backsector - sectors;
+
+			// ...and going back to front, the line gets flipped.
+			p = &portals[next[ld->backsector - sectors]++];
+			p->x = x2; p->y = y2; p->dx = x1 - x2; p->dy = y1 - y2;
+			p->to = ld->frontsector - sectors;
+		}
+		Z_Free(next);
+	}
+
+	numthreads = (size_t)I_NumJobThreads();
+	build.matrix = Z_Calloc((numsectors*numsectors + 7)/8, PU_LEVEL, NULL);
+	build.numsectors = numsectors;
+	build.firstportal = firstportal;
+	build.portals = portals;
+	build.component = component;
+	build.scratch = Z_Calloc(numthreads * sizeof (*build.scratch), PU_STATIC, NULL);
+	for (i = 0; i < numthreads; i++)
+	{
+		build.scratch[i].stamp = Z_Calloc(numsectors * sizeof (UINT32), PU_STATIC, NULL);
+		build.scratch[i].queue = Z_Malloc(numsectors * sizeof (size_t), PU_STATIC, NULL);
+		build.scratch[i].seen = Z_Malloc(numsectors, PU_STATIC, NULL);
+	}
+
+	I_RunJobs(P_RejectJob, &build, (numsectors + 7)/8, (INT32)numthreads);
+
+	for (i = 0; i < numthreads; i++)
+	{
+		Z_Free(build.scratch[i].stamp);
+		Z_Free(build.scratch[i].queue);
+		Z_Free(build.scratch[i].seen);
+	}
+	Z_Free(build.scratch);
+	Z_Free(portals);
+	Z_Free(component);
+	Z_Free(firstportal);
+
+	return build.matrix;
+}
@@ -18,7 +18,11 @@
 #include "s_sound.h"
 #include "st_stuff.h"
 #include "p_polyobj.h"
+#include "r_state.h"
+#include "i_system.h" // I_GetTimeMicros
 #include "m_random.h"
+#include "p_slopes.h" // T_DynamicSlopeLine, T_DynamicSlopeVert
+#include "dehacked.h" // DEH_GetMobjTypeName
 #include "lua_script.h"
 #include "lua_hook.h"
 
@@ -183,6 +187,195 @@ void Command_CountMobjs_f(void)
 	}
 }
 
+//
+// TICKSTATS
+// Microseconds spent in each part of P_Ticker, kept for the last
+// TICKSTATSLEN tics. Each part is timed as a "lap" from the end of the
+// previous one, so between them they account for the whole tic.
+//
+
+#define TICKSTATSLEN 1024 // about half a minute
+
+static void TickStats_OnChange(void);
+
+consvar_t cv_tickstats = {"tickstats", "Off", CV_CALL, CV_OnOff, TickStats_OnChange, 0, NULL, NULL, 0, 0, NULL};
+
+const char *const tickstatnames[NUMTICKSTATS] = {
+	"total",
+	"lua pre",
+	"players",
+	"thinkers",
+	" polyobj", // thinker lists, in thinklistnum_t order
+	" main",
+	" mobj",
+	" dynslope",
+	" precip",
+	"after",
+	"lua tick",
+	"shields",
+	"specials",
+	"respawn",
+	"level",
+	"lua post",
+};
+
+static UINT32 tickstats[TICKSTATSLEN][NUMTICKSTATS];
+static size_t tickstatshead, tickstatscount;
+
+static UINT32 tickstatsnow[NUMTICKSTATS]; // the tic being timed
+static UINT32 tickstatsstart, tickstatslap;
+static boolean tickstatsactive;
+
+static tickstatsummary_t tickstatsummary[NUMTICKSTATS];
+static boolean tickstatsdirty;
+
+static void TickStats_OnChange(void)
+{
+	tickstatshead = tickstatscount = 0;
+	tickstatsdirty = true;
+}
+
+// Starts timing a tic, if tickstats is on.
+static void P_StartTickStats(void)
+{
+	tickstatsactive = (cv_tickstats.value != 0);
+	if (!tickstatsactive)
+		return;
+
+	memset(tickstatsnow, 0, sizeof (tickstatsnow));
+	tickstatsstart = tickstatslap = (UINT32)I_GetTimeMicros();
+}
+
+// Charges everything since the last lap to stat.
+static inline void P_TickStatLap(tickstat_t stat)
+{
+	UINT32 now;
+
+	if (!tickstatsactive)
+		return;
+
+	now = (UINT32)I_GetTimeMicros();
+	tickstatsnow[stat] += now - tickstatslap;
+	tickstatslap = now;
+}
+
+// Files the tic away in the ring buffer.
+static void P_FinishTickStats(void)
+{
+	if (!tickstatsactive)
+		return;
+
+	tickstatsnow[TICKSTAT_TOTAL] = (UINT32)I_GetTimeMicros() - tickstatsstart;
+	memcpy(tickstats[tickstatshead], tickstatsnow, sizeof (tickstatsnow));
+	tickstatshead = (tickstatshead + 1) % TICKSTATSLEN;
+	if (tickstatscount < TICKSTATSLEN)
+		tickstatscount++;
+
+	tickstatsactive = false;
+	tickstatsdirty = true;
+}
+
+static int TickStatCmp(const void *a, const void *b)
+{
+	UINT32 ua = *(const UINT32 *)a, ub = *(const UINT32 *)b;
+	return (ua > ub) - (ua < ub);
+}
+
+/** Works out min/avg/max/p99 of every tickstat over the recorded tics.
+  *
+  * \param summary Filled with NUMTICKSTATS entries; don't free it.
+  * \return Number of tics recorded, up to TICKSTATSLEN.
+  */
+size_t P_GetTickStats(const tickstatsummary_t **summary)
+{
+	static UINT32 sorted[TICKSTATSLEN];
+	size_t i, t;
+
+	*summary = tickstatsummary;
+
+	if (!tickstatsdirty)
+		return tickstatscount;
+	tickstatsdirty = false;
+
+	memset(tickstatsummary, 0, sizeof (tickstatsummary));
+	if (!tickstatscount)
+		return 0;
+
+	for (i = 0; i < NUMTICKSTATS; i++)
+	{
+		UINT64 sum = 0;
+
+		for (t = 0; t < tickstatscount; t++)
+		{
+			sorted[t] = tickstats[t][i];
+			sum += sorted[t];
+		}
+		qsort(sorted, tickstatscount, sizeof (*sorted), TickStatCmp);
+
+		tickstatsummary[i].min = sorted[0];
+		tickstatsummary[i].max = sorted[tickstatscount - 1];
+		tickstatsummary[i].avg = (UINT32)(sum / tickstatscount);
+		tickstatsummary[i].p99 = sorted[(tickstatscount - 1) * 99 / 100];
+	}
+
+	return tickstatscount;
+}
+
+// Writes every recorded tic, oldest first.
+static void WriteTickStatsCSV(const char *filename)
+{
+	size_t i, t;
+	FILE *f = fopen(filename, "w");
+
+	if (!f)
+	{
+		CONS_Alert(CONS_ERROR, M_GetText("Couldn't write %s\n"), filename);
+		return;
+	}
+
+	fprintf(f, "tic");
+	for (i = 0; i < NUMTICKSTATS; i++)
+		fprintf(f, ",%s", tickstatnames[i] + (tickstatnames[i][0] == ' '));
+	fprintf(f, "\n");
+
+	for (t = 0; t < tickstatscount; t++)
+	{
+		const UINT32 *tic = tickstats[(tickstatshead + TICKSTATSLEN - tickstatscount + t) % TICKSTATSLEN];
+
+		fprintf(f, "%s", sizeu1(t));
+		for (i = 0; i < NUMTICKSTATS; i++)
+			fprintf(f, ",%u", tic[i]);
+		fprintf(f, "\n");
+	}
+	fclose(f);
+
+	CONS_Printf(M_GetText("Wrote %s\n"), filename);
+}
+
+/** Console command for tickstats.
+  * Shows the summary, and writes every recorded tic out if given a file.
+  */
+void Command_Tickstats_f(void)
+{
+	const tickstatsummary_t *summary;
+	size_t i, count = P_GetTickStats(&summary);
+
+	if (!count)
+	{
+		CONS_Printf(M_GetText("No tics recorded; set tickstats to On first.\n"));
+		return;
+	}
+
+	CONS_Printf(M_GetText("Last %s tics, in microseconds:\n"), sizeu1(count));
+	CONS_Printf("%-10s %7s %7s %7s %7s\n", "", "min", "avg", "max", "p99");
+	for (i = 0; i < NUMTICKSTATS; i++)
+		CONS_Printf("%-10s %7u %7u %7u %7u\n", tickstatnames[i],
+			summary[i].min, summary[i].avg, summary[i].max, summary[i].p99);
+
+	if (COM_Argc() > 1)
+		WriteTickStatsCSV(COM_Argv(1));
+}
+
 //
 // P_InitThinkers
 //
@@ -217,16 +410,14 @@ void P_AddThinker(const thinklistnum_t n, thinker_t *thinker)
 static thinker_t *currentthinker;
 
 //
-// P_RemoveThinkerDelayed()
-//
-// Called automatically as part of the thinker loop in P_RunThinkers(),
-// on nodes which are pending deletion.
+// P_UnlinkThinkerDelayed()
 //
 // If this thinker has no more pointers referencing it indirectly,
-// remove it, and set currentthinker to one node preceeding it, so
+// unlink it, and set currentthinker to one node preceeding it, so
 // that the next step in P_RunThinkers() will get its successor.
+// Returns true if the thinker was unlinked and can be freed.
 //
-void P_RemoveThinkerDelayed(thinker_t *thinker)
+static boolean P_UnlinkThinkerDelayed(thinker_t *thinker)
 {
 	thinker_t *next;
 #ifdef PARANOIA
@@ -236,12 +427,12 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
 		if (thinker->references & BEENAROUNDBIT) // Usually gets cleared up in one frame; what's going on here, then?
 			CONS_Printf("Number of potentially faulty references: %d\n", (thinker->references & ~BEENAROUNDBIT));
 		thinker->references |= BEENAROUNDBIT;
-		return;
+		return false;
 	}
 #undef BEENAROUNDBIT
 #else
 	if (thinker->references)
-		return;
+		return false;
 #endif
 
 	/* Remove from main thinker list */
@@ -251,8 +442,19 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
 	* point it to thinker->prev, so the iterator will correctly move on to
 	* thinker->prev->next = thinker->next */
 	(next->prev = currentthinker = thinker->prev)->next = next;
+	return true;
+}
 
-	Z_Free(thinker);
+//
+// P_RemoveThinkerDelayed()
+//
+// Called automatically as part of the thinker loop in P_RunThinkers(),
+// on nodes which are pending deletion.
+//
+void P_RemoveThinkerDelayed(thinker_t *thinker)
+{
+	if (P_UnlinkThinkerDelayed(thinker))
+		Z_Free(thinker);
 }
 
 //
@@ -294,6 +496,365 @@ if ((*mop = targ) != NULL) // Set new target and if non-NULL, increase its count
 	return targ;
 }
 
+//
+// Synch hashes
+//
+// Every mobj and sector keeps its own hash, and the sums of those are
+// updated whenever one of them is refreshed: mobjs when they're about
+// to think, sectors when things in them get checked after the floor or
+// ceiling moved. Everything gets rehashed from scratch once a second
+// (and when a level or savegame is loaded), so nothing stays stale for
+// long and joining players catch up with everyone else.
+//
+UINT32 synch_mobjhash = 0, synch_sectorhash = 0;
+
+#define SYNCHMIX(h, v) (h = (h ^ (UINT32)(v)) * 16777619u)
+
+// Only things that affect gameplay.
+#define SYNCHMOBJFLAGS (MF_SPECIAL|MF_SOLID|MF_PUSHABLE|MF_BOSS|MF_MISSILE|MF_SPRING|MF_MONITOR|MF_FIRE|MF_ENEMY|MF_PAIN|MF_STICKY)
+
+static UINT32 P_MobjSynchHash(const mobj_t *mobj)
+{
+	UINT32 h = 2166136261u;
+
+	if (!(mobj->flags & SYNCHMOBJFLAGS))
+		return 0;
+
+	SYNCHMIX(h, mobj->type);
+	SYNCHMIX(h, mobj->x);
+	SYNCHMIX(h, mobj->y);
+	SYNCHMIX(h, mobj->z);
+	SYNCHMIX(h, mobj->momx);
+	SYNCHMIX(h, mobj->momy);
+	SYNCHMIX(h, mobj->momz);
+	SYNCHMIX(h, mobj->angle);
+	SYNCHMIX(h, mobj->flags);
+	SYNCHMIX(h, mobj->flags2);
+	SYNCHMIX(h, mobj->eflags);
+	SYNCHMIX(h, mobj->state - states);
+	SYNCHMIX(h, mobj->tics);
+	SYNCHMIX(h, mobj->health);
+	return h;
+}
+
+static UINT32 P_SectorSynchHash(const sector_t *sector)
+{
+	UINT32 h = 2166136261u;
+
+	SYNCHMIX(h, sector - sectors);
+	SYNCHMIX(h, sector->floorheight);
+	SYNCHMIX(h, sector->ceilingheight);
+	return h;
+}
+
+void P_UpdateMobjSynchHash(mobj_t *mobj)
+{
+	UINT32 h = P_MobjSynchHash(mobj);
+	synch_mobjhash += h - mobj->synchhash;
+	mobj->synchhash = h;
+}
+
+void P_UpdateSectorSynchHash(sector_t *sector)
+{
+	UINT32 h = P_SectorSynchHash(sector);
+	synch_sectorhash += h - sector->synchhash;
+	sector->synchhash = h;
+}
+
+// There aren't many polyobjects, so these just get hashed every time.
+UINT32 P_PolyobjSynchHash(void)
+{
+	UINT32 h = 2166136261u;
+	INT32 i;
+
+	for (i = 0; i < numPolyObjects; i++)
+	{
+		SYNCHMIX(h, PolyObjects[i].centerPt.x);
+		SYNCHMIX(h, PolyObjects[i].centerPt.y);
+		SYNCHMIX(h, PolyObjects[i].angle);
+	}
+	return h;
+}
+
+void P_RefreshSynchHashes(void)
+{
+	thinker_t *th;
+	size_t i;
+
+	synch_mobjhash = synch_sectorhash = 0;
+
+	for (th = thlist[THINK_MOBJ].next; th != &thlist[THINK_MOBJ]; th = th->next)
+	{
+		if (th->function.acp1 == (actionf_p1)P_RemoveThinkerDelayed)
+			continue;
+		((mobj_t *)th)->synchhash = P_MobjSynchHash((mobj_t *)th);
+		synch_mobjhash += ((mobj_t *)th)->synchhash;
+	}
+
+	for (i = 0; i < numsectors; i++)
+	{
+		sectors[i].synchhash = P_SectorSynchHash(&sectors[i]);
+		synch_sectorhash += sectors[i].synchhash;
+	}
+}
+
+#undef SYNCHMIX
+
+//
+// THINKERSTATS
+// Time and calls for every kind of thinker, and for every mobj type
+// under P_MobjThinker, kept per second for the last THINKERSTATSECS
+// seconds. Only collected while "thinkerstats on" is in effect, since
+// timing every thinker isn't free.
+//
+
+#define THINKERSTATSECS 60
+
+typedef struct
+{
+	actionf_p1 func;
+	const char *name;
+} thinkername_t;
+
+#define THINKERNAME(func) {(actionf_p1)func, #func}
+
+static const thinkername_t thinkernames[] = {
+	THINKERNAME(P_MobjThinker),
+	THINKERNAME(P_RemoveThinkerDelayed),
+	THINKERNAME(P_NullPrecipThinker),
+	THINKERNAME(P_RainThinker),
+	THINKERNAME(P_SnowThinker),
+	THINKERNAME(T_MoveCeiling),
+	THINKERNAME(T_CrushCeiling),
+	THINKERNAME(T_MoveFloor),
+	THINKERNAME(T_MoveElevator),
+	THINKERNAME(T_ContinuousFalling),
+	THINKERNAME(T_BounceCheese),
+	THINKERNAME(T_StartCrumble),
+	THINKERNAME(T_MarioBlock),
+	THINKERNAME(T_MarioBlockChecker),
+	THINKERNAME(T_FloatSector),
+	THINKERNAME(T_ThwompSector),
+	THINKERNAME(T_NoEnemiesSector),
+	THINKERNAME(T_EachTimeThinker),
+	THINKERNAME(T_CameraScanner),
+	THINKERNAME(T_RaiseSector),
+	THINKERNAME(T_PlaneDisplace),
+	THINKERNAME(T_FireFlicker),
+	THINKERNAME(T_LightningFlash),
+	THINKERNAME(T_StrobeFlash),
+	THINKERNAME(T_Glow),
+	THINKERNAME(T_LightFade),
+	THINKERNAME(T_ExecutorDelay),
+	THINKERNAME(T_Disappear),
+	THINKERNAME(T_Fade),
+	THINKERNAME(T_FadeColormap),
+	THINKERNAME(T_LaserFlash),
+	THINKERNAME(T_Scroll),
+	THINKERNAME(T_Friction),
+	THINKERNAME(T_Pusher),
+	THINKERNAME(T_PolyObjRotate),
+	THINKERNAME(T_PolyObjMove),
+	THINKERNAME(T_PolyObjWaypoint),
+	THINKERNAME(T_PolyDoorSlide),
+	THINKERNAME(T_PolyDoorSwing),
+	THINKERNAME(T_PolyObjDisplace),
+	THINKERNAME(T_PolyObjRotDisplace),
+	THINKERNAME(T_PolyObjFlag),
+	THINKERNAME(T_PolyObjFade),
+	THINKERNAME(T_DynamicSlopeLine),
+	THINKERNAME(T_DynamicSlopeVert),
+	{NULL, "(unknown)"} // must be last
+};
+
+#undef THINKERNAME
+
+#define NUMTHINKERKINDS (sizeof (thinkernames) / sizeof (*thinkernames))
+#define NUMTHINKERCOSTS (NUMTHINKERKINDS + NUMMOBJTYPES) // kinds, then mobj types
+
+typedef struct
+{
+	UINT32 time; // microseconds
+	UINT32 calls;
+} thinkercost_t;
+
+static thinkercost_t *thinkercosts = NULL; // [THINKERSTATSECS][NUMTHINKERCOSTS]
+static size_t thinkercostsec; // second being filled in
+static tic_t thinkercosttics; // tics recorded so far
+
+// Thinker functions hash to thinkernames indices plus one, so that the
+// per-thinker lookup doesn't have to walk the whole table.
+#define THINKERHASHSIZE 256
+static UINT8 thinkerhash[THINKERHASHSIZE];
+
+static inline size_t P_ThinkerHash(actionf_p1 func)
+{
+	size_t h = (size_t)func;
+	return (h ^ (h >> 8) ^ (h >> 16)) & (THINKERHASHSIZE - 1);
+}
+
+static void P_InitThinkerHash(void)
+{
+	size_t i, h;
+
+	memset(thinkerhash, 0, sizeof (thinkerhash));
+	for (i = 0; i < NUMTHINKERKINDS - 1; i++)
+	{
+		for (h = P_ThinkerHash(thinkernames[i].func); thinkerhash[h]; h = (h + 1) & (THINKERHASHSIZE - 1))
+			;
+		thinkerhash[h] = (UINT8)(i + 1);
+	}
+}
+
+// Finds the thinkernames index of a thinker function.
+static inline size_t P_ThinkerKind(actionf_p1 func)
+{
+	size_t h;
+
+	for (h = P_ThinkerHash(func); thinkerhash[h]; h = (h + 1) & (THINKERHASHSIZE - 1))
+		if (thinkernames[thinkerhash[h] - 1].func == func)
+			return thinkerhash[h] - 1;
+
+	return NUMTHINKERKINDS - 1;
+}
+
+// Charges a thinker's run to its kind, and to its mobj type if it has one.
+static inline void P_AddThinkerCost(size_t kind, INT32 type, UINT32 time)
+{
+	thinkercost_t *costs = thinkercosts + thinkercostsec * NUMTHINKERCOSTS;
+
+	costs[kind].time += time;
+	costs[kind].calls++;
+
+	if (type >= 0)
+	{
+		costs[NUMTHINKERKINDS + type].time += time;
+		costs[NUMTHINKERKINDS + type].calls++;
+	}
+}
+
+// Starts a new second of thinkerstats when the current one is full.
+static void P_StartThinkerCosts(void)
+{
+	if (thinkercosttics && !(thinkercosttics % TICRATE))
+	{
+		thinkercostsec = (thinkercostsec + 1) % THINKERSTATSECS;
+		memset(thinkercosts + thinkercostsec * NUMTHINKERCOSTS, 0, NUMTHINKERCOSTS * sizeof (*thinkercosts));
+	}
+	thinkercosttics++;
+}
+
+typedef struct
+{
+	size_t index;
+	UINT64 time;
+	UINT32 calls;
+} thinkertotal_t;
+
+static int ThinkerTotalCmp(const void *a, const void *b)
+{
+	const thinkertotal_t *ta = a, *tb = b;
+	return (ta->time < tb->time) - (ta->time > tb->time);
+}
+
+// Prints the count most expensive entries in [first, last) over secs seconds.
+static void P_PrintThinkerCosts(const char *title, size_t first, size_t last, size_t secs, size_t count)
+{
+	thinkertotal_t *totals = Z_Calloc((last - first) * sizeof (*totals), PU_STATIC, NULL);
+	size_t i, s;
+
+	for (i = first; i < last; i++)
+	{
+		totals[i - first].index = i;
+		for (s = 0; s < secs; s++)
+		{
+			const thinkercost_t *cost = &thinkercosts[((thinkercostsec + THINKERSTATSECS - s) % THINKERSTATSECS) * NUMTHINKERCOSTS + i];
+			totals[i - first].time += cost->time;
+			totals[i - first].calls += cost->calls;
+		}
+	}
+	qsort(totals, last - first, sizeof (*totals), ThinkerTotalCmp);
+
+	CONS_Printf("%-32s %10s %10s %8s\n", title, "Total ms", "Calls", "Avg us");
+	for (i = 0; i < count && i < last - first && totals[i].calls; i++)
+	{
+		const char *name;
+
+		if (first == NUMTHINKERKINDS)
+		{
+			name = DEH_GetMobjTypeName((INT32)(totals[i].index - NUMTHINKERKINDS));
+			if (!name)
+				name = va("%s", sizeu1(totals[i].index - NUMTHINKERKINDS));
+		}
+		else
+			name = thinkernames[totals[i].index].name;
+
+		CONS_Printf("%-32s %10s %10u %8u\n", name, sizeu1((size_t)(totals[i].time / 1000)),
+			totals[i].calls, (UINT32)(totals[i].time / totals[i].calls));
+	}
+
+	Z_Free(totals);
+}
+
+/** Console command for thinkerstats.
+  * With no arguments, shows the thinker kinds and mobj types that took
+  * the most time over the last few seconds.
+  */
+void Command_Thinkerstats_f(void)
+{
+	const char *arg = COM_Argv(1);
+	size_t count = 10, secs = 10;
+
+	if (!stricmp(arg, "on"))
+	{
+		if (!thinkercosts)
+		{
+			P_InitThinkerHash();
+			thinkercosts = Z_Calloc(THINKERSTATSECS * NUMTHINKERCOSTS * sizeof (*thinkercosts), PU_STATIC, NULL);
+			thinkercostsec = 0;
+			thinkercosttics = 0;
+		}
+		CONS_Printf(M_GetText("Thinker stats on.\n"));
+		return;
+	}
+	else if (!stricmp(arg, "off"))
+	{
+		if (thinkercosts)
+			Z_Free(thinkercosts);
+		thinkercosts = NULL;
+		CONS_Printf(M_GetText("Thinker stats off.\n"));
+		return;
+	}
+	else if (*arg && !isdigit(*arg))
+	{
+		CONS_Printf(M_GetText("thinkerstats [count] [seconds]: show the slowest thinkers and object types\n"
+			"thinkerstats on/off: start or stop collecting (up to %d seconds are kept)\n"), THINKERSTATSECS);
+		return;
+	}
+
+	if (!thinkercosts)
+	{
+		CONS_Printf(M_GetText("Thinker stats are off; use \"thinkerstats on\" to start them.\n"));
+		return;
+	}
+
+	if (*arg)
+		count = atoi(arg);
+	if (COM_Argc() > 2)
+		secs = atoi(COM_Argv(2));
+	secs = max(1, min(secs, THINKERSTATSECS));
+	secs = min(secs, (thinkercosttics + TICRATE - 1) / TICRATE);
+	if (!secs)
+	{
+		CONS_Printf(M_GetText("No tics recorded yet.\n"));
+		return;
+	}
+
+	CONS_Printf(M_GetText("Last %s seconds:\n"), sizeu1(secs));
+	P_PrintThinkerCosts("Thinker", 0, NUMTHINKERKINDS, secs, count);
+	P_PrintThinkerCosts("Object type", NUMTHINKERKINDS, NUMTHINKERCOSTS, secs, count);
+}
+
 //
 // P_RunThinkers
 //
@@ -316,11 +877,84 @@ if ((*mop = targ) != NULL) // Set new target and if non-NULL, increase its count
 // Rewritten to delete nodes implicitly, by making currentthinker
 // external and using P_RemoveThinkerDelayed() implicitly.
 //
+// Mobjs come from their own pool (see P_AllocMobj), and their thinkers
+// are called directly, as that's what nearly all of them are.
+//
+static inline void P_RunMobjThinkers(void)
+{
+	for (currentthinker = thlist[THINK_MOBJ].next; currentthinker != &thlist[THINK_MOBJ]; currentthinker = currentthinker->next)
+	{
+		if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
+			P_MobjThinker((mobj_t *)currentthinker);
+		else if (currentthinker->function.acp1 == (actionf_p1)P_RemoveThinkerDelayed)
+		{
+			if (P_UnlinkThinkerDelayed(currentthinker))
+				P_FreeMobj((mobj_t *)currentthinker);
+		}
+		else
+		{
+#ifdef PARANOIA
+			I_Assert(currentthinker->function.acp1 != NULL);
+#endif
+			currentthinker->function.acp1(currentthinker);
+		}
+	}
+}
+
+// Same as P_RunThinkers, but timing every thinker for thinkerstats.
+static void P_RunThinkersTimed(void)
+{
+	size_t i;
+
+	P_StartThinkerCosts();
+
+	for (i = 0; i < NUM_THINKERLISTS; i++)
+	{
+		for (currentthinker = thlist[i].next; currentthinker != &thlist[i]; currentthinker = currentthinker->next)
+		{
+			actionf_p1 func = currentthinker->function.acp1;
+			// Read before the thinker runs; it may free itself
+			INT32 type = (func == (actionf_p1)P_MobjThinker) ? (INT32)((mobj_t *)currentthinker)->type : -1;
+			UINT32 start = (UINT32)I_GetTimeMicros();
+
+			if (i == THINK_MOBJ && func == (actionf_p1)P_RemoveThinkerDelayed)
+			{
+				if (P_UnlinkThinkerDelayed(currentthinker))
+					P_FreeMobj((mobj_t *)currentthinker);
+			}
+			else
+			{
+#ifdef PARANOIA
+				I_Assert(func != NULL);
+#endif
+				func(currentthinker);
+			}
+
+			P_AddThinkerCost(P_ThinkerKind(func), type, (UINT32)I_GetTimeMicros() - start);
+		}
+		P_TickStatLap(TICKSTAT_THLIST + i);
+	}
+}
+
 static inline void P_RunThinkers(void)
 {
 	size_t i;
+
+	if (thinkercosts)
+	{
+		P_RunThinkersTimed();
+		return;
+	}
+
 	for (i = 0; i < NUM_THINKERLISTS; i++)
 	{
+		if (i == THINK_MOBJ)
+		{
+			P_RunMobjThinkers();
+			P_TickStatLap(TICKSTAT_THLIST + i);
+			continue;
+		}
+
 		for (currentthinker = thlist[i].next; currentthinker != &thlist[i]; currentthinker = currentthinker->next)
 		{
 #ifdef PARANOIA
@@ -328,6 +962,7 @@ static inline void P_RunThinkers(void)
 #endif
 			currentthinker->function.acp1(currentthinker);
 		}
+		P_TickStatLap(TICKSTAT_THLIST + i);
 	}
 
 }
@@ -632,6 +1267,7 @@ void P_Ticker(boolean run)
 
 	postimgtype = postimgtype2 = postimg_none;
 
+	P_StartTickStats();
 	P_MapStart();
 
 	if (run)
@@ -642,10 +1278,12 @@ void P_Ticker(boolean run)
 			G_ReadDemoTiccmd(&players[consoleplayer].cmd, 0);
 
 		LUAh_PreThinkFrame();
+		P_TickStatLap(TICKSTAT_PRETHINK);
 
 		for (i = 0; i < MAXPLAYERS; i++)
 			if (playeringame[i] && players[i].mo && !P_MobjWasRemoved(players[i].mo))
 				P_PlayerThink(&players[i]);
+		P_TickStatLap(TICKSTAT_PLAYERS);
 	}
 
 	// Keep track of how long they've been playing!
@@ -658,30 +1296,45 @@ void P_Ticker(boolean run)
 	if (runemeraldmanager)
 		P_EmeraldManager(); // Power stone mode
 
+	P_TickStatLap(TICKSTAT_LEVEL);
+
 	if (run)
 	{
 		P_RunThinkers();
+		if (tickstatsactive)
+			for (i = 0; i < NUM_THINKERLISTS; i++)
+				tickstatsnow[TICKSTAT_THINKERS] += tickstatsnow[TICKSTAT_THLIST + i];
 
 		// Run any "after all the other thinkers" stuff
 		for (i = 0; i < MAXPLAYERS; i++)
 			if (playeringame[i] && players[i].mo && !P_MobjWasRemoved(players[i].mo))
 				P_PlayerAfterThink(&players[i]);
+		P_TickStatLap(TICKSTAT_AFTERTHINK);
 
 		LUAh_ThinkFrame();
+		P_TickStatLap(TICKSTAT_THINKFRAME);
 	}
 
 	// Run shield positioning
 	P_RunShields();
 	P_RunOverlays();
+	P_TickStatLap(TICKSTAT_SHIELDS);
 
 	P_UpdateSpecials();
+	P_TickStatLap(TICKSTAT_SPECIALS);
 	P_RespawnSpecials();
+	P_TickStatLap(TICKSTAT_RESPAWN);
 
 	// Lightning, rain sounds, etc.
 	P_PrecipitationEffects();
 
 	if (run)
+	{
 		leveltime++;
+		// Rehash everything every now and then, see P_RefreshSynchHashes
+		if (leveltime % TICRATE == 0)
+			P_RefreshSynchHashes();
+	}
 	timeinmap++;
 
 	if (G_TagGametype())
@@ -690,6 +1343,8 @@ void P_Ticker(boolean run)
 	if (G_GametypeHasTeams())
 		P_DoCTFStuff();
 
+	P_TickStatLap(TICKSTAT_LEVEL);
+
 	if (run)
 	{
 		if (countdowntimer && G_PlatformGametype() && ((gametyperules & GTR_CAMPAIGN) || leveltime >= 4*TICRATE) && !stoppedclock && --countdowntimer <= 0)
@@ -739,10 +1394,13 @@ void P_Ticker(boolean run)
 		if (modeattacking)
 			G_GhostTicker();
 
+		P_TickStatLap(TICKSTAT_LEVEL);
 		LUAh_PostThinkFrame();
+		P_TickStatLap(TICKSTAT_POSTTHINK);
 	}
 
 	P_MapEnd();
+	P_FinishTickStats();
 
 //	Z_CheckMemCleanup();
 }
@@ -11267,6 +11267,7 @@ static void P_DoTailsOverlay(player_t *player, mobj_t *tails)
 	tails->destscale = player->mo->destscale;
 	tails->radius = player->mo->radius;
 	tails->height = player->mo->height;
+	P_UpdateBlockThing(tails);
 	zoffs = FixedMul(zoffs, tails->scale);
 
 	if (player->mo->eflags & MFE_VERTICALFLIP)
@@ -127,12 +127,16 @@ size_t flatmemory, spritememory, texturememory;
 INT16 color8to16[256]; // remap color index to highcolor rgb value
 INT16 *hicolormaps; // test a 32k colormap remaps high -> high
 
-// Painfully simple texture id cacheing to make maps load faster. :3
-static struct {
-	char name[9];
-	INT32 id;
-} *tidcache = NULL;
-static INT32 tidcachelen = 0;
+// Texture name lookup: an open-addressed hash of texture numbers, built
+// by R_LoadTextures. Where names clash, the last-loaded texture is kept.
+static INT32 *texturehash = NULL;
+static size_t texturehashmask;
+
+// For the "textures used in this map" count. A texture counts once it's
+// been looked up with its lookupgen equal to texturelookupgen.
+static UINT16 *texturelookupgen = NULL;
+static UINT16 texturelookupcurgen = 1;
+static INT32 texturelookups = 0;
 
 //
 // MAPTEXTURE_T CACHING
@@ -914,6 +918,49 @@ Rloadtextures (INT32 i, INT32 w)
 	return i;
 }
 
+// Hashes up to 8 characters of a texture name, ignoring case.
+static size_t R_TextureNameHash(const char *name)
+{
+	UINT32 hash = 5381;
+	size_t i;
+
+	for (i = 0; i < 8 && name[i]; i++)
+		hash = hash*33 + toupper(name[i]);
+
+	return hash;
+}
+
+//
+// R_HashTextureNames
+// Builds the name lookup for R_CheckTextureNumForName.
+//
+static void R_HashTextureNames(void)
+{
+	size_t size = 1, h;
+	INT32 i;
+
+	while (size < (size_t)numtextures * 2)
+		size <<= 1;
+
+	texturehash = Z_Malloc(size * sizeof (*texturehash), PU_STATIC, NULL);
+	memset(texturehash, 0xFF, size * sizeof (*texturehash)); // all -1
+	texturehashmask = size - 1;
+
+	// Later textures replace earlier ones of the same name,
+	// so that the most recently loaded one is used
+	for (i = 0; i < numtextures; i++)
+	{
+		for (h = R_TextureNameHash(textures[i]->name) & texturehashmask; texturehash[h] != -1; h = (h + 1) & texturehashmask)
+			if (!strncasecmp(textures[texturehash[h]]->name, textures[i]->name, 8))
+				break;
+		texturehash[h] = i;
+	}
+
+	texturelookupgen = Z_Calloc(numtextures * sizeof (*texturelookupgen), PU_STATIC, NULL);
+	texturelookupcurgen = 1;
+	texturelookups = 0;
+}
+
 //
 // R_LoadTextures
 // Initializes the texture list with the textures from the world map.
@@ -935,6 +982,10 @@ void R_LoadTextures(void)
 		Z_Free(texturetranslation);
 		Z_Free(textures);
 		Z_Free(texflats);
+		Z_Free(texturehash);
+		Z_Free(texturelookupgen);
+		texturehash = NULL;
+		texturelookupgen = NULL;
 	}
 
 	// Load patches and textures.
@@ -1046,6 +1097,8 @@ void R_LoadTextures(void)
 		i = Rloadtextures(i, w);
 	}
 
+	R_HashTextureNames();
+
 #ifdef HWRENDER
 	if (rendermode == render_opengl)
 		HWR_LoadTextures(numtextures);
@@ -2582,12 +2635,17 @@ void R_InitData(void)
 
 void R_ClearTextureNumCache(boolean btell)
 {
-	if (tidcache)
-		Z_Free(tidcache);
-	tidcache = NULL;
 	if (btell)
-		CONS_Debug(DBG_SETUP, "Fun Fact: There are %d textures used in this map.\n", tidcachelen);
-	tidcachelen = 0;
+		CONS_Debug(DBG_SETUP, "Fun Fact: There are %d textures used in this map.\n", texturelookups);
+	texturelookups = 0;
+
+	// Starting a new generation forgets every texture at once
+	if (!++texturelookupcurgen)
+	{
+		if (texturelookupgen)
+			memset(texturelookupgen, 0, numtextures * sizeof (*texturelookupgen));
+		texturelookupcurgen = 1;
+	}
 }
 
 //
@@ -2598,28 +2656,26 @@ void R_ClearTextureNumCache(boolean btell)
 INT32 R_CheckTextureNumForName(const char *name)
 {
 	INT32 i;
+	size_t h;
 
 	// "NoTexture" marker.
 	if (name[0] == '-')
 		return 0;
 
-	for (i = 0; i < tidcachelen; i++)
-		if (!strncasecmp(tidcache[i].name, name, 8))
-			return tidcache[i].id;
+	if (!texturehash)
+		return -1;
 
-	// Need to parse the list backwards, so textures loaded more recently are used in lieu of ones loaded earlier
-	//for (i = 0; i < numtextures; i++) <- old
-	for (i = (numtextures - 1); i >= 0; i--) // <- new
+	for (h = R_TextureNameHash(name) & texturehashmask; (i = texturehash[h]) != -1; h = (h + 1) & texturehashmask)
 		if (!strncasecmp(textures[i]->name, name, 8))
 		{
-			tidcachelen++;
-			Z_Realloc(tidcache, tidcachelen * sizeof(*tidcache), PU_STATIC, &tidcache);
-			strncpy(tidcache[tidcachelen-1].name, name, 8);
-			tidcache[tidcachelen-1].name[8] = '\0';
+			if (texturelookupgen[i] != texturelookupcurgen)
+			{
+				texturelookupgen[i] = texturelookupcurgen;
+				texturelookups++;
 #ifndef ZDEBUG
-			CONS_Debug(DBG_SETUP, "texture #%s: %s\n", sizeu1(tidcachelen), tidcache[tidcachelen-1].name);
+				CONS_Debug(DBG_SETUP, "texture #%d: %.8s\n", texturelookups, textures[i]->name);
 #endif
-			tidcache[tidcachelen-1].id = i;
+			}
 			return i;
 		}
 
@@ -359,6 +359,8 @@ typedef struct sector_s
 
 	// colormap structure
 	extracolormap_t *spawn_extra_colormap;
+
+	UINT32 synchhash; // This sector's part of synch_sectorhash
 } sector_t;
 
 //
@@ -30,6 +30,11 @@
 #include "hardware/hw_main.h"
 #endif
 
+#ifdef THREADEDRENDER
+#include "i_system.h" // I_GetTimeMicros
+#include "i_threads.h"
+#endif
+
 // ==========================================================================
 //                     COMMON DATA FOR 8bpp AND 16bpp
 // ==========================================================================
@@ -61,13 +66,13 @@ UINT8 *topleft;
 //                      COLUMN DRAWING CODE STUFF
 // =========================================================================
 
-lighttable_t *dc_colormap;
-INT32 dc_x = 0, dc_yl = 0, dc_yh = 0;
+RENDERLOCAL lighttable_t *dc_colormap;
+RENDERLOCAL INT32 dc_x = 0, dc_yl = 0, dc_yh = 0;
 
-fixed_t dc_iscale, dc_texturemid;
-UINT8 dc_hires; // under MSVC boolean is a byte, while on other systems, it a bit,
+RENDERLOCAL fixed_t dc_iscale, dc_texturemid;
+RENDERLOCAL UINT8 dc_hires; // under MSVC boolean is a byte, while on other systems, it a bit,
                // soo lets make it a byte on all system for the ASM code
-UINT8 *dc_source;
+RENDERLOCAL UINT8 *dc_source;
 
 // -----------------------
 // translucency stuff here
@@ -78,7 +83,7 @@ UINT8 *transtables; // translucency tables
 
 /**	\brief R_DrawTransColumn uses this
 */
-UINT8 *dc_transmap; // one of the translucency tables
+RENDERLOCAL UINT8 *dc_transmap; // one of the translucency tables
 
 // ----------------------
 // translation stuff here
@@ -87,33 +92,35 @@ UINT8 *dc_transmap; // one of the translucency tables
 
 /**	\brief R_DrawTranslatedColumn uses this
 */
-UINT8 *dc_translation;
+RENDERLOCAL UINT8 *dc_translation;
 
 struct r_lightlist_s *dc_lightlist = NULL;
-INT32 dc_numlights = 0, dc_maxlights, dc_texheight;
+INT32 dc_numlights = 0, dc_maxlights;
+RENDERLOCAL INT32 dc_texheight;
 
 // =========================================================================
 //                      SPAN DRAWING CODE STUFF
 // =========================================================================
 
-INT32 ds_y, ds_x1, ds_x2;
-lighttable_t *ds_colormap;
-fixed_t ds_xfrac, ds_yfrac, ds_xstep, ds_ystep;
-UINT16 ds_flatwidth, ds_flatheight;
-boolean ds_powersoftwo;
+RENDERLOCAL INT32 ds_y, ds_x1, ds_x2;
+RENDERLOCAL lighttable_t *ds_colormap;
+RENDERLOCAL fixed_t ds_xfrac, ds_yfrac, ds_xstep, ds_ystep;
+RENDERLOCAL UINT16 ds_flatwidth, ds_flatheight;
+RENDERLOCAL boolean ds_powersoftwo;
 
-UINT8 *ds_source; // start of a 64*64 tile image
-UINT8 *ds_transmap; // one of the translucency tables
+RENDERLOCAL UINT8 *ds_source; // start of a 64*64 tile image
+RENDERLOCAL UINT8 *ds_transmap; // one of the translucency tables
 
 pslope_t *ds_slope; // Current slope being used
 floatv3_t ds_su[MAXVIDHEIGHT], ds_sv[MAXVIDHEIGHT], ds_sz[MAXVIDHEIGHT]; // Vectors for... stuff?
-floatv3_t *ds_sup, *ds_svp, *ds_szp;
-float focallengthf, zeroheight;
+RENDERLOCAL floatv3_t *ds_sup, *ds_svp, *ds_szp;
+float focallengthf;
+RENDERLOCAL float zeroheight;
 
 /**	\brief Variable flat sizes
 */
 
-UINT32 nflatxshift, nflatyshift, nflatshiftup, nflatmask;
+RENDERLOCAL UINT32 nflatxshift, nflatyshift, nflatshiftup, nflatmask;
 
 // ==========================================================================
 //                        OLD DOOM FUZZY EFFECT
@@ -669,6 +676,7 @@ void R_DrawViewBorder(void)
 
 #include "r_draw8.c"
 #include "r_draw8_npo2.c"
+#include "r_draw8_simd.c"
 
 // ==========================================================================
 //                   INCLUDE 16bpp DRAWING CODE HERE
@@ -677,3 +685,349 @@ void R_DrawViewBorder(void)
 #ifdef HIGHCOLOR
 #include "r_draw16.c"
 #endif
+
+#ifdef THREADEDRENDER
+// ==========================================================================
+//                        DEFERRED (THREADED) DRAWING
+// ==========================================================================
+
+// Each thread draws this many bands of screen rows, so that a thread stuck
+// with the busy part of the screen doesn't hold up all the others.
+#define BANDSPERTHREAD 2
+
+/**	\brief Everything a column drawer reads, as it was when the column was queued
+*/
+typedef struct
+{
+	lighttable_t *colormap;
+	UINT8 *source, *transmap, *translation;
+	INT32 x, yl, yh, texheight;
+	fixed_t iscale, texturemid, centeryfrac;
+	UINT8 hires;
+} drawcolumn_t;
+
+/**	\brief Everything a span drawer reads, as it was when the span was queued
+*/
+typedef struct
+{
+	lighttable_t *colormap, **planezlight;
+	UINT8 *source, *transmap;
+	INT32 y, x1, x2;
+	fixed_t xfrac, yfrac, xstep, ystep;
+	UINT16 flatwidth, flatheight;
+	boolean powersoftwo;
+	UINT32 nflatxshift, nflatyshift, nflatshiftup, nflatmask;
+	INT32 bgofs, waterofs;
+
+	// sloped planes
+	floatv3_t su, sv, sz;
+	float zeroheight;
+	INT32 centerx, centery;
+	fixed_t viewx, viewy, viewz, fovtan;
+} drawspan_t;
+
+typedef struct
+{
+	void (*func)(void);
+	boolean isspan;
+	union
+	{
+		drawcolumn_t column;
+		drawspan_t span;
+	} u;
+} drawcmd_t;
+
+boolean r_deferdraws = false;
+
+static drawcmd_t *drawcmds = NULL;
+static size_t numdrawcmds = 0, maxdrawcmds = 0;
+static INT32 numdrawbands = 0;
+
+// Drawer inputs made up on the spot, kept until the commands using them
+// have run. The chunks are reused from one flush to the next.
+typedef struct drawscratch_s
+{
+	struct drawscratch_s *next;
+	size_t used;
+} drawscratch_t;
+
+static drawscratch_t *drawscratch = NULL, *curdrawscratch = NULL;
+
+static void R_SaveColumnState(drawcolumn_t *c)
+{
+	c->colormap = dc_colormap;
+	c->source = dc_source;
+	c->transmap = dc_transmap;
+	c->translation = dc_translation;
+	c->x = dc_x;
+	c->yl = dc_yl;
+	c->yh = dc_yh;
+	c->texheight = dc_texheight;
+	c->iscale = dc_iscale;
+	c->texturemid = dc_texturemid;
+	c->centeryfrac = centeryfrac;
+	c->hires = dc_hires;
+}
+
+static void R_LoadColumnState(const drawcolumn_t *c)
+{
+	dc_colormap = c->colormap;
+	dc_source = c->source;
+	dc_transmap = c->transmap;
+	dc_translation = c->translation;
+	dc_x = c->x;
+	dc_yl = c->yl;
+	dc_yh = c->yh;
+	dc_texheight = c->texheight;
+	dc_iscale = c->iscale;
+	dc_texturemid = c->texturemid;
+	centeryfrac = c->centeryfrac;
+	dc_hires = c->hires;
+}
+
+static void R_SaveSpanState(drawspan_t *c)
+{
+	c->colormap = ds_colormap;
+	c->planezlight = planezlight;
+	c->source = ds_source;
+	c->transmap = ds_transmap;
+	c->y = ds_y;
+	c->x1 = ds_x1;
+	c->x2 = ds_x2;
+	c->xfrac = ds_xfrac;
+	c->yfrac = ds_yfrac;
+	c->xstep = ds_xstep;
+	c->ystep = ds_ystep;
+	c->flatwidth = ds_flatwidth;
+	c->flatheight = ds_flatheight;
+	c->powersoftwo = ds_powersoftwo;
+	c->nflatxshift = nflatxshift;
+	c->nflatyshift = nflatyshift;
+	c->nflatshiftup = nflatshiftup;
+	c->nflatmask = nflatmask;
+	c->bgofs = ds_bgofs;
+	c->waterofs = ds_waterofs;
+
+	// The slope vectors are rebuilt for every plane, so copy them, not the pointers
+	if (ds_sup)
+	{
+		c->su = *ds_sup;
+		c->sv = *ds_svp;
+		c->sz = *ds_szp;
+	}
+	c->zeroheight = zeroheight;
+	c->centerx = centerx;
+	c->centery = centery;
+	c->viewx = viewx;
+	c->viewy = viewy;
+	c->viewz = viewz;
+	c->fovtan = fovtan;
+}
+
+static void R_LoadSpanState(drawspan_t *c)
+{
+	ds_colormap = c->colormap;
+	planezlight = c->planezlight;
+	ds_source = c->source;
+	ds_transmap = c->transmap;
+	ds_y = c->y;
+	ds_x1 = c->x1;
+	ds_x2 = c->x2;
+	ds_xfrac = c->xfrac;
+	ds_yfrac = c->yfrac;
+	ds_xstep = c->xstep;
+	ds_ystep = c->ystep;
+	ds_flatwidth = c->flatwidth;
+	ds_flatheight = c->flatheight;
+	ds_powersoftwo = c->powersoftwo;
+	nflatxshift = c->nflatxshift;
+	nflatyshift = c->nflatyshift;
+	nflatshiftup = c->nflatshiftup;
+	nflatmask = c->nflatmask;
+	ds_bgofs = c->bgofs;
+	ds_waterofs = c->waterofs;
+
+	ds_sup = &c->su;
+	ds_svp = &c->sv;
+	ds_szp = &c->sz;
+	zeroheight = c->zeroheight;
+	centerx = c->centerx;
+	centery = c->centery;
+	viewx = c->viewx;
+	viewy = c->viewy;
+	viewz = c->viewz;
+	fovtan = c->fovtan;
+}
+
+static drawcmd_t *R_NewDrawCommand(void (*func)(void), boolean isspan)
+{
+	drawcmd_t *cmd;
+
+	if (numdrawcmds >= maxdrawcmds)
+	{
+		maxdrawcmds = maxdrawcmds ? maxdrawcmds*2 : 8192;
+		Z_Realloc(drawcmds, maxdrawcmds * sizeof (*drawcmds), PU_STATIC, &drawcmds);
+	}
+
+	cmd = &drawcmds[numdrawcmds++];
+	cmd->func = func;
+	cmd->isspan = isspan;
+	return cmd;
+}
+
+/**	\brief	Queues a column drawer call with the current dc_ state.
+
+	\param	func	the column drawer
+*/
+void R_DeferColumn(void (*func)(void))
+{
+	// The shadowed drawer reads the shared light list and hands each
+	// lit piece of the column to the normal drawer, which gets queued.
+	if (func == R_DrawColumnShadowed_8)
+	{
+		func();
+		return;
+	}
+
+	R_SaveColumnState(&R_NewDrawCommand(func, false)->u.column);
+}
+
+/**	\brief	Queues a span drawer call with the current ds_ state.
+
+	\param	func	the span drawer
+*/
+void R_DeferSpan(void (*func)(void))
+{
+	R_SaveSpanState(&R_NewDrawCommand(func, true)->u.span);
+}
+
+/**	\brief	Gets memory for a queued drawer's input that stays put until
+	the queue is flushed.
+
+	\param	size	how much, at most DRAWSCRATCHSIZE bytes
+	\return	the memory
+*/
+UINT8 *R_DeferScratch(size_t size)
+{
+	UINT8 *p;
+
+	if (!curdrawscratch || curdrawscratch->used + size > DRAWSCRATCHSIZE)
+	{
+		drawscratch_t *next = curdrawscratch ? curdrawscratch->next : drawscratch;
+
+		if (!next)
+		{
+			next = Z_Malloc(sizeof (*next) + DRAWSCRATCHSIZE, PU_STATIC, NULL);
+			next->next = NULL;
+			if (curdrawscratch)
+				curdrawscratch->next = next;
+			else
+				drawscratch = next;
+		}
+
+		next->used = 0;
+		curdrawscratch = next;
+	}
+
+	p = (UINT8 *)(curdrawscratch + 1) + curdrawscratch->used;
+	curdrawscratch->used += size;
+	return p;
+}
+
+/**	\brief	Runs every queued command that touches one band of rows.
+
+	Every pixel belongs to exactly one band, and the commands are run in
+	the order they were queued, so each pixel is written in the same order
+	as the serial renderer would. Spans cover a single row and are never
+	split; columns are clipped to the band, which is exact since the
+	drawers work out their texture position from dc_yl.
+*/
+static void R_DrawBand(void *userdata, size_t band, INT32 thread)
+{
+	INT32 top = (INT32)(band * viewheight / numdrawbands);
+	INT32 bottom = (INT32)((band + 1) * viewheight / numdrawbands) - 1;
+	int starttime = I_GetTimeMicros();
+	drawcmd_t *cmd, *end = drawcmds + numdrawcmds;
+
+	(void)userdata;
+
+	for (cmd = drawcmds; cmd < end; cmd++)
+	{
+		if (cmd->isspan)
+		{
+			if (cmd->u.span.y < top || cmd->u.span.y > bottom)
+				continue;
+			R_LoadSpanState(&cmd->u.span);
+		}
+		else
+		{
+			if (cmd->u.column.yh < top || cmd->u.column.yl > bottom)
+				continue;
+			R_LoadColumnState(&cmd->u.column);
+			if (dc_yl < top)
+				dc_yl = top;
+			if (dc_yh > bottom)
+				dc_yh = bottom;
+		}
+		cmd->func();
+	}
+
+	rs_sw_threadtime[thread] += I_GetTimeMicros() - starttime;
+}
+
+/**	\brief	Starts queueing drawer calls for this view, if renderthreads asks for it.
+*/
+void R_StartDeferredDrawing(void)
+{
+	INT32 i;
+
+	rs_sw_numthreads = min(cv_renderthreads.value, I_NumJobThreads());
+	numdrawbands = rs_sw_numthreads * BANDSPERTHREAD;
+	numdrawcmds = 0;
+	r_deferdraws = (rs_sw_numthreads > 1);
+
+	rs_sw_drawtime = 0;
+	for (i = 0; i < MAXRENDERTHREADS; i++)
+		rs_sw_threadtime[i] = 0;
+}
+
+/**	\brief	Draws everything queued so far, over all render threads.
+	Call this before reading back anything from the screen.
+*/
+void R_FlushDeferredDrawing(void)
+{
+	drawcolumn_t column;
+	drawspan_t span;
+	floatv3_t *sup = ds_sup, *svp = ds_svp, *szp = ds_szp;
+	int starttime;
+
+	if (!numdrawcmds)
+		return;
+
+	starttime = I_GetTimeMicros();
+
+	// This thread draws bands too, which tramples its own drawer state
+	R_SaveColumnState(&column);
+	R_SaveSpanState(&span);
+
+	I_RunJobs(R_DrawBand, NULL, numdrawbands, rs_sw_numthreads);
+
+	R_LoadColumnState(&column);
+	R_LoadSpanState(&span);
+	ds_sup = sup;
+	ds_svp = svp;
+	ds_szp = szp;
+
+	numdrawcmds = 0;
+	curdrawscratch = NULL;
+	rs_sw_drawtime += I_GetTimeMicros() - starttime;
+}
+
+/**	\brief	Draws everything still queued and goes back to drawing straight away.
+*/
+void R_FinishDeferredDrawing(void)
+{
+	R_FlushDeferredDrawing();
+	r_deferdraws = false;
+}
+#endif
@@ -29,38 +29,38 @@ extern UINT8 *topleft;
 // COLUMN DRAWING CODE STUFF
 // -------------------------
 
-extern lighttable_t *dc_colormap;
-extern INT32 dc_x, dc_yl, dc_yh;
-extern fixed_t dc_iscale, dc_texturemid;
-extern UINT8 dc_hires;
+extern RENDERLOCAL lighttable_t *dc_colormap;
+extern RENDERLOCAL INT32 dc_x, dc_yl, dc_yh;
+extern RENDERLOCAL fixed_t dc_iscale, dc_texturemid;
+extern RENDERLOCAL UINT8 dc_hires;
 
-extern UINT8 *dc_source; // first pixel in a column
+extern RENDERLOCAL UINT8 *dc_source; // first pixel in a column
 
 // translucency stuff here
 extern UINT8 *transtables; // translucency tables, should be (*transtables)[5][256][256]
-extern UINT8 *dc_transmap;
+extern RENDERLOCAL UINT8 *dc_transmap;
 
 // translation stuff here
 
-extern UINT8 *dc_translation;
+extern RENDERLOCAL UINT8 *dc_translation;
 
 extern struct r_lightlist_s *dc_lightlist;
 extern INT32 dc_numlights, dc_maxlights;
 
 //Fix TUTIFRUTI
-extern INT32 dc_texheight;
+extern RENDERLOCAL INT32 dc_texheight;
 
 // -----------------------
 // SPAN DRAWING CODE STUFF
 // -----------------------
 
-extern INT32 ds_y, ds_x1, ds_x2;
-extern lighttable_t *ds_colormap;
-extern fixed_t ds_xfrac, ds_yfrac, ds_xstep, ds_ystep;
-extern UINT16 ds_flatwidth, ds_flatheight;
-extern boolean ds_powersoftwo;
-extern UINT8 *ds_source;
-extern UINT8 *ds_transmap;
+extern RENDERLOCAL INT32 ds_y, ds_x1, ds_x2;
+extern RENDERLOCAL lighttable_t *ds_colormap;
+extern RENDERLOCAL fixed_t ds_xfrac, ds_yfrac, ds_xstep, ds_ystep;
+extern RENDERLOCAL UINT16 ds_flatwidth, ds_flatheight;
+extern RENDERLOCAL boolean ds_powersoftwo;
+extern RENDERLOCAL UINT8 *ds_source;
+extern RENDERLOCAL UINT8 *ds_transmap;
 
 typedef struct {
 	float x, y, z;
@@ -68,14 +68,15 @@ typedef struct {
 
 extern pslope_t *ds_slope; // Current slope being used
 extern floatv3_t ds_su[MAXVIDHEIGHT], ds_sv[MAXVIDHEIGHT], ds_sz[MAXVIDHEIGHT]; // Vectors for... stuff?
-extern floatv3_t *ds_sup, *ds_svp, *ds_szp;
-extern float focallengthf, zeroheight;
+extern RENDERLOCAL floatv3_t *ds_sup, *ds_svp, *ds_szp;
+extern float focallengthf;
+extern RENDERLOCAL float zeroheight;
 
 // Variable flat sizes
-extern UINT32 nflatxshift;
-extern UINT32 nflatyshift;
-extern UINT32 nflatshiftup;
-extern UINT32 nflatmask;
+extern RENDERLOCAL UINT32 nflatxshift;
+extern RENDERLOCAL UINT32 nflatyshift;
+extern RENDERLOCAL UINT32 nflatshiftup;
+extern RENDERLOCAL UINT32 nflatmask;
 
 /// \brief Top border
 #define BRDR_T 0
@@ -122,6 +123,27 @@ void R_InitViewBuffer(INT32 width, INT32 height);
 void R_InitViewBorder(void);
 void R_VideoErase(size_t ofs, INT32 count);
 
+// Calling a column or span drawer. With renderthreads on, the call is queued
+// with a copy of the drawer's inputs and run later, split up by screen rows.
+#ifdef THREADEDRENDER
+extern boolean r_deferdraws;
+
+void R_StartDeferredDrawing(void);
+void R_FlushDeferredDrawing(void);
+void R_FinishDeferredDrawing(void);
+void R_DeferColumn(void (*func)(void));
+void R_DeferSpan(void (*func)(void));
+
+#define DRAWSCRATCHSIZE (64*1024)
+UINT8 *R_DeferScratch(size_t size);
+
+#define R_DRAWCOLUMN(func) (r_deferdraws ? R_DeferColumn(func) : (func)())
+#define R_DRAWSPAN(func) (r_deferdraws ? R_DeferSpan(func) : (func)())
+#else
+#define R_DRAWCOLUMN(func) (func)()
+#define R_DRAWSPAN(func) (func)()
+#endif
+
 // Rendering function.
 #if 0
 void R_FillBackScreen(void);
@@ -157,11 +179,11 @@ void R_DrawTiltedTranslucentWaterSpan_8(void);
 #endif
 void R_DrawTiltedSplat_8(void);
 void R_CalcTiltedLighting(fixed_t start, fixed_t end);
-extern INT32 tiltlighting[MAXVIDWIDTH];
+extern RENDERLOCAL INT32 tiltlighting[MAXVIDWIDTH];
 #ifndef NOWATER
 void R_DrawTranslucentWaterSpan_8(void);
-extern INT32 ds_bgofs;
-extern INT32 ds_waterofs;
+extern RENDERLOCAL INT32 ds_bgofs;
+extern RENDERLOCAL INT32 ds_waterofs;
 #endif
 void R_DrawFogSpan_8(void);
 
@@ -180,6 +202,13 @@ void R_DrawTiltedSplat_NPO2_8(void);
 void R_DrawTranslucentWaterSpan_NPO2_8(void);
 #endif
 
+// Vectorised drawers, see r_draw8_simd.c
+boolean R_InitSIMDDrawers(void);
+void R_DrawSpan_8_SIMD(void);
+void R_DrawTranslucentSpan_8_SIMD(void);
+void R_DrawTiltedSpan_8_SIMD(void);
+void R_DrawTiltedTranslucentSpan_8_SIMD(void);
+
 #ifdef USEASM
 void ASMCALL R_DrawColumn_8_ASM(void);
 void ASMCALL R_DrawShadeColumn_8_ASM(void);
@@ -0,0 +1,770 @@
+// SONIC ROBO BLAST 2
+//-----------------------------------------------------------------------------
+// Copyright (C) 1998-2000 by DooM Legacy Team.
+// Copyright (C) 1999-2020 by Sonic Team Junior.
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  r_draw8_simd.c
+/// \brief 8bpp span drawer functions with vectorised texture addressing
+/// \note  no includes because this is included as part of r_draw.c
+
+// The slow part of a span isn't the lookups themselves, it's working out
+// where in the flat every pixel lands. These drawers hand that off to a
+// kernel that does 4 or 8 pixels at once (SSE2, AVX2 or NEON, picked at
+// startup by R_InitSIMDDrawers) and then do the lookups as usual. The
+// kernels use the same integer maths as the plain drawers, so the output
+// is exactly the same; R_InitSIMDDrawers checks this before using them,
+// kernel by kernel and then drawer by drawer, pixel for pixel.
+//
+// Only the flat, translucent and tilted power-of-two span drawers have
+// versions here. The column drawers (R_DrawTranslucentColumn_8 and the
+// rest) step down a single texture column, so there's no addressing to
+// speed up, and they stay as they are.
+
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__)) \
+	&& ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined (__clang__))
+#define SIMD_X86
+#elif defined (_MSC_VER) && (defined (_M_IX86) || defined (_M_X64))
+#define SIMD_X86
+#endif
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+/**	\brief	Works out the flat offset of count pixels along a span.
+
+	\param	idx	where to put them; may be written up to 7 entries past count
+	\param	x	starting x position, already shifted up by nflatshiftup
+	\param	y	starting y position, likewise
+	\param	xstep	x step per pixel
+	\param	ystep	y step per pixel
+	\param	count	number of pixels
+*/
+typedef void (*spanindexfunc_t)(UINT32 *idx, UINT32 x, UINT32 y, UINT32 xstep, UINT32 ystep, INT32 count);
+
+/**	\brief	Fills tiltlighting[left..right] the same way R_CalcTiltedLighting does.
+*/
+typedef void (*tiltlightfunc_t)(INT32 left, INT32 right, fixed_t start, fixed_t step);
+
+static spanindexfunc_t R_SpanIndices = NULL;
+static tiltlightfunc_t R_TiltedLighting = NULL;
+
+// Room for a whole span plus the kernels' overrun
+static RENDERLOCAL UINT32 spanindex[MAXVIDWIDTH + 8];
+
+// ==========================================================================
+//                              REFERENCE KERNELS
+// ==========================================================================
+
+static void R_SpanIndices_C(UINT32 *idx, UINT32 x, UINT32 y, UINT32 xstep, UINT32 ystep, INT32 count)
+{
+	for (; count > 0; count--)
+	{
+		*idx++ = ((y >> nflatyshift) & nflatmask) | (x >> nflatxshift);
+		x += xstep;
+		y += ystep;
+	}
+}
+
+static void R_TiltedLighting_C(INT32 left, INT32 right, fixed_t start, fixed_t step)
+{
+	INT32 i;
+
+	for (i = left; i <= right; i++)
+	{
+		tiltlighting[i] = (start += step) >> FRACBITS;
+		if (tiltlighting[i] < 0)
+			tiltlighting[i] = 0;
+		else if (tiltlighting[i] >= MAXLIGHTSCALE)
+			tiltlighting[i] = MAXLIGHTSCALE-1;
+	}
+}
+
+// ==========================================================================
+//                                 x86 KERNELS
+// ==========================================================================
+
+#ifdef SIMD_X86
+static FUNCTARGET("sse2") void R_SpanIndices_SSE2(UINT32 *idx, UINT32 x, UINT32 y, UINT32 xstep, UINT32 ystep, INT32 count)
+{
+	const __m128i xshift = _mm_cvtsi32_si128(nflatxshift);
+	const __m128i yshift = _mm_cvtsi32_si128(nflatyshift);
+	const __m128i mask = _mm_set1_epi32(nflatmask);
+	const __m128i xstep4 = _mm_set1_epi32(xstep*4);
+	const __m128i ystep4 = _mm_set1_epi32(ystep*4);
+	__m128i xv = _mm_setr_epi32(x, x + xstep, x + xstep*2, x + xstep*3);
+	__m128i yv = _mm_setr_epi32(y, y + ystep, y + ystep*2, y + ystep*3);
+	INT32 i;
+
+	for (i = 0; i < count; i += 4)
+	{
+		__m128i v = _mm_and_si128(_mm_srl_epi32(yv, yshift), mask);
+		v = _mm_or_si128(v, _mm_srl_epi32(xv, xshift));
+		_mm_storeu_si128((__m128i *)(idx + i), v);
+		xv = _mm_add_epi32(xv, xstep4);
+		yv = _mm_add_epi32(yv, ystep4);
+	}
+}
+
+static FUNCTARGET("sse2") void R_TiltedLighting_SSE2(INT32 left, INT32 right, fixed_t start, fixed_t step)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i top = _mm_set1_epi32(MAXLIGHTSCALE-1);
+	const __m128i step4 = _mm_set1_epi32((UINT32)step*4);
+	__m128i sv = _mm_setr_epi32((UINT32)start + step, (UINT32)start + (UINT32)step*2, (UINT32)start + (UINT32)step*3, (UINT32)start + (UINT32)step*4);
+	INT32 i;
+
+	for (i = left; i + 3 <= right; i += 4)
+	{
+		__m128i l = _mm_srai_epi32(sv, FRACBITS);
+		__m128i over;
+
+		l = _mm_andnot_si128(_mm_cmplt_epi32(l, zero), l);
+		over = _mm_cmpgt_epi32(l, top);
+		l = _mm_or_si128(_mm_and_si128(over, top), _mm_andnot_si128(over, l));
+		_mm_storeu_si128((__m128i *)&tiltlighting[i], l);
+		sv = _mm_add_epi32(sv, step4);
+	}
+
+	// Whatever doesn't fill a vector. Lane 0 is one step ahead of start.
+	R_TiltedLighting_C(i, right, (fixed_t)((UINT32)_mm_cvtsi128_si32(sv) - step), step);
+}
+
+static FUNCTARGET("avx2") void R_SpanIndices_AVX2(UINT32 *idx, UINT32 x, UINT32 y, UINT32 xstep, UINT32 ystep, INT32 count)
+{
+	const __m128i xshift = _mm_cvtsi32_si128(nflatxshift);
+	const __m128i yshift = _mm_cvtsi32_si128(nflatyshift);
+	const __m256i mask = _mm256_set1_epi32(nflatmask);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i xstep8 = _mm256_set1_epi32(xstep*8);
+	const __m256i ystep8 = _mm256_set1_epi32(ystep*8);
+	__m256i xv = _mm256_add_epi32(_mm256_set1_epi32(x), _mm256_mullo_epi32(_mm256_set1_epi32(xstep), lanes));
+	__m256i yv = _mm256_add_epi32(_mm256_set1_epi32(y), _mm256_mullo_epi32(_mm256_set1_epi32(ystep), lanes));
+	INT32 i;
+
+	for (i = 0; i < count; i += 8)
+	{
+		__m256i v = _mm256_and_si256(_mm256_srl_epi32(yv, yshift), mask);
+		v = _mm256_or_si256(v, _mm256_srl_epi32(xv, xshift));
+		_mm256_storeu_si256((__m256i *)(idx + i), v);
+		xv = _mm256_add_epi32(xv, xstep8);
+		yv = _mm256_add_epi32(yv, ystep8);
+	}
+}
+
+static FUNCTARGET("avx2") void R_TiltedLighting_AVX2(INT32 left, INT32 right, fixed_t start, fixed_t step)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i top = _mm256_set1_epi32(MAXLIGHTSCALE-1);
+	const __m256i lanes = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8);
+	const __m256i step8 = _mm256_set1_epi32((UINT32)step*8);
+	__m256i sv = _mm256_add_epi32(_mm256_set1_epi32(start), _mm256_mullo_epi32(_mm256_set1_epi32(step), lanes));
+	INT32 i;
+
+	for (i = left; i + 7 <= right; i += 8)
+	{
+		__m256i l = _mm256_srai_epi32(sv, FRACBITS);
+		l = _mm256_min_epi32(_mm256_max_epi32(l, zero), top);
+		_mm256_storeu_si256((__m256i *)&tiltlighting[i], l);
+		sv = _mm256_add_epi32(sv, step8);
+	}
+
+	R_TiltedLighting_C(i, right, (fixed_t)((UINT32)_mm_cvtsi128_si32(_mm256_castsi256_si128(sv)) - step), step);
+}
+#endif
+
+// ==========================================================================
+//                                 ARM KERNELS
+// ==========================================================================
+
+#ifdef SIMD_NEON
+static void R_SpanIndices_NEON(UINT32 *idx, UINT32 x, UINT32 y, UINT32 xstep, UINT32 ystep, INT32 count)
+{
+	// NEON only shifts right by a constant, so shift left by a negative amount
+	const int32x4_t xshift = vdupq_n_s32(-(INT32)nflatxshift);
+	const int32x4_t yshift = vdupq_n_s32(-(INT32)nflatyshift);
+	const uint32x4_t mask = vdupq_n_u32(nflatmask);
+	const uint32x4_t xstep4 = vdupq_n_u32(xstep*4);
+	const uint32x4_t ystep4 = vdupq_n_u32(ystep*4);
+	const UINT32 xstart[4] = {x, x + xstep, x + xstep*2, x + xstep*3};
+	const UINT32 ystart[4] = {y, y + ystep, y + ystep*2, y + ystep*3};
+	uint32x4_t xv = vld1q_u32(xstart);
+	uint32x4_t yv = vld1q_u32(ystart);
+	INT32 i;
+
+	for (i = 0; i < count; i += 4)
+	{
+		uint32x4_t v = vandq_u32(vshlq_u32(yv, yshift), mask);
+		v = vorrq_u32(v, vshlq_u32(xv, xshift));
+		vst1q_u32(idx + i, v);
+		xv = vaddq_u32(xv, xstep4);
+		yv = vaddq_u32(yv, ystep4);
+	}
+}
+
+static void R_TiltedLighting_NEON(INT32 left, INT32 right, fixed_t start, fixed_t step)
+{
+	const int32x4_t zero = vdupq_n_s32(0);
+	const int32x4_t top = vdupq_n_s32(MAXLIGHTSCALE-1);
+	const int32x4_t step4 = vdupq_n_s32((INT32)((UINT32)step*4));
+	const INT32 first[4] = {(INT32)((UINT32)start + step), (INT32)((UINT32)start + (UINT32)step*2), (INT32)((UINT32)start + (UINT32)step*3), (INT32)((UINT32)start + (UINT32)step*4)};
+	int32x4_t sv = vld1q_s32(first);
+	INT32 i;
+
+	for (i = left; i + 3 <= right; i += 4)
+	{
+		int32x4_t l = vshrq_n_s32(sv, FRACBITS);
+		l = vminq_s32(vmaxq_s32(l, zero), top);
+		vst1q_s32(&tiltlighting[i], l);
+		sv = vaddq_s32(sv, step4);
+	}
+
+	R_TiltedLighting_C(i, right, (fixed_t)((UINT32)vgetq_lane_s32(sv, 0) - step), step);
+}
+#endif
+
+// ==========================================================================
+//                                   DRAWERS
+// ==========================================================================
+
+/**	\brief The R_DrawSpan_8_SIMD function
+	R_DrawSpan_8 with the addressing done by R_SpanIndices.
+*/
+void R_DrawSpan_8_SIMD(void)
+{
+	const UINT8 *deststop = screens[0] + vid.rowbytes * vid.height;
+	UINT8 *source = ds_source;
+	UINT8 *colormap = ds_colormap;
+	UINT8 *dest = ylookup[ds_y] + columnofs[ds_x1];
+	INT32 count = ds_x2 - ds_x1 + 1;
+	INT32 i, unchecked = count & ~7;
+
+	if (dest+8 > deststop)
+		return;
+
+	R_SpanIndices(spanindex, (UINT32)ds_xfrac << nflatshiftup, (UINT32)ds_yfrac << nflatshiftup,
+		(UINT32)ds_xstep << nflatshiftup, (UINT32)ds_ystep << nflatshiftup, count);
+
+	// Like R_DrawSpan_8, only the leftover pixels are checked against the end of the screen
+	for (i = 0; i < unchecked; i++)
+		dest[i] = colormap[source[spanindex[i]]];
+	for (; i < count && dest+i <= deststop; i++)
+		dest[i] = colormap[source[spanindex[i]]];
+}
+
+/**	\brief The R_DrawTranslucentSpan_8_SIMD function
+	R_DrawTranslucentSpan_8 with the addressing done by R_SpanIndices.
+*/
+void R_DrawTranslucentSpan_8_SIMD(void)
+{
+	const UINT8 *deststop = screens[0] + vid.rowbytes * vid.height;
+	UINT8 *source = ds_source;
+	UINT8 *colormap = ds_colormap;
+	UINT8 *transmap = ds_transmap;
+	UINT8 *dest = ylookup[ds_y] + columnofs[ds_x1];
+	INT32 count = ds_x2 - ds_x1 + 1;
+	INT32 i, unchecked = count & ~7;
+
+	if (count <= 0)
+		return;
+
+	R_SpanIndices(spanindex, (UINT32)ds_xfrac << nflatshiftup, (UINT32)ds_yfrac << nflatshiftup,
+		(UINT32)ds_xstep << nflatshiftup, (UINT32)ds_ystep << nflatshiftup, count);
+
+	for (i = 0; i < unchecked; i++)
+		dest[i] = *(transmap + (colormap[source[spanindex[i]]] << 8) + dest[i]);
+	for (; i < count && dest+i <= deststop; i++)
+		dest[i] = *(transmap + (colormap[source[spanindex[i]]] << 8) + dest[i]);
+}
+
+/**	\brief	Shared by the tilted drawers: works out the texture position
+	and light level of every pixel in the span, the same way
+	R_DrawTiltedSpan_8 does, then leaves the flat offsets in spanindex[].
+
+	\param	planelightfloat	PLANELIGHTFLOAT, taken as is so the self-test
+		doesn't depend on the view
+*/
+static void R_TiltedSpanIndices(float planelightfloat)
+{
+	// x1, x2 = ds_x1, ds_x2
+	int width = ds_x2 - ds_x1;
+	double iz, uz, vz;
+	UINT32 u, v;
+	UINT32 *idx = spanindex;
+
+	double startz, startu, startv;
+	double izstep, uzstep, vzstep;
+	double endz, endu, endv;
+	UINT32 stepu, stepv;
+
+	iz = ds_szp->z + ds_szp->y*(centery-ds_y) + ds_szp->x*(ds_x1-centerx);
+
+	// Lighting is simple. It's just linear interpolation from start to end
+	{
+		float lightstart, lightend;
+		fixed_t start, end;
+
+		lightend = (iz + ds_szp->x*width) * planelightfloat;
+		lightstart = iz * planelightfloat;
+
+		start = FLOAT_TO_FIXED(lightstart);
+		end = FLOAT_TO_FIXED(lightend);
+		R_TiltedLighting(ds_x1, ds_x2, start, (end-start)/(ds_x2-ds_x1+1));
+	}
+
+	uz = ds_sup->z + ds_sup->y*(centery-ds_y) + ds_sup->x*(ds_x1-centerx);
+	vz = ds_svp->z + ds_svp->y*(centery-ds_y) + ds_svp->x*(ds_x1-centerx);
+
+	startz = 1.f/iz;
+	startu = uz*startz;
+	startv = vz*startz;
+
+	izstep = ds_szp->x * SPANSIZE;
+	uzstep = ds_sup->x * SPANSIZE;
+	vzstep = ds_svp->x * SPANSIZE;
+	width++;
+
+	while (width >= SPANSIZE)
+	{
+		iz += izstep;
+		uz += uzstep;
+		vz += vzstep;
+
+		endz = 1.f/iz;
+		endu = uz*endz;
+		endv = vz*endz;
+		stepu = (INT64)((endu - startu) * INVSPAN);
+		stepv = (INT64)((endv - startv) * INVSPAN);
+		u = (INT64)(startu) + viewx;
+		v = (INT64)(startv) + viewy;
+
+		R_SpanIndices(idx, u, v, stepu, stepv, SPANSIZE);
+		idx += SPANSIZE;
+
+		startu = endu;
+		startv = endv;
+		width -= SPANSIZE;
+	}
+	if (width > 0)
+	{
+		if (width == 1)
+		{
+			// Yes, this one leaves out viewx and viewy. So does R_DrawTiltedSpan_8.
+			u = (INT64)(startu);
+			v = (INT64)(startv);
+			*idx = ((v >> nflatyshift) & nflatmask) | (u >> nflatxshift);
+		}
+		else
+		{
+			double left = width;
+			iz += ds_szp->x * left;
+			uz += ds_sup->x * left;
+			vz += ds_svp->x * left;
+
+			endz = 1.f/iz;
+			endu = uz*endz;
+			endv = vz*endz;
+			left = 1.f/left;
+			stepu = (INT64)((endu - startu) * left);
+			stepv = (INT64)((endv - startv) * left);
+			u = (INT64)(startu) + viewx;
+			v = (INT64)(startv) + viewy;
+
+			R_SpanIndices(idx, u, v, stepu, stepv, width);
+		}
+	}
+}
+
+/**	\brief The R_DrawTiltedSpan_8_SIMD function
+	R_DrawTiltedSpan_8 with the addressing done by R_SpanIndices.
+*/
+void R_DrawTiltedSpan_8_SIMD(void)
+{
+	UINT8 *source = ds_source;
+	UINT8 *dest = ylookup[ds_y] + columnofs[ds_x1];
+	const size_t cmapofs = ds_colormap - colormaps;
+	INT32 i, count = ds_x2 - ds_x1 + 1;
+	INT32 *light = &tiltlighting[ds_x1];
+
+	R_TiltedSpanIndices(PLANELIGHTFLOAT);
+
+	for (i = 0; i < count; i++)
+		dest[i] = planezlight[light[i]][cmapofs + source[spanindex[i]]];
+}
+
+/**	\brief The R_DrawTiltedTranslucentSpan_8_SIMD function
+	R_DrawTiltedTranslucentSpan_8 with the addressing done by R_SpanIndices.
+*/
+void R_DrawTiltedTranslucentSpan_8_SIMD(void)
+{
+	UINT8 *source = ds_source;
+	UINT8 *transmap = ds_transmap;
+	UINT8 *dest = ylookup[ds_y] + columnofs[ds_x1];
+	const size_t cmapofs = ds_colormap - colormaps;
+	INT32 i, count = ds_x2 - ds_x1 + 1;
+	INT32 *light = &tiltlighting[ds_x1];
+
+	R_TiltedSpanIndices(PLANELIGHTFLOAT);
+
+	for (i = 0; i < count; i++)
+		dest[i] = *(transmap + (planezlight[light[i]][cmapofs + source[spanindex[i]]] << 8) + dest[i]);
+}
+
+// ==========================================================================
+//                                  DISPATCH
+// ==========================================================================
+
+/**	\brief	Runs a kernel pair against the reference kernels on a spread of
+	made-up spans, both on their own and through R_TiltedSpanIndices,
+	and reports whether every result matched.
+*/
+static boolean R_CheckSIMDKernels(spanindexfunc_t spanindices, tiltlightfunc_t tiltedlighting)
+{
+	static UINT32 expect[MAXVIDWIDTH + 8];
+	static INT32 expectlight[MAXVIDWIDTH];
+	UINT32 oldxshift = nflatxshift, oldyshift = nflatyshift, oldmask = nflatmask;
+	spanindexfunc_t oldspanindices = R_SpanIndices;
+	tiltlightfunc_t oldtiltedlighting = R_TiltedLighting;
+	floatv3_t *oldsup = ds_sup, *oldsvp = ds_svp, *oldszp = ds_szp;
+	INT32 oldy = ds_y, oldx1 = ds_x1, oldx2 = ds_x2;
+	floatv3_t su, sv, sz;
+	UINT32 seed = 0x5EED1E55;
+	boolean ok = true;
+	INT32 i, n;
+
+#define NEXTRAND (seed = seed*1664525 + 1013904223)
+#define NEXTFLOAT ((float)(INT32)NEXTRAND / 2147483648.0f) // -1 to 1
+
+	for (n = 0; n < 256 && ok; n++)
+	{
+		INT32 count = 1 + (NEXTRAND >> 8) % (MAXVIDWIDTH - 1);
+		INT32 left = (NEXTRAND >> 8) % (MAXVIDWIDTH - count + 1);
+		UINT32 x = NEXTRAND, y = NEXTRAND, xstep = NEXTRAND, ystep = NEXTRAND;
+		UINT32 bits = 6 + (NEXTRAND >> 8) % 6; // flats from 64 to 2048 wide
+
+		nflatxshift = 32 - bits;
+		nflatyshift = nflatxshift - bits;
+		nflatmask = ((1 << bits) - 1) << bits;
+
+		R_SpanIndices_C(expect, x, y, xstep, ystep, count);
+		spanindices(spanindex, x, y, xstep, ystep, count);
+		for (i = 0; i < count; i++)
+			if (spanindex[i] != expect[i])
+				ok = false;
+
+		// Make sure the clamping gets a workout too
+		x = (x & 0x00FFFFFF) - 0x00200000;
+		xstep = ((INT32)xstep >> 20);
+		R_TiltedLighting_C(left, left+count-1, (fixed_t)x, (fixed_t)xstep);
+		memcpy(expectlight + left, tiltlighting + left, count * sizeof (*tiltlighting));
+		memset(tiltlighting + left, 0xFF, count * sizeof (*tiltlighting));
+		tiltedlighting(left, left+count-1, (fixed_t)x, (fixed_t)xstep);
+		for (i = left; i < left+count; i++)
+			if (tiltlighting[i] != expectlight[i])
+				ok = false;
+	}
+
+	// Now whole tilted spans, which cover the leftover pixels and the
+	// single pixel case. The planes are kept in front of the view, and
+	// the light scaled so that it gets clamped at both ends.
+	ds_sup = &su;
+	ds_svp = &sv;
+	ds_szp = &sz;
+	for (n = 0; n < 64 && ok; n++)
+	{
+		INT32 count = 1 + (NEXTRAND >> 8) % (n & 1 ? 2*SPANSIZE : MAXVIDWIDTH - 1);
+		INT32 left = (NEXTRAND >> 8) % (MAXVIDWIDTH - count + 1);
+		UINT32 bits = 6 + (NEXTRAND >> 8) % 6;
+		float planelightfloat = 64.0f * NEXTFLOAT;
+
+		nflatxshift = 32 - bits;
+		nflatyshift = nflatxshift - bits;
+		nflatmask = ((1 << bits) - 1) << bits;
+
+		sz.x = NEXTFLOAT / (4*MAXVIDWIDTH);
+		sz.y = NEXTFLOAT / (4*MAXVIDHEIGHT);
+		sz.z = 2.0f + NEXTFLOAT;
+		su.x = NEXTFLOAT * 1048576.0f;
+		su.y = NEXTFLOAT * 1048576.0f;
+		su.z = NEXTFLOAT * 1073741824.0f;
+		sv.x = NEXTFLOAT * 1048576.0f;
+		sv.y = NEXTFLOAT * 1048576.0f;
+		sv.z = NEXTFLOAT * 1073741824.0f;
+		ds_y = (NEXTRAND >> 8) % MAXVIDHEIGHT;
+		ds_x1 = left;
+		ds_x2 = left + count - 1;
+
+		R_SpanIndices = R_SpanIndices_C;
+		R_TiltedLighting = R_TiltedLighting_C;
+		R_TiltedSpanIndices(planelightfloat);
+		memcpy(expect, spanindex, count * sizeof (*spanindex));
+		memcpy(expectlight + left, tiltlighting + left, count * sizeof (*tiltlighting));
+
+		R_SpanIndices = spanindices;
+		R_TiltedLighting = tiltedlighting;
+		memset(tiltlighting + left, 0xFF, count * sizeof (*tiltlighting));
+		R_TiltedSpanIndices(planelightfloat);
+		for (i = 0; i < count; i++)
+			if (spanindex[i] != expect[i] || tiltlighting[left+i] != expectlight[left+i])
+				ok = false;
+	}
+
+#undef NEXTFLOAT
+#undef NEXTRAND
+
+	R_SpanIndices = oldspanindices;
+	R_TiltedLighting = oldtiltedlighting;
+	ds_sup = oldsup;
+	ds_svp = oldsvp;
+	ds_szp = oldszp;
+	ds_y = oldy;
+	ds_x1 = oldx1;
+	ds_x2 = oldx2;
+	nflatxshift = oldxshift;
+	nflatyshift = oldyshift;
+	nflatmask = oldmask;
+	return ok;
+}
+
+/**	\brief	Runs every _SIMD drawer and the plain drawer it replaces on the
+	same made-up spans, flats and tables, and reports whether they drew
+	exactly the same pixels. The kernels have to be set up already.
+*/
+static boolean R_CheckSIMDDrawers(void)
+{
+	static void (*const drawers[][2])(void) = {
+		{R_DrawSpan_8, R_DrawSpan_8_SIMD},
+		{R_DrawTranslucentSpan_8, R_DrawTranslucentSpan_8_SIMD},
+		{R_DrawTiltedSpan_8, R_DrawTiltedSpan_8_SIMD},
+		{R_DrawTiltedTranslucentSpan_8, R_DrawTiltedTranslucentSpan_8_SIMD},
+	};
+	static UINT8 before[MAXVIDWIDTH + 8], expect[MAXVIDWIDTH + 8], dest[MAXVIDWIDTH + 8];
+	static lighttable_t *zlight[MAXLIGHTSCALE];
+	const size_t flatsize = 512*512, lightsize = (MAXLIGHTSCALE+1)*256, transsize = 256*256;
+	UINT8 *tables;
+
+	// Everything the drawers read, to be put back afterwards
+	UINT8 *oldscreen = screens[0];
+	INT32 oldwidth = vid.width, oldheight = vid.height;
+	size_t oldrowbytes = vid.rowbytes;
+	lighttable_t *oldcolormaps = colormaps, *oldcolormap = ds_colormap, **oldplanezlight = planezlight;
+	UINT8 *oldsource = ds_source, *oldtransmap = ds_transmap;
+	INT32 oldy = ds_y, oldx1 = ds_x1, oldx2 = ds_x2;
+	fixed_t oldxfrac = ds_xfrac, oldyfrac = ds_yfrac, oldxstep = ds_xstep, oldystep = ds_ystep;
+	UINT32 oldxshift = nflatxshift, oldyshift = nflatyshift, oldshiftup = nflatshiftup, oldmask = nflatmask;
+	floatv3_t *oldsup = ds_sup, *oldsvp = ds_svp, *oldszp = ds_szp;
+	fixed_t oldviewx = viewx, oldviewy = viewy, oldviewz = viewz, oldfovtan = fovtan;
+	float oldzeroheight = zeroheight;
+	INT32 oldcenterx = centerx, oldcentery = centery;
+
+	floatv3_t su, sv, sz;
+	UINT32 seed = 0xD1FFD1FF;
+	boolean ok = true;
+	INT32 i, n, d;
+
+	tables = malloc(flatsize + lightsize + transsize);
+	if (!tables)
+		return false;
+
+#define NEXTRAND (seed = seed*1664525 + 1013904223)
+#define NEXTFLOAT ((float)(INT32)NEXTRAND / 2147483648.0f) // -1 to 1
+
+	// A random flat, light levels and translucency table. The light
+	// levels are a colormap apart, with one to spare for ds_colormap.
+	for (i = 0; i < (INT32)(flatsize + lightsize + transsize); i++)
+		tables[i] = (UINT8)(NEXTRAND >> 24);
+	for (i = 0; i < MAXLIGHTSCALE; i++)
+		zlight[i] = tables + flatsize + i*256;
+
+	ds_source = tables;
+	colormaps = tables + flatsize;
+	planezlight = zlight;
+	ds_transmap = tables + flatsize + lightsize;
+	ds_sup = &su;
+	ds_svp = &sv;
+	ds_szp = &sz;
+	viewz = 0;
+	fovtan = FRACUNIT;
+	centerx = BASEVIDWIDTH/2;
+	centery = BASEVIDHEIGHT/2;
+
+	// The screen is a single row, just big enough for the longest span
+	screens[0] = dest;
+	vid.width = BASEVIDWIDTH;
+	vid.height = 1;
+	vid.rowbytes = sizeof dest;
+
+	for (n = 0; n < 256 && ok; n++)
+	{
+		INT32 count = 1 + (NEXTRAND >> 8) % (n & 1 ? 2*SPANSIZE : MAXVIDWIDTH - 1);
+		INT32 left = (NEXTRAND >> 8) % (MAXVIDWIDTH - count + 1);
+		UINT32 bits = 5 + (NEXTRAND >> 8) % 5; // flats from 32 to 512 wide
+		UINT8 *oldylookup;
+		INT32 oldcolumnofs;
+
+		nflatxshift = 32 - bits;
+		nflatyshift = nflatxshift - bits;
+		nflatmask = ((1 << bits) - 1) << bits;
+		nflatshiftup = 16 - bits;
+
+		ds_y = (NEXTRAND >> 8) % MAXVIDHEIGHT;
+		ds_x2 = left + count - 1;
+		ds_xfrac = (fixed_t)NEXTRAND;
+		ds_yfrac = (fixed_t)NEXTRAND;
+		ds_xstep = (INT32)NEXTRAND;
+		ds_xstep >>= NEXTRAND >> 28; // small steps as well as huge ones
+		ds_ystep = (INT32)NEXTRAND;
+		ds_ystep >>= NEXTRAND >> 28;
+		ds_colormap = colormaps + (NEXTRAND >> 31)*256;
+
+		// The same sort of planes as R_CheckSIMDKernels, lit from the view
+		sz.x = NEXTFLOAT / (4*MAXVIDWIDTH);
+		sz.y = NEXTFLOAT / (4*MAXVIDHEIGHT);
+		sz.z = 2.0f + NEXTFLOAT;
+		su.x = NEXTFLOAT * 1048576.0f;
+		su.y = NEXTFLOAT * 1048576.0f;
+		su.z = NEXTFLOAT * 1073741824.0f;
+		sv.x = NEXTFLOAT * 1048576.0f;
+		sv.y = NEXTFLOAT * 1048576.0f;
+		sv.z = NEXTFLOAT * 1073741824.0f;
+		viewx = (fixed_t)NEXTRAND;
+		viewy = (fixed_t)NEXTRAND;
+		zeroheight = NEXTFLOAT; // sets how hard the light gets clamped
+		if (zeroheight > -0.01f && zeroheight < 0.01f)
+			zeroheight = 0.01f;
+
+		// Point this row of the screen at the start of the scratch row
+		oldylookup = ylookup[ds_y];
+		oldcolumnofs = columnofs[left];
+		ylookup[ds_y] = dest;
+		columnofs[left] = 0;
+
+		for (d = 0; d < (INT32)(sizeof drawers / sizeof *drawers) && ok; d++)
+		{
+			for (i = 0; i < (INT32)sizeof before; i++)
+				before[i] = (UINT8)(NEXTRAND >> 24);
+
+			// The plain tilted drawers move ds_x1 along as they go
+			memcpy(dest, before, sizeof dest);
+			ds_x1 = left;
+			drawers[d][0]();
+			memcpy(expect, dest, sizeof dest);
+
+			memcpy(dest, before, sizeof dest);
+			ds_x1 = left;
+			drawers[d][1]();
+			if (memcmp(dest, expect, sizeof dest))
+				ok = false;
+		}
+
+		ylookup[ds_y] = oldylookup;
+		columnofs[left] = oldcolumnofs;
+	}
+
+#undef NEXTFLOAT
+#undef NEXTRAND
+
+	free(tables);
+	screens[0] = oldscreen;
+	vid.width = oldwidth;
+	vid.height = oldheight;
+	vid.rowbytes = oldrowbytes;
+	colormaps = oldcolormaps;
+	ds_colormap = oldcolormap;
+	planezlight = oldplanezlight;
+	ds_source = oldsource;
+	ds_transmap = oldtransmap;
+	ds_y = oldy;
+	ds_x1 = oldx1;
+	ds_x2 = oldx2;
+	ds_xfrac = oldxfrac;
+	ds_yfrac = oldyfrac;
+	ds_xstep = oldxstep;
+	ds_ystep = oldystep;
+	nflatxshift = oldxshift;
+	nflatyshift = oldyshift;
+	nflatshiftup = oldshiftup;
+	nflatmask = oldmask;
+	ds_sup = oldsup;
+	ds_svp = oldsvp;
+	ds_szp = oldszp;
+	viewx = oldviewx;
+	viewy = oldviewy;
+	viewz = oldviewz;
+	fovtan = oldfovtan;
+	zeroheight = oldzeroheight;
+	centerx = oldcenterx;
+	centery = oldcentery;
+	return ok;
+}
+
+/**	\brief	Picks the best span kernels this CPU has and checks them.
+
+	\return	true if the _SIMD drawers can be used
+*/
+boolean R_InitSIMDDrawers(void)
+{
+	static boolean checked = false, passed = false;
+	const char *name = NULL;
+
+	R_SpanIndices = NULL;
+	R_TiltedLighting = NULL;
+
+	if (!R_SIMD)
+		return false;
+
+#ifdef SIMD_X86
+	if (R_AVX2)
+	{
+		R_SpanIndices = R_SpanIndices_AVX2;
+		R_TiltedLighting = R_TiltedLighting_AVX2;
+		name = "AVX2";
+	}
+	else if (R_SSE2)
+	{
+		R_SpanIndices = R_SpanIndices_SSE2;
+		R_TiltedLighting = R_TiltedLighting_SSE2;
+		name = "SSE2";
+	}
+#endif
+#ifdef SIMD_NEON
+	if (R_NEON)
+	{
+		R_SpanIndices = R_SpanIndices_NEON;
+		R_TiltedLighting = R_TiltedLighting_NEON;
+		name = "NEON";
+	}
+#endif
+
+	if (!R_SpanIndices)
+		return false;
+
+	// The kernels can't change between calls, so only check them once.
+	if (!checked)
+	{
+		checked = true;
+		passed = R_CheckSIMDKernels(R_SpanIndices, R_TiltedLighting) && R_CheckSIMDDrawers();
+		if (passed)
+			CONS_Printf("Using %s span drawers\n", name);
+		else
+			CONS_Alert(CONS_WARNING, "%s span drawers don't match the plain ones, not using them\n", name);
+	}
+
+	if (!passed)
+	{
+		R_SpanIndices = NULL;
+		R_TiltedLighting = NULL;
+		return false;
+	}
+
+	return true;
+}
@@ -56,19 +56,20 @@ INT64 mytotal = 0;
 // increment every time a check is made
 size_t validcount = 1;
 
-INT32 centerx, centery;
+RENDERLOCAL INT32 centerx, centery;
 
-fixed_t centerxfrac, centeryfrac;
+fixed_t centerxfrac;
+RENDERLOCAL fixed_t centeryfrac;
 fixed_t projection;
 fixed_t projectiony; // aspect ratio
-fixed_t fovtan; // field of view
+RENDERLOCAL fixed_t fovtan; // field of view
 
 // just for profiling purposes
 size_t framecount;
 
 size_t loopcount;
 
-fixed_t viewx, viewy, viewz;
+RENDERLOCAL fixed_t viewx, viewy, viewz;
 angle_t viewangle, aimingangle;
 fixed_t viewcos, viewsin;
 sector_t *viewsector;
@@ -110,6 +111,12 @@ int rs_sw_portaltime = 0;
 int rs_sw_planetime = 0;
 int rs_sw_maskedtime = 0;
 
+#ifdef THREADEDRENDER
+int rs_sw_drawtime = 0;
+int rs_sw_threadtime[MAXRENDERTHREADS];
+INT32 rs_sw_numthreads = 0;
+#endif
+
 int rs_numbspcalls = 0;
 int rs_numsprites = 0;
 int rs_numdrawnodes = 0;
@@ -132,6 +139,9 @@ static CV_PossibleValue_t fov_cons_t[] = {{60*FRACUNIT, "MIN"}, {179*FRACUNIT, "
 static CV_PossibleValue_t translucenthud_cons_t[] = {{0, "MIN"}, {10, "MAX"}, {0, NULL}};
 static CV_PossibleValue_t maxportals_cons_t[] = {{0, "MIN"}, {12, "MAX"}, {0, NULL}}; // lmao rendering 32 portals, you're a card
 static CV_PossibleValue_t homremoval_cons_t[] = {{0, "No"}, {1, "Yes"}, {2, "Flash"}, {0, NULL}};
+#ifdef THREADEDRENDER
+static CV_PossibleValue_t renderthreads_cons_t[] = {{0, "MIN"}, {MAXRENDERTHREADS, "MAX"}, {0, NULL}};
+#endif
 
 static void Fov_OnChange(void);
 static void ChaseCam_OnChange(void);
@@ -166,6 +176,9 @@ consvar_t cv_homremoval = {"homremoval", "No", CV_SAVE, homremoval_cons_t, NULL,
 consvar_t cv_maxportals = {"maxportals", "2", CV_SAVE, maxportals_cons_t, NULL, 0, NULL, NULL, 0, 0, NULL};
 
 consvar_t cv_renderstats = {"renderstats", "Off", 0, CV_OnOff, NULL, 0, NULL, NULL, 0, 0, NULL};
+#ifdef THREADEDRENDER
+consvar_t cv_renderthreads = {"renderthreads", "0", CV_SAVE, renderthreads_cons_t, NULL, 0, NULL, NULL, 0, 0, NULL};
+#endif
 
 void SplitScreen_OnChange(void)
 {
@@ -1427,6 +1440,10 @@ void R_RenderPlayerView(player_t *player)
 	framecount++;
 	validcount++;
 
+#ifdef THREADEDRENDER
+	R_StartDeferredDrawing();
+#endif
+
 	// Clear buffers.
 	R_ClearPlanes();
 	if (viewmorph.use)
@@ -1539,6 +1556,10 @@ void R_RenderPlayerView(player_t *player)
 	R_DrawMasked(masks, nummasks);
 	rs_sw_maskedtime = I_GetTimeMicros() - rs_sw_maskedtime;
 
+#ifdef THREADEDRENDER
+	R_FinishDeferredDrawing();
+#endif
+
 	free(masks);
 }
 
@@ -1625,6 +1646,9 @@ void R_RegisterEngineStuff(void)
 	CV_RegisterVar(&cv_translucenthud);
 
 	CV_RegisterVar(&cv_maxportals);
+#ifdef THREADEDRENDER
+	CV_RegisterVar(&cv_renderthreads);
+#endif
 
 	CV_RegisterVar(&cv_movebob);
 }
@@ -22,11 +22,12 @@
 //
 extern fixed_t viewcos, viewsin;
 extern INT32 viewheight;
-extern INT32 centerx, centery;
+extern RENDERLOCAL INT32 centerx, centery;
 
-extern fixed_t centerxfrac, centeryfrac;
+extern fixed_t centerxfrac;
+extern RENDERLOCAL fixed_t centeryfrac;
 extern fixed_t projection, projectiony;
-extern fixed_t fovtan;
+extern RENDERLOCAL fixed_t fovtan;
 
 // WARNING: a should be unsigned but to add with 2048, it isn't!
 #define AIMINGTODY(a) FixedDiv((FINETANGENT((2048+(((INT32)a)>>ANGLETOFINESHIFT)) & FINEMASK)*160), fovtan)
@@ -88,6 +89,16 @@ extern int rs_sw_portaltime;
 extern int rs_sw_planetime;
 extern int rs_sw_maskedtime;
 
+#ifdef THREADEDRENDER
+#define MAXRENDERTHREADS 16
+
+extern consvar_t cv_renderthreads;
+
+extern int rs_sw_drawtime;
+extern int rs_sw_threadtime[MAXRENDERTHREADS];
+extern INT32 rs_sw_numthreads;
+#endif
+
 extern int rs_numbspcalls;
 extern int rs_numsprites;
 extern int rs_numdrawnodes;
@@ -58,8 +58,24 @@ visffloor_t ffloor[MAXFFLOORS];
 INT32 numffloors;
 
 //SoM: 3/23/2000: Boom visplane hashing routine.
-#define visplane_hash(picnum,lightlevel,height) \
-  ((unsigned)((picnum)*3+(lightlevel)+(height)*7) & (MAXVISPLANES-1))
+// Slopes, polyobjects and FOFs go into the hash too. Otherwise every
+// sloped or FOF plane with the same flat, light and height ends up in
+// the same chain, and big slope/FOF maps spend their time walking it.
+static inline unsigned R_VisplaneHash(fixed_t height, INT32 picnum, INT32 lightlevel,
+	fixed_t xoff, fixed_t yoff, ffloor_t *pfloor, polyobj_t *polyobj, pslope_t *slope)
+{
+	UINT32 hash = (UINT32)picnum*3 + (UINT32)lightlevel + (UINT32)height*7;
+
+	hash ^= (UINT32)xoff ^ ((UINT32)yoff << 7);
+	hash ^= (UINT32)((size_t)pfloor >> 3) ^ (UINT32)((size_t)polyobj >> 5) ^ (UINT32)((size_t)slope >> 4);
+
+	// Fibonacci hashing, so the pointers' high bits count too
+	return (hash * 2654435761u) >> (32 - VISPLANEHASHBITS);
+}
+
+// Visplanes are never freed, only put back on the free list at the start
+// of each frame. When that runs dry, this many more are allocated at once.
+#define VISPLANEPOOLSIZE 32
 
 //SoM: 3/23/2000: Use boom opening limit removal
 size_t maxopenings;
@@ -82,7 +98,7 @@ static INT32 spanstart[MAXVIDHEIGHT];
 //
 // texture mapping
 //
-lighttable_t **planezlight;
+RENDERLOCAL lighttable_t **planezlight;
 static fixed_t planeheight;
 
 //added : 10-02-98: yslopetab is what yslope used to be,
@@ -120,8 +136,8 @@ void R_InitPlanes(void)
 //
 
 #ifndef NOWATER
-INT32 ds_bgofs;
-INT32 ds_waterofs;
+RENDERLOCAL INT32 ds_bgofs;
+RENDERLOCAL INT32 ds_waterofs;
 
 static INT32 wtofs=0;
 static boolean itswater;
@@ -242,7 +258,7 @@ void R_MapPlane(INT32 y, INT32 x1, INT32 x2)
 	ProfZeroTimer();
 #endif
 
-	spanfunc();
+	R_DRAWSPAN(spanfunc);
 
 #ifdef TIMING
 	RDMSR(0x10, &mycount);
@@ -313,18 +329,24 @@ void R_ClearPlanes(void)
 
 static visplane_t *new_visplane(unsigned hash)
 {
-	visplane_t *check = freetail;
-	if (!check)
-	{
-		check = calloc(2, sizeof (*check));
-		if (check == NULL) I_Error("%s: Out of memory", "new_visplane"); // FIXME: ugly
-	}
-	else
+	visplane_t *check;
+
+	if (!freetail)
 	{
-		freetail = freetail->next;
-		if (!freetail)
-			freehead = &freetail;
+		visplane_t *pool = Z_Calloc(VISPLANEPOOLSIZE * sizeof (*pool), PU_STATIC, NULL);
+		INT32 i;
+
+		for (i = 0; i < VISPLANEPOOLSIZE - 1; i++)
+			pool[i].next = &pool[i+1];
+		freetail = pool;
+		freehead = &pool[VISPLANEPOOLSIZE-1].next;
 	}
+
+	check = freetail;
+	freetail = freetail->next;
+	if (!freetail)
+		freehead = &freetail;
+
 	check->next = visplanes[hash];
 	visplanes[hash] = check;
 	return check;
@@ -380,12 +402,11 @@ visplane_t *R_FindPlane(fixed_t height, INT32 picnum, INT32 lightlevel,
 	}
 
 	// New visplane algorithm uses hash table
-	hash = visplane_hash(picnum, lightlevel, height);
+	hash = R_VisplaneHash(height, picnum, lightlevel, xoff, yoff, pfloor, polyobj, slope);
 
-	for (check = visplanes[hash]; check; check = check->next)
+	// FOF planes are never shared, so don't bother looking
+	for (check = (pfloor ? NULL : visplanes[hash]); check; check = check->next)
 	{
-		if (check->polyobj && pfloor)
-			continue;
 		if (polyobj != check->polyobj)
 			continue;
 		if (height == check->height && picnum == check->picnum
@@ -470,8 +491,8 @@ visplane_t *R_CheckPlane(visplane_t *pl, INT32 start, INT32 stop)
 	}
 	else /* Cannot use existing plane; create a new one */
 	{
-		unsigned hash =
-			visplane_hash(pl->picnum, pl->lightlevel, pl->height);
+		unsigned hash = R_VisplaneHash(pl->height, pl->picnum, pl->lightlevel,
+			pl->xoffs, pl->yoffs, pl->ffloor, pl->polyobj, pl->slope);
 		visplane_t *new_pl = new_visplane(hash);
 
 		new_pl->height = pl->height;
@@ -639,7 +660,7 @@ static void R_DrawSkyPlane(visplane_t *pl)
 			dc_source =
 				R_GetColumn(texturetranslation[skytexture],
 					-angle); // get negative of angle for each column to display sky correct way round! --Monster Iestyn 27/01/18
-			colfunc();
+			R_DRAWCOLUMN(colfunc);
 		}
 	}
 }
@@ -1041,6 +1062,11 @@ void R_DrawSinglePlane(visplane_t *pl)
 					if (bottom > vid.height)
 						bottom = vid.height;
 
+#ifdef THREADEDRENDER
+					// Everything queued so far has to be on the screen first
+					R_FlushDeferredDrawing();
+#endif
+
 					// Only copy the part of the screen we need
 					VID_BlitLinearScreen((splitscreen && viewplayer == &players[secondarydisplayplayer]) ? screens[0] + (top+(vid.height>>1))*vid.width : screens[0]+((top)*vid.width), screens[1]+((top)*vid.width),
 										 vid.width, bottom-top,
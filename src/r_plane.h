@@ -18,7 +18,8 @@
 #include "r_data.h"
 #include "p_polyobj.h"
 
-#define MAXVISPLANES 512
+#define VISPLANEHASHBITS 9
+#define MAXVISPLANES (1<<VISPLANEHASHBITS) // hash buckets, not a limit
 
 //
 // Now what is a visplane, anyway?
@@ -68,7 +69,7 @@ extern fixed_t cachedystep[MAXVIDHEIGHT];
 extern fixed_t basexscale, baseyscale;
 
 extern fixed_t *yslope;
-extern lighttable_t **planezlight;
+extern RENDERLOCAL lighttable_t **planezlight;
 
 void R_InitPlanes(void);
 void R_ClearPlanes(void);
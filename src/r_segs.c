@@ -102,7 +102,7 @@ static void R_DrawSplatColumn(column_t *column)
 			dc_texturemid = basetexturemid - (topdelta<<FRACBITS);
 
 			// Drawn by R_DrawColumn.
-			colfunc();
+			R_DRAWCOLUMN(colfunc);
 		}
 		column = (column_t *)((UINT8 *)column + column->length + 4);
 	}
@@ -266,11 +266,11 @@ static void R_Render2sidedMultiPatchColumn(column_t *column)
 		dc_source = (UINT8 *)column + 3;
 
 		if (colfunc == colfuncs[BASEDRAWFUNC])
-			(colfuncs[COLDRAWFUNC_TWOSMULTIPATCH])();
+			R_DRAWCOLUMN(colfuncs[COLDRAWFUNC_TWOSMULTIPATCH]);
 		else if (colfunc == colfuncs[COLDRAWFUNC_FUZZY])
-			(colfuncs[COLDRAWFUNC_TWOSMULTIPATCHTRANS])();
+			R_DRAWCOLUMN(colfuncs[COLDRAWFUNC_TWOSMULTIPATCHTRANS]);
 		else
-			colfunc();
+			R_DRAWCOLUMN(colfunc);
 	}
 }
 
@@ -1433,7 +1433,7 @@ static void R_RenderSegLoop (void)
 #ifdef TIMING
 				ProfZeroTimer();
 #endif
-				colfunc();
+				R_DRAWCOLUMN(colfunc);
 #ifdef TIMING
 				RDMSR(0x10,&mycount);
 				mytotal += mycount;      //64bit add
@@ -1481,7 +1481,7 @@ static void R_RenderSegLoop (void)
 						dc_texturemid = rw_toptexturemid;
 						dc_source = R_GetColumn(toptexture,texturecolumn);
 						dc_texheight = textureheight[toptexture]>>FRACBITS;
-						colfunc();
+						R_DRAWCOLUMN(colfunc);
 						ceilingclip[rw_x] = (INT16)mid;
 					}
 					else // entirely off top of screen
@@ -1515,7 +1515,7 @@ static void R_RenderSegLoop (void)
 						dc_source = R_GetColumn(bottomtexture,
 							texturecolumn);
 						dc_texheight = textureheight[bottomtexture]>>FRACBITS;
-						colfunc();
+						R_DRAWCOLUMN(colfunc);
 						floorclip[rw_x] = (INT16)mid;
 					}
 					else  // entirely off bottom of screen
@@ -82,7 +82,7 @@ extern side_t *spawnsides;
 //
 // POV data.
 //
-extern fixed_t viewx, viewy, viewz;
+extern RENDERLOCAL fixed_t viewx, viewy, viewz;
 extern angle_t viewangle, aimingangle;
 extern sector_t *viewsector;
 extern player_t *viewplayer;
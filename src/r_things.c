@@ -652,7 +652,7 @@ void R_DrawMaskedColumn(column_t *column)
 			// FIXTHIS: Figure out what "something more proper" is and do it.
 			// quick fix... something more proper should be done!!!
 			if (ylookup[dc_yl])
-				colfunc();
+				R_DRAWCOLUMN(colfunc);
 #ifdef PARANOIA
 			else
 				I_Error("R_DrawMaskedColumn: Invalid ylookup for dc_yl %d", dc_yl);
@@ -709,19 +709,28 @@ void R_DrawFlippedMaskedColumn(column_t *column)
 
 		if (dc_yl <= dc_yh && dc_yh > 0)
 		{
-			dc_source = ZZ_Alloc(column->length);
+#ifdef THREADEDRENDER
+			// A queued column reads its source later on
+			if (r_deferdraws)
+				dc_source = R_DeferScratch(column->length);
+			else
+#endif
+				dc_source = ZZ_Alloc(column->length);
 			for (s = (UINT8 *)column+2+column->length, d = dc_source; d < dc_source+column->length; --s)
 				*d++ = *s;
 			dc_texturemid = basetexturemid - (topdelta<<FRACBITS);
 
 			// Still drawn by R_DrawColumn.
 			if (ylookup[dc_yl])
-				colfunc();
+				R_DRAWCOLUMN(colfunc);
 #ifdef PARANOIA
 			else
 				I_Error("R_DrawMaskedColumn: Invalid ylookup for dc_yl %d", dc_yl);
 #endif
-			Z_Free(dc_source);
+#ifdef THREADEDRENDER
+			if (!r_deferdraws)
+#endif
+				Z_Free(dc_source);
 		}
 		column = (column_t *)((UINT8 *)column + column->length + 4);
 	}
@@ -2091,14 +2100,62 @@ void R_AddSprites(sector_t *sec, INT32 lightlevel)
 //
 // R_SortVisSprites
 //
+static vissprite_t **sortvissprites = NULL;
+static UINT32 maxsortvissprites = 0;
+
+// Draw order: smallest scale first, then smallest dispoffset first
+static inline boolean R_VisSpriteBefore(const vissprite_t *a, const vissprite_t *b)
+{
+	if (a->sortscale != b->sortscale)
+		return (a->sortscale < b->sortscale);
+	return (a->dispoffset < b->dispoffset);
+}
+
+/** Bottom-up merge sort of a vissprite list. Stable, so equal keys
+  * retain their relative order.
+  *
+  * \param list  The vissprites to sort, in place.
+  * \param temp  Scratch space for at least count entries.
+  * \param count Number of entries in the list.
+  */
+static void R_MergeSortVisSprites(vissprite_t **list, vissprite_t **temp, UINT32 count)
+{
+	vissprite_t **src = list, **dst = temp, **swap;
+	UINT32 width, lo, mid, hi, a, b, k;
+
+	for (width = 1; width < count; width *= 2)
+	{
+		for (lo = 0; lo < count; lo += 2*width)
+		{
+			mid = min(lo + width, count);
+			hi = min(lo + 2*width, count);
+
+			// take from the right run only when strictly before the left
+			for (a = lo, b = mid, k = lo; k < hi; k++)
+			{
+				if (a < mid && (b >= hi || !R_VisSpriteBefore(src[b], src[a])))
+					dst[k] = src[a++];
+				else
+					dst[k] = src[b++];
+			}
+		}
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != list)
+		memcpy(list, src, count * sizeof (*list));
+}
+
 static void R_SortVisSprites(vissprite_t* vsprsortedhead, UINT32 start, UINT32 end)
 {
 	UINT32       i, linkedvissprites = 0;
 	vissprite_t *ds, *dsprev, *dsnext, *dsfirst;
 	vissprite_t *best = NULL;
 	vissprite_t  unsorted;
-	fixed_t      bestscale;
-	INT32        bestdispoffset;
+	UINT32       count;
 
 	unsorted.next = unsorted.prev = &unsorted;
 
@@ -2196,31 +2253,34 @@ static void R_SortVisSprites(vissprite_t* vsprsortedhead, UINT32 start, UINT32 e
 
 	// pull the vissprites out by scale
 	vsprsortedhead->next = vsprsortedhead->prev = vsprsortedhead;
-	for (i = start; i < end-linkedvissprites; i++)
+
+	count = end - start - linkedvissprites;
+	if (!count)
+		return;
+
+	if (count > maxsortvissprites)
+	{
+		// grow both the sort list and its merge buffer together
+		maxsortvissprites = max(count, maxsortvissprites*2);
+		Z_Realloc(sortvissprites, 2 * maxsortvissprites * sizeof (*sortvissprites), PU_STATIC, &sortvissprites);
+	}
+
+	for (i = 0, ds = unsorted.next; ds != &unsorted; ds = ds->next)
 	{
-		bestscale = bestdispoffset = INT32_MAX;
-		for (ds = unsorted.next; ds != &unsorted; ds = ds->next)
-		{
 #ifdef PARANOIA
-			if (ds->cut & SC_LINKDRAW)
-				I_Error("R_SortVisSprites: no link or discardal made for linkdraw!");
+		if (ds->cut & SC_LINKDRAW)
+			I_Error("R_SortVisSprites: no link or discardal made for linkdraw!");
 #endif
+		sortvissprites[i++] = ds;
+	}
 
-			if (ds->sortscale < bestscale)
-			{
-				bestscale = ds->sortscale;
-				bestdispoffset = ds->dispoffset;
-				best = ds;
-			}
-			// order visprites of same scale by dispoffset, smallest first
-			else if (ds->sortscale == bestscale && ds->dispoffset < bestdispoffset)
-			{
-				bestdispoffset = ds->dispoffset;
-				best = ds;
-			}
-		}
-		best->next->prev = best->prev;
-		best->prev->next = best->next;
+	// the merge is stable, so vissprites of the same scale and dispoffset
+	// keep the order they were projected in, just like the old selection sort
+	R_MergeSortVisSprites(sortvissprites, sortvissprites + maxsortvissprites, count);
+
+	for (i = 0; i < count; i++)
+	{
+		best = sortvissprites[i];
 		best->next = vsprsortedhead;
 		best->prev = vsprsortedhead->prev;
 		vsprsortedhead->prev->next = best;
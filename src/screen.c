@@ -97,6 +97,9 @@ boolean R_SSE = false;
 boolean R_3DNow = false;
 boolean R_MMXExt = false;
 boolean R_SSE2 = false;
+boolean R_AVX2 = false;
+boolean R_NEON = false;
+boolean R_SIMD = true;
 
 void SCR_SetDrawFuncs(void)
 {
@@ -134,6 +137,15 @@ void SCR_SetDrawFuncs(void)
 #endif
 		spanfuncs[SPANDRAWFUNC_TILTEDSPLAT] = R_DrawTiltedSplat_8;
 
+		if (R_InitSIMDDrawers())
+		{
+			spanfuncs[BASEDRAWFUNC] = R_DrawSpan_8_SIMD;
+			spanfuncs[SPANDRAWFUNC_TRANS] = R_DrawTranslucentSpan_8_SIMD;
+			spanfuncs[SPANDRAWFUNC_TILTED] = R_DrawTiltedSpan_8_SIMD;
+			spanfuncs[SPANDRAWFUNC_TILTEDTRANS] = R_DrawTiltedTranslucentSpan_8_SIMD;
+			spanfunc = spanfuncs[BASEDRAWFUNC];
+		}
+
 		// Lactozilla: Non-powers-of-two
 		spanfuncs_npo2[BASEDRAWFUNC] = R_DrawSpan_NPO2_8;
 		spanfuncs_npo2[SPANDRAWFUNC_TRANS] = R_DrawTranslucentSpan_NPO2_8;
@@ -244,7 +256,11 @@ void SCR_Startup(void)
 			R_SSE = true;
 		if (RCpuInfo->SSE2)
 			R_SSE2 = true;
-		CONS_Printf("CPU Info: 486: %i, 586: %i, MMX: %i, 3DNow: %i, MMXExt: %i, SSE2: %i\n", R_486, R_586, R_MMX, R_3DNow, R_MMXExt, R_SSE2);
+		if (RCpuInfo->AVX2)
+			R_AVX2 = true;
+		if (RCpuInfo->NEON)
+			R_NEON = true;
+		CONS_Printf("CPU Info: 486: %i, 586: %i, MMX: %i, 3DNow: %i, MMXExt: %i, SSE2: %i, AVX2: %i, NEON: %i\n", R_486, R_586, R_MMX, R_3DNow, R_MMXExt, R_SSE2, R_AVX2, R_NEON);
 	}
 
 	if (M_CheckParm("-noASM"))
@@ -267,6 +283,10 @@ void SCR_Startup(void)
 
 	if (M_CheckParm("-SSE2"))
 		R_SSE2 = true;
+	if (M_CheckParm("-noAVX2"))
+		R_AVX2 = false;
+	if (M_CheckParm("-noSIMD"))
+		R_SIMD = false;
 
 	M_SetupMemcpy();
 
@@ -164,6 +164,9 @@ extern boolean R_MMX;
 extern boolean R_3DNow;
 extern boolean R_MMXExt;
 extern boolean R_SSE2;
+extern boolean R_AVX2;
+extern boolean R_NEON;
+extern boolean R_SIMD;
 
 // ----------------
 // screen variables
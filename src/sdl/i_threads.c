@@ -0,0 +1,184 @@
+// SONIC ROBO BLAST 2
+//-----------------------------------------------------------------------------
+// Copyright (C) 2020 by Sonic Team Junior.
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  i_threads.c
+/// \brief Worker threads, using SDL threads
+
+#ifdef HAVE_SDL
+
+#ifdef HAVE_THREADS
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4214 4244)
+#endif
+
+#include "SDL.h"
+
+#ifdef _MSC_VER
+#pragma warning(default : 4214 4244)
+#endif
+
+#include "../doomdef.h"
+#include "../i_threads.h"
+
+#define MAXJOBTHREADS 32
+
+typedef struct
+{
+	I_job_fn job;
+	void *userdata;
+	size_t count;
+	SDL_atomic_t next; // next job nobody has picked up yet
+} jobbatch_t;
+
+// The workers are started the first time there's work for them, and then
+// sleep on poolwake between batches. Everything but poolinuse is guarded
+// by poollock.
+static SDL_mutex *poollock = NULL;
+static SDL_cond *poolwake = NULL, *pooldone = NULL;
+static INT32 numpoolthreads = 1; // counting the thread calling I_RunJobs
+static jobbatch_t *poolbatch = NULL;
+static UINT32 poolgeneration = 0; // bumped for every batch
+static INT32 poolwanted = 0; // threads the current batch may use
+static INT32 poolbusy = 0; // workers still on the current batch
+static SDL_atomic_t poolinuse; // set while a batch is running
+
+INT32 I_NumJobThreads(void)
+{
+	static INT32 numcpus = 0;
+
+	if (!numcpus)
+		numcpus = max(1, min(SDL_GetCPUCount(), MAXJOBTHREADS));
+
+	return numcpus;
+}
+
+// Keeps picking up jobs until there are none left.
+static void RunJobBatch(jobbatch_t *batch, INT32 thread)
+{
+	size_t i;
+
+	while ((i = (size_t)SDL_AtomicAdd(&batch->next, 1)) < batch->count)
+		batch->job(batch->userdata, i, thread);
+}
+
+static int JobWorker(void *data)
+{
+	const INT32 thread = (INT32)(size_t)data;
+	UINT32 seen = 0;
+
+	SDL_LockMutex(poollock);
+	for (;;)
+	{
+		jobbatch_t *batch;
+
+		while (poolgeneration == seen)
+			SDL_CondWait(poolwake, poollock);
+		seen = poolgeneration;
+
+		if (thread >= poolwanted)
+			continue; // this batch doesn't need us
+
+		batch = poolbatch;
+		SDL_UnlockMutex(poollock);
+		RunJobBatch(batch, thread);
+		SDL_LockMutex(poollock);
+
+		if (--poolbusy == 0)
+			SDL_CondSignal(pooldone);
+	}
+
+	return 0;
+}
+
+// Starts one worker per CPU, less the calling thread. All of them are
+// started before the first batch goes out, so none can miss it.
+static void StartJobPool(void)
+{
+	INT32 i;
+
+	poollock = SDL_CreateMutex();
+	poolwake = SDL_CreateCond();
+	pooldone = SDL_CreateCond();
+	if (!poollock || !poolwake || !pooldone)
+		return; // do everything on the calling thread
+
+	for (i = 1; i < I_NumJobThreads(); i++)
+	{
+		SDL_Thread *thread = SDL_CreateThread(JobWorker, "SRB2 job worker", (void *)(size_t)i);
+		if (!thread)
+			break; // thread numbers must stay contiguous
+#if SDL_VERSION_ATLEAST(2,0,2)
+		SDL_DetachThread(thread);
+#endif
+		numpoolthreads++;
+	}
+}
+
+void I_RunJobs(I_job_fn job, void *userdata, size_t count, INT32 maxthreads)
+{
+	static boolean poolstarted = false;
+	jobbatch_t batch;
+	INT32 numthreads = I_NumJobThreads();
+
+	if (maxthreads > 0 && maxthreads < numthreads)
+		numthreads = maxthreads;
+	if ((size_t)numthreads > count)
+		numthreads = (INT32)count;
+
+	batch.job = job;
+	batch.userdata = userdata;
+	batch.count = count;
+	SDL_AtomicSet(&batch.next, 0);
+
+	// A batch from inside a job, or from another thread while the pool is
+	// busy, just runs on the thread that asked for it.
+	if (numthreads <= 1 || !SDL_AtomicCAS(&poolinuse, 0, 1))
+	{
+		RunJobBatch(&batch, 0);
+		return;
+	}
+
+	if (!poolstarted)
+	{
+		poolstarted = true;
+		StartJobPool();
+	}
+
+	if (numthreads > numpoolthreads)
+		numthreads = numpoolthreads;
+
+	if (numthreads > 1)
+	{
+		SDL_LockMutex(poollock);
+		poolbatch = &batch;
+		poolwanted = numthreads;
+		poolbusy = numthreads - 1;
+		poolgeneration++;
+		SDL_CondBroadcast(poolwake);
+		SDL_UnlockMutex(poollock);
+	}
+
+	// Thread 0 is this one.
+	RunJobBatch(&batch, 0);
+
+	if (numthreads > 1)
+	{
+		SDL_LockMutex(poollock);
+		while (poolbusy)
+			SDL_CondWait(pooldone, poollock);
+		poolbatch = NULL;
+		SDL_UnlockMutex(poollock);
+	}
+
+	SDL_AtomicSet(&poolinuse, 0);
+}
+
+#endif // HAVE_THREADS
+
+#endif // HAVE_SDL
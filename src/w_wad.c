@@ -33,6 +33,13 @@
 #include <unistd.h>
 #endif
 
+#include <sys/stat.h>
+
+#ifdef UNIXCOMMON
+#define HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #define ZWAD
 
 #ifdef ZWAD
@@ -63,6 +70,10 @@
 #include "p_setup.h" // P_ScanThings
 #endif
 #include "m_misc.h" // M_MapNumber
+#include "m_argv.h" // M_CheckParm
+#include "d_main.h" // srb2home
+#include "i_threads.h"
+#include "byteptr.h"
 
 #ifdef HWRENDER
 #include "r_data.h"
@@ -120,8 +131,25 @@ void W_Shutdown(void)
 	{
 		wadfile_t *wad = wadfiles[numwadfiles];
 
+#ifdef HAVE_MMAP
+		if (wad->mapped)
+		{
+			Z_RemoveExternal(wad->mapped);
+			munmap(wad->mapped, wad->filesize);
+		}
+#endif
 		fclose(wad->handle);
 		Z_Free(wad->filename);
+
+		// Before the loop below, which runs numlumps down past zero
+		if (wad->preinflated)
+		{
+			UINT16 i;
+			for (i = 0; i < wad->numlumps; i++)
+				free(wad->preinflated[i]);
+			free(wad->preinflated);
+		}
+
 		while (wad->numlumps--)
 		{
 			Z_Free(wad->lumpinfo[wad->numlumps].longname);
@@ -129,6 +157,10 @@ void W_Shutdown(void)
 		}
 
 		Z_Free(wad->lumpinfo);
+		Z_Free(wad->namehash.first);
+		Z_Free(wad->namehash.next);
+		Z_Free(wad->longnamehash.first);
+		Z_Free(wad->longnamehash.next);
 		Z_Free(wad);
 	}
 }
@@ -325,6 +357,322 @@ static inline INT32 W_MakeFileMD5(const char *filename, void *resblock)
 	return 1;
 }
 
+// ==========================================================================
+// File cache
+// ==========================================================================
+//
+// Remembers the MD5 and lump directory of every file that was added, in a
+// file next to the config, so that unchanged files don't need hashing and
+// parsing again on the next run. Files are matched by path, size and
+// modification time.
+//
+
+#define WADCACHEFILENAME "wadcache.dat"
+#define WADCACHEID "SRB2WDC1"
+
+typedef struct wadcache_s
+{
+	char *path;
+	UINT32 filesize;
+	INT64 mtime;
+	UINT8 md5sum[16];
+	boolean important; // !W_VerifyNMUSlumps
+	UINT16 numlumps;
+	UINT8 *lumps; // the lump directory, as stored in the cache file
+	size_t lumpslength;
+	struct wadcache_s *next;
+} wadcache_t;
+
+static wadcache_t *wadcache = NULL;
+static boolean wadcacheloaded = false;
+static boolean wadcachedirty = false;
+
+static const char *W_FileCachePath(void)
+{
+	return va("%s" PATHSEP "%s", srb2home, WADCACHEFILENAME);
+}
+
+static boolean W_GetFileStamp(const char *path, UINT32 *filesize, INT64 *mtime)
+{
+	struct stat st;
+
+	if (stat(path, &st) != 0)
+		return false;
+
+	*filesize = (UINT32)st.st_size;
+	*mtime = (INT64)st.st_mtime;
+	return true;
+}
+
+static void W_FreeCacheEntry(wadcache_t *entry)
+{
+	Z_Free(entry->path);
+	Z_Free(entry->lumps);
+	Z_Free(entry);
+}
+
+/** Reads the cache file, if there is one.
+  * Anything that doesn't look right just makes the rest of it get ignored.
+  */
+static void W_LoadFileCache(void)
+{
+	UINT8 *buffer, *p, *end;
+	size_t length;
+	UINT32 count;
+
+	wadcacheloaded = true;
+
+	if (M_CheckParm("-nowadcache"))
+		return;
+
+	length = FIL_ReadFile(W_FileCachePath(), &buffer);
+	if (!length)
+		return;
+
+	p = buffer;
+	end = buffer + length;
+
+	if (length < 8 + 2 + 4 || memcmp(p, WADCACHEID, 8) || p[8] != CM_UNSUPPORTED)
+	{
+		Z_Free(buffer);
+		return;
+	}
+	p += 9;
+	count = READUINT32(p);
+
+	while (count--)
+	{
+		wadcache_t *entry;
+		UINT8 *pathend = memchr(p, '\0', end - p);
+		UINT32 lo, hi;
+
+		// path, size, time, md5, important, numlumps, lumpslength
+		if (!pathend || end - (pathend + 1) < 4 + 8 + 16 + 1 + 2 + 4)
+			break;
+
+		entry = Z_Calloc(sizeof (*entry), PU_STATIC, NULL);
+		entry->path = Z_StrDup((char *)p);
+		p = pathend + 1;
+		entry->filesize = READUINT32(p);
+		lo = READUINT32(p);
+		hi = READUINT32(p);
+		entry->mtime = (INT64)(((UINT64)hi << 32) | lo);
+		M_Memcpy(entry->md5sum, p, 16);
+		p += 16;
+		entry->important = READUINT8(p);
+		entry->numlumps = READUINT16(p);
+		entry->lumpslength = READUINT32(p);
+
+		if (entry->lumpslength > (size_t)(end - p))
+		{
+			Z_Free(entry->path);
+			Z_Free(entry);
+			break;
+		}
+
+		entry->lumps = Z_Malloc(entry->lumpslength ? entry->lumpslength : 1, PU_STATIC, NULL);
+		M_Memcpy(entry->lumps, p, entry->lumpslength);
+		p += entry->lumpslength;
+
+		entry->next = wadcache;
+		wadcache = entry;
+	}
+
+	Z_Free(buffer);
+}
+
+/** Writes the cache file back out, if anything changed.
+  * Entries for files that are gone or changed get dropped along the way.
+  */
+static void W_SaveFileCache(void)
+{
+	wadcache_t *entry, **link;
+	size_t length = 8 + 1 + 4;
+	UINT32 count = 0, filesize;
+	INT64 mtime;
+	UINT8 *buffer, *p;
+
+	if (!wadcachedirty)
+		return;
+	wadcachedirty = false;
+
+	for (link = &wadcache; (entry = *link) != NULL;)
+	{
+		if (!W_GetFileStamp(entry->path, &filesize, &mtime)
+			|| filesize != entry->filesize || mtime != entry->mtime)
+		{
+			*link = entry->next;
+			W_FreeCacheEntry(entry);
+			continue;
+		}
+
+		length += strlen(entry->path) + 1 + 4 + 8 + 16 + 1 + 2 + 4 + entry->lumpslength;
+		count++;
+		link = &entry->next;
+	}
+
+	p = buffer = Z_Malloc(length, PU_STATIC, NULL);
+	M_Memcpy(p, WADCACHEID, 8);
+	p += 8;
+	WRITEUINT8(p, CM_UNSUPPORTED); // differs between builds with and without zlib
+	WRITEUINT32(p, count);
+
+	for (entry = wadcache; entry; entry = entry->next)
+	{
+		strcpy((char *)p, entry->path);
+		p += strlen(entry->path) + 1;
+		WRITEUINT32(p, entry->filesize);
+		WRITEUINT32(p, (UINT32)((UINT64)entry->mtime & 0xFFFFFFFF));
+		WRITEUINT32(p, (UINT32)((UINT64)entry->mtime >> 32));
+		M_Memcpy(p, entry->md5sum, 16);
+		p += 16;
+		WRITEUINT8(p, entry->important);
+		WRITEUINT16(p, entry->numlumps);
+		WRITEUINT32(p, (UINT32)entry->lumpslength);
+		M_Memcpy(p, entry->lumps, entry->lumpslength);
+		p += entry->lumpslength;
+	}
+
+	if (!FIL_WriteFile(W_FileCachePath(), buffer, length))
+		CONS_Alert(CONS_WARNING, M_GetText("Couldn't write %s\n"), WADCACHEFILENAME);
+	Z_Free(buffer);
+}
+
+/** Looks up a file in the cache.
+  *
+  * \param path The file, as it would be opened.
+  * \return The cache entry, or NULL if the file isn't in there or has changed since.
+  */
+static wadcache_t *W_FindCachedFile(const char *path)
+{
+	wadcache_t *entry;
+	UINT32 filesize;
+	INT64 mtime;
+
+	if (!wadcacheloaded)
+		W_LoadFileCache();
+
+	if (!wadcache || !W_GetFileStamp(path, &filesize, &mtime))
+		return NULL;
+
+	for (entry = wadcache; entry; entry = entry->next)
+		if (entry->filesize == filesize && entry->mtime == mtime && !strcmp(entry->path, path))
+			return entry;
+
+	return NULL;
+}
+
+/** Rebuilds a file's lumpinfo from its cache entry.
+  *
+  * \param entry The cache entry.
+  * \return A lumpinfo array just like the ResGetLumps* functions make,
+  *         or NULL if the entry is broken.
+  */
+static lumpinfo_t *W_GetCachedLumps(const wadcache_t *entry)
+{
+	lumpinfo_t *lumpinfo, *lump_p;
+	const UINT8 *p = entry->lumps, *end = entry->lumps + entry->lumpslength;
+	UINT16 i;
+
+	lumpinfo = Z_Calloc((entry->numlumps ? entry->numlumps : 1) * sizeof (*lumpinfo), PU_STATIC, NULL);
+	for (i = 0, lump_p = lumpinfo; i < entry->numlumps; i++, lump_p++)
+	{
+		const UINT8 *longname, *fullname;
+
+		// position, disksize, size, compression, name
+		if (end - p < 4 + 4 + 4 + 1 + 8)
+			break;
+		lump_p->position = READUINT32(p);
+		lump_p->disksize = READUINT32(p);
+		lump_p->size = READUINT32(p);
+		lump_p->compression = READUINT8(p);
+		M_Memcpy(lump_p->name, p, 8);
+		p += 8;
+
+		longname = p;
+		if ((p = memchr(p, '\0', end - p)) == NULL)
+			break;
+		fullname = ++p;
+		if ((p = memchr(p, '\0', end - p)) == NULL)
+			break;
+		p++;
+
+		lump_p->longname = Z_StrDup((const char *)longname);
+		lump_p->fullname = Z_StrDup((const char *)fullname);
+	}
+
+	if (i < entry->numlumps)
+	{
+		while (i--)
+		{
+			Z_Free(lumpinfo[i].longname);
+			Z_Free(lumpinfo[i].fullname);
+		}
+		Z_Free(lumpinfo);
+		return NULL;
+	}
+
+	return lumpinfo;
+}
+
+/** Adds a file to the cache, replacing any older entry for the same path.
+  *
+  * \param path The file, as it was opened.
+  * \param md5sum The file's MD5.
+  * \param important Whether the file is important, see W_VerifyNMUSlumps.
+  * \param lumpinfo The file's lump directory.
+  * \param numlumps The number of lumps in the file.
+  */
+static void W_CacheFileInfo(const char *path, const UINT8 *md5sum, boolean important, const lumpinfo_t *lumpinfo, UINT16 numlumps)
+{
+	wadcache_t *entry, **link;
+	UINT32 filesize;
+	INT64 mtime;
+	UINT8 *p;
+	UINT16 i;
+
+	if (M_CheckParm("-nowadcache") || !W_GetFileStamp(path, &filesize, &mtime))
+		return;
+
+	for (link = &wadcache; (entry = *link) != NULL; link = &entry->next)
+		if (!strcmp(entry->path, path))
+		{
+			*link = entry->next;
+			W_FreeCacheEntry(entry);
+			break;
+		}
+
+	entry = Z_Calloc(sizeof (*entry), PU_STATIC, NULL);
+	entry->path = Z_StrDup(path);
+	entry->filesize = filesize;
+	entry->mtime = mtime;
+	M_Memcpy(entry->md5sum, md5sum, 16);
+	entry->important = important;
+	entry->numlumps = numlumps;
+
+	for (i = 0; i < numlumps; i++)
+		entry->lumpslength += 4 + 4 + 4 + 1 + 8 + strlen(lumpinfo[i].longname) + 1 + strlen(lumpinfo[i].fullname) + 1;
+
+	p = entry->lumps = Z_Malloc(entry->lumpslength ? entry->lumpslength : 1, PU_STATIC, NULL);
+	for (i = 0; i < numlumps; i++)
+	{
+		WRITEUINT32(p, (UINT32)lumpinfo[i].position);
+		WRITEUINT32(p, (UINT32)lumpinfo[i].disksize);
+		WRITEUINT32(p, (UINT32)lumpinfo[i].size);
+		WRITEUINT8(p, lumpinfo[i].compression);
+		M_Memcpy(p, lumpinfo[i].name, 8);
+		p += 8;
+		strcpy((char *)p, lumpinfo[i].longname);
+		p += strlen(lumpinfo[i].longname) + 1;
+		strcpy((char *)p, lumpinfo[i].fullname);
+		p += strlen(lumpinfo[i].fullname) + 1;
+	}
+
+	entry->next = wadcache;
+	wadcache = entry;
+	wadcachedirty = true;
+}
+
 // Invalidates the cache of lump numbers. Call this whenever a wad is added.
 static void W_InvalidateLumpnumCache(void)
 {
@@ -682,6 +1030,82 @@ static lumpinfo_t* ResGetLumpsZip (FILE* handle, UINT16* nlmp)
 	return lumpinfo;
 }
 
+#define LUMPHASH_WHOLENAME ((size_t)-1)
+
+// Hashes a lump name, stopping after maxlen characters.
+// Case sensitive, since the lookups compare names that way too.
+static inline UINT32 W_HashLumpName(const char *name, size_t maxlen)
+{
+	UINT32 hash = 2166136261u;
+	while (maxlen-- && *name)
+		hash = (hash ^ (UINT8)*name++) * 16777619u;
+	return hash;
+}
+
+// Builds one of the lump name lookup tables for a wad.
+// long names are hashed in full, short names only up to 8 characters.
+static void W_MakeLumpHash(lumphash_t *hash, const lumpinfo_t *lumpinfo, UINT16 numlumps, boolean longnames)
+{
+	UINT32 numchains = 1, h;
+	UINT16 i;
+
+	// Aim for about one lump per chain.
+	while (numchains < numlumps && numchains < 0x8000)
+		numchains <<= 1;
+
+	hash->mask = (UINT16)(numchains - 1);
+	hash->first = Z_Malloc(numchains * sizeof (*hash->first), PU_STATIC, NULL);
+	hash->next = Z_Malloc((numlumps ? numlumps : 1) * sizeof (*hash->next), PU_STATIC, NULL);
+	memset(hash->first, 0xFF, numchains * sizeof (*hash->first));
+
+	// Link backwards so that every chain ends up in ascending order.
+	for (i = numlumps; i-- > 0;)
+	{
+		if (longnames)
+			h = W_HashLumpName(lumpinfo[i].longname, LUMPHASH_WHOLENAME) & hash->mask;
+		else
+			h = W_HashLumpName(lumpinfo[i].name, 8) & hash->mask;
+		hash->next[i] = hash->first[h];
+		hash->first[h] = i;
+	}
+}
+
+#ifdef HAVE_ZLIB
+/** Inflates a raw DEFLATE stream, as found in PK3s.
+  * Doesn't touch zone memory or the console, so worker threads can use it.
+  *
+  * \param raw The compressed data.
+  * \param rawsize Size of the compressed data.
+  * \param dest Where the decompressed data goes.
+  * \param destsize Size of the decompressed data.
+  * \return Z_STREAM_END on success, otherwise a zlib error code for zerr.
+  */
+static int W_InflateLump(void *raw, unsigned long rawsize, void *dest, unsigned long destsize)
+{
+	int zErr;
+	z_stream strm;
+
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+
+	strm.total_in = strm.avail_in = rawsize;
+	strm.total_out = strm.avail_out = destsize;
+
+	strm.next_in = raw;
+	strm.next_out = dest;
+
+	zErr = inflateInit2(&strm, -15);
+	if (zErr == Z_OK)
+	{
+		zErr = inflate(&strm, Z_FINISH);
+		(void)inflateEnd(&strm);
+	}
+
+	return zErr;
+}
+#endif
+
 static UINT16 W_InitFileError (const char *filename, boolean exitworthy)
 {
 	if (exitworthy)
@@ -708,7 +1132,115 @@ static UINT16 W_InitFileError (const char *filename, boolean exitworthy)
 //
 // Can now load dehacked files (.soc)
 //
+static UINT16 W_InitFileWithMD5(const char *filename, boolean mainfile, boolean startup, const UINT8 *knownmd5);
+
 UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
+{
+	return W_InitFileWithMD5(filename, mainfile, startup, NULL);
+}
+
+#ifdef HAVE_ZLIB
+typedef struct
+{
+	UINT16 wad;
+	UINT16 *lumps; // which lumps to inflate
+	FILE **handles; // one per thread, unless the file is mapped
+} preinflate_t;
+
+// Inflates one lump for W_PreinflateLumps, on a worker thread.
+static void W_PreinflateJob(void *userdata, size_t job, INT32 thread)
+{
+	preinflate_t *pre = userdata;
+	wadfile_t *wadfile = wadfiles[pre->wad];
+	const UINT16 lump = pre->lumps[job];
+	const lumpinfo_t *l = &wadfile->lumpinfo[lump];
+	UINT8 *raw, *dec;
+
+	if (wadfile->mapped)
+	{
+		if (l->position > wadfile->filesize || l->disksize > wadfile->filesize - l->position)
+			return;
+		raw = wadfile->mapped + l->position;
+	}
+	else
+	{
+		if (!pre->handles[thread] && (pre->handles[thread] = fopen(wadfile->filename, "rb")) == NULL)
+			return;
+		if ((raw = malloc(l->disksize)) == NULL)
+			return;
+		if (fseek(pre->handles[thread], (long)l->position, SEEK_SET) != 0
+			|| fread(raw, 1, l->disksize, pre->handles[thread]) < l->disksize)
+		{
+			free(raw);
+			return;
+		}
+	}
+
+	// Anything that goes wrong here is left for W_ReadLumpHeaderPwad to
+	// run into again and report.
+	if ((dec = malloc(l->size)) != NULL)
+	{
+		if (W_InflateLump(raw, l->disksize, dec, l->size) == Z_STREAM_END)
+			wadfile->preinflated[lump] = dec;
+		else
+			free(dec);
+	}
+
+	if (!wadfile->mapped)
+		free(raw);
+}
+
+/** Inflates the compressed Lua, SOC and TEXTURES lumps of a PK3 on worker
+  * threads, right before they all get read in one go.
+  * W_ReadLumpHeaderPwad then just copies them out. This doesn't change what
+  * gets loaded or in what order, only where the inflating happens.
+  *
+  * \param wadnum The PK3 to go through.
+  */
+static void W_PreinflateLumps(UINT16 wadnum)
+{
+	wadfile_t *wadfile = wadfiles[wadnum];
+	preinflate_t pre;
+	size_t count = 0;
+	INT32 i;
+
+	if (I_NumJobThreads() < 2)
+		return;
+
+	pre.wad = wadnum;
+	pre.lumps = Z_Malloc(wadfile->numlumps * sizeof (*pre.lumps), PU_STATIC, NULL);
+	for (i = 0; i < wadfile->numlumps; i++)
+	{
+		const lumpinfo_t *l = &wadfile->lumpinfo[i];
+		if (l->compression != CM_DEFLATE || !l->size)
+			continue;
+		if (strnicmp(l->fullname, "Lua/", 4) && strnicmp(l->fullname, "SOC/", 4)
+			&& stricmp(l->fullname, "Init.lua") && stricmp(l->longname, "TEXTURES"))
+			continue;
+		pre.lumps[count++] = (UINT16)i;
+	}
+
+	// Not worth waking up the workers for.
+	if (count < 2)
+	{
+		Z_Free(pre.lumps);
+		return;
+	}
+
+	wadfile->preinflated = calloc(wadfile->numlumps, sizeof (*wadfile->preinflated));
+	pre.handles = Z_Calloc(I_NumJobThreads() * sizeof (*pre.handles), PU_STATIC, NULL);
+	if (wadfile->preinflated)
+		I_RunJobs(W_PreinflateJob, &pre, count, 0);
+
+	for (i = 0; i < I_NumJobThreads(); i++)
+		if (pre.handles[i])
+			fclose(pre.handles[i]);
+	Z_Free(pre.handles);
+	Z_Free(pre.lumps);
+}
+#endif
+
+static UINT16 W_InitFileWithMD5(const char *filename, boolean mainfile, boolean startup, const UINT8 *knownmd5)
 {
 	FILE *handle;
 	lumpinfo_t *lumpinfo = NULL;
@@ -721,6 +1253,7 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
 	size_t packetsize;
 	UINT8 md5sum[16];
 	boolean important;
+	wadcache_t *cached;
 
 	if (!(refreshdirmenu & REFRESHDIR_ADDFILE))
 		refreshdirmenu = REFRESHDIR_NORMAL|REFRESHDIR_ADDFILE; // clean out cons_alerts that happened earlier
@@ -750,10 +1283,13 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
 	if ((handle = W_OpenWadFile(&filename, true)) == NULL)
 		return W_InitFileError(filename, startup);
 
+	// Seen this exact file before?
+	cached = W_FindCachedFile(filename);
+
 	// Check if wad files will overflow fileneededbuffer. Only the filename part
 	// is send in the packet; cf.
 	// see PutFileNeeded in d_netfil.c
-	if ((important = !W_VerifyNMUSlumps(filename)))
+	if ((important = (cached ? cached->important : !W_VerifyNMUSlumps(filename))))
 	{
 		packetsize = packetsizetally + nameonlylength(filename) + 22;
 
@@ -775,7 +1311,12 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
 	// Let's not add a wad file if the MD5 matches
 	// an MD5 of an already added WAD file!
 	//
-	W_MakeFileMD5(filename, md5sum);
+	if (knownmd5)
+		M_Memcpy(md5sum, knownmd5, 16);
+	else if (cached)
+		M_Memcpy(md5sum, cached->md5sum, 16);
+	else
+		W_MakeFileMD5(filename, md5sum);
 
 	for (i = 0; i < numwadfiles; i++)
 	{
@@ -789,7 +1330,10 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
 	}
 #endif
 
-	switch(type = ResourceFileDetect(filename))
+	type = ResourceFileDetect(filename);
+	if (cached && (lumpinfo = W_GetCachedLumps(cached)) != NULL)
+		numlumps = cached->numlumps;
+	else switch(type)
 	{
 	case RET_SOC:
 		lumpinfo = ResGetLumpsStandalone(handle, &numlumps, "OBJCTCFG");
@@ -813,6 +1357,14 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
 		return W_InitFileError(filename, startup);
 	}
 
+	if (!cached)
+	{
+#ifdef NOMD5
+		memset(md5sum, 0x00, 16);
+#endif
+		W_CacheFileInfo(filename, md5sum, important, lumpinfo, numlumps);
+	}
+
 	//
 	// link wad file to search files
 	//
@@ -823,10 +1375,33 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
 	wadfile->numlumps = (UINT16)numlumps;
 	wadfile->lumpinfo = lumpinfo;
 	wadfile->important = important;
+	W_MakeLumpHash(&wadfile->namehash, lumpinfo, numlumps, false);
+	W_MakeLumpHash(&wadfile->longnamehash, lumpinfo, numlumps, true);
 	fseek(handle, 0, SEEK_END);
 	wadfile->filesize = (unsigned)ftell(handle);
 	wadfile->type = type;
 
+	// Map the file into memory if asked to, so lump reads become memcpys
+	// instead of seeks and reads through stdio, and uncompressed lumps get
+	// cached without a copy at all. The mapping is private and writable,
+	// so anything that scribbles on a cached lump only touches its own
+	// copy of the pages, never the file.
+	wadfile->mapped = NULL;
+	wadfile->preinflated = NULL;
+#ifdef HAVE_MMAP
+	if (wadfile->filesize && M_CheckParm("-mmapwads"))
+	{
+		void *map = mmap(NULL, wadfile->filesize, PROT_READ|PROT_WRITE, MAP_PRIVATE, fileno(handle), 0);
+		if (map != MAP_FAILED)
+		{
+			wadfile->mapped = map;
+			Z_AddExternal(map, wadfile->filesize);
+		}
+		else
+			CONS_Alert(CONS_WARNING, M_GetText("Could not map %s into memory, reading it normally\n"), filename);
+	}
+#endif
+
 	// already generated, just copy it over
 	M_Memcpy(&wadfile->md5sum, &md5sum, 16);
 
@@ -864,6 +1439,9 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
 		W_LoadDehackedLumps(numwadfiles - 1, mainfile);
 		break;
 	case RET_PK3:
+#ifdef HAVE_ZLIB
+		W_PreinflateLumps(numwadfiles - 1);
+#endif
 		W_LoadDehackedLumpsPK3(numwadfiles - 1, mainfile);
 		break;
 	case RET_SOC:
@@ -878,6 +1456,8 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
 	}
 
 	W_InvalidateLumpnumCache();
+	if (!startup)
+		W_SaveFileCache();
 	return wadfile->numlumps;
 }
 
@@ -890,17 +1470,81 @@ UINT16 W_InitFile(const char *filename, boolean mainfile, boolean startup)
   *
   * \param filenames A null-terminated list of files to use.
   */
+#ifndef NOMD5
+typedef struct
+{
+	char path[MAX_WADPATH]; // empty if the file couldn't be found
+	UINT8 md5sum[16];
+	boolean hashed;
+} filehash_t;
+
+// Hashes one file for W_InitMultipleFiles, on a worker thread.
+static void W_HashFileJob(void *userdata, size_t job, INT32 thread)
+{
+	filehash_t *fh = (filehash_t *)userdata + job;
+	FILE *handle;
+	(void)thread;
+
+	if (!*fh->path || (handle = fopen(fh->path, "rb")) == NULL)
+		return;
+	fh->hashed = (md5_stream(handle, fh->md5sum) == 0);
+	fclose(handle);
+}
+#endif
+
 void W_InitMultipleFiles(char **filenames, UINT16 mainfiles)
 {
+#ifndef NOMD5
+	filehash_t *hashes;
+#endif
+	size_t i, numfiles = 0;
+
 	// open all the files, load headers, and count lumps
 	numwadfiles = 0;
 
+	while (filenames[numfiles])
+		numfiles++;
+
+#ifndef NOMD5
+	// Hashing is most of the work for big files, so do all of them at
+	// once first. The files are still added one by one, in order, below.
+	hashes = Z_Calloc(numfiles * sizeof (*hashes), PU_STATIC, NULL);
+	for (i = 0; i < numfiles; i++)
+	{
+		const char *filename = filenames[i];
+		FILE *handle = W_OpenWadFile(&filename, false);
+		wadcache_t *cached;
+		if (!handle)
+			continue;
+		fclose(handle);
+
+		if ((cached = W_FindCachedFile(filename)) != NULL)
+		{
+			M_Memcpy(hashes[i].md5sum, cached->md5sum, 16);
+			hashes[i].hashed = true;
+		}
+		else
+			strlcpy(hashes[i].path, filename, sizeof hashes[i].path);
+	}
+	I_RunJobs(W_HashFileJob, hashes, numfiles, 0);
+#endif
+
 	// will be realloced as lumps are added
-	for (; *filenames; filenames++)
+	for (i = 0; i < numfiles; i++)
 	{
-		//CONS_Debug(DBG_SETUP, "Loading %s\n", *filenames);
-		W_InitFile(*filenames, numwadfiles < mainfiles, true);
+		//CONS_Debug(DBG_SETUP, "Loading %s\n", filenames[i]);
+#ifndef NOMD5
+		W_InitFileWithMD5(filenames[i], numwadfiles < mainfiles, true, hashes[i].hashed ? hashes[i].md5sum : NULL);
+#else
+		W_InitFile(filenames[i], numwadfiles < mainfiles, true);
+#endif
 	}
+
+#ifndef NOMD5
+	Z_Free(hashes);
+#endif
+
+	W_SaveFileCache();
 }
 
 /** Make sure a lump number is valid.
@@ -944,6 +1588,7 @@ UINT16 W_CheckNumForNamePwad(const char *name, UINT16 wad, UINT16 startlump)
 {
 	UINT16 i;
 	static char uname[8 + 1];
+	const wadfile_t *wadfile;
 
 	if (!TestValidLump(wad,0))
 		return INT16_MAX;
@@ -952,15 +1597,16 @@ UINT16 W_CheckNumForNamePwad(const char *name, UINT16 wad, UINT16 startlump)
 	strupr(uname);
 
 	//
-	// scan forward
+	// walk the name's hash chain
 	// start at 'startlump', useful parameter when there are multiple
 	//                       resources with the same name
 	//
-	if (startlump < wadfiles[wad]->numlumps)
+	wadfile = wadfiles[wad];
+	if (startlump < wadfile->numlumps)
 	{
-		lumpinfo_t *lump_p = wadfiles[wad]->lumpinfo + startlump;
-		for (i = startlump; i < wadfiles[wad]->numlumps; i++, lump_p++)
-			if (!strncmp(lump_p->name, uname, sizeof(uname) - 1))
+		for (i = wadfile->namehash.first[W_HashLumpName(uname, 8) & wadfile->namehash.mask];
+			i != LUMPHASHEND; i = wadfile->namehash.next[i])
+			if (i >= startlump && !strncmp(wadfile->lumpinfo[i].name, uname, sizeof(uname) - 1))
 				return i;
 	}
 
@@ -978,6 +1624,7 @@ UINT16 W_CheckNumForLongNamePwad(const char *name, UINT16 wad, UINT16 startlump)
 {
 	UINT16 i;
 	static char uname[256 + 1];
+	const wadfile_t *wadfile;
 
 	if (!TestValidLump(wad,0))
 		return INT16_MAX;
@@ -986,15 +1633,16 @@ UINT16 W_CheckNumForLongNamePwad(const char *name, UINT16 wad, UINT16 startlump)
 	strupr(uname);
 
 	//
-	// scan forward
+	// walk the name's hash chain
 	// start at 'startlump', useful parameter when there are multiple
 	//                       resources with the same name
 	//
-	if (startlump < wadfiles[wad]->numlumps)
+	wadfile = wadfiles[wad];
+	if (startlump < wadfile->numlumps)
 	{
-		lumpinfo_t *lump_p = wadfiles[wad]->lumpinfo + startlump;
-		for (i = startlump; i < wadfiles[wad]->numlumps; i++, lump_p++)
-			if (!strcmp(lump_p->longname, uname))
+		for (i = wadfile->longnamehash.first[W_HashLumpName(uname, LUMPHASH_WHOLENAME) & wadfile->longnamehash.mask];
+			i != LUMPHASHEND; i = wadfile->longnamehash.next[i])
+			if (i >= startlump && !strcmp(wadfile->lumpinfo[i].longname, uname))
 				return i;
 	}
 
@@ -1347,6 +1995,40 @@ void zerr(int ret)
 }
 #endif
 
+/** Gets the raw, still compressed, data of a lump.
+  * Reads from the current position of the wad's handle, or straight out of
+  * the file mapping when there is one.
+  *
+  * \param wad Wad number to read from.
+  * \param lump Lump number to read from.
+  * \param pos Position of the data in the file.
+  * \param len Number of bytes to get.
+  * \return The data. Give it back with W_FreeRawLumpData.
+  */
+static void *W_GetRawLumpData(UINT16 wad, UINT16 lump, size_t pos, size_t len)
+{
+	wadfile_t *wadfile = wadfiles[wad];
+	void *raw;
+
+	if (wadfile->mapped)
+	{
+		if (pos > wadfile->filesize || len > wadfile->filesize - pos)
+			I_Error("wad %d, lump %d: cannot read compressed data", wad, lump);
+		return wadfile->mapped + pos;
+	}
+
+	raw = Z_Malloc(len, PU_STATIC, NULL);
+	if (fread(raw, 1, len, wadfile->handle) < len)
+		I_Error("wad %d, lump %d: cannot read compressed data", wad, lump);
+	return raw;
+}
+
+static inline void W_FreeRawLumpData(UINT16 wad, void *raw)
+{
+	if (!wadfiles[wad]->mapped)
+		Z_Free(raw);
+}
+
 /** Reads bytes from the head of a lump.
   * Note: If the lump is compressed, the whole thing has to be read anyway.
   *
@@ -1360,9 +2042,9 @@ void zerr(int ret)
   */
 size_t W_ReadLumpHeaderPwad(UINT16 wad, UINT16 lump, void *dest, size_t size, size_t offset)
 {
-	size_t lumpsize;
+	size_t lumpsize, bytesread;
 	lumpinfo_t *l;
-	FILE *handle;
+	wadfile_t *wadfile;
 
 	if (!TestValidLump(wad,lump))
 		return 0;
@@ -1376,26 +2058,54 @@ size_t W_ReadLumpHeaderPwad(UINT16 wad, UINT16 lump, void *dest, size_t size, si
 	if (!size || size+offset > lumpsize)
 		size = lumpsize - offset;
 
+	wadfile = wadfiles[wad];
+	l = wadfile->lumpinfo + lump;
+
+	// Already inflated during startup?
+	if (wadfile->preinflated && wadfile->preinflated[lump])
+	{
+		M_Memcpy(dest, wadfile->preinflated[lump] + offset, size);
+		// Most of these are only ever read in full once, so let go of the copy then.
+		if (!offset && size == lumpsize)
+		{
+			free(wadfile->preinflated[lump]);
+			wadfile->preinflated[lump] = NULL;
+		}
+#ifdef NO_PNG_LUMPS
+		if (R_IsLumpPNG((UINT8 *)dest, size))
+			W_ThrowPNGError(l->fullname, wadfile->filename);
+#endif
+		return size;
+	}
+
 	// Let's get the raw lump data.
 	// We setup the desired file handle to read the lump data.
-	l = wadfiles[wad]->lumpinfo + lump;
-	handle = wadfiles[wad]->handle;
-	fseek(handle, (long)(l->position + offset), SEEK_SET);
+	// (A mapped file doesn't need it, the data is already in memory.)
+	if (!wadfile->mapped)
+		fseek(wadfile->handle, (long)(l->position + offset), SEEK_SET);
 
 	// But let's not copy it yet. We support different compression formats on lumps, so we need to take that into account.
 	switch(wadfiles[wad]->lumpinfo[lump].compression)
 	{
 	case CM_NOCOMPRESSION:		// If it's uncompressed, we directly write the data into our destination, and return the bytes read.
-#ifdef NO_PNG_LUMPS
+		if (wadfile->mapped)
 		{
-			size_t bytesread = fread(dest, 1, size, handle);
-			if (R_IsLumpPNG((UINT8 *)dest, bytesread))
-				W_ThrowPNGError(l->fullname, wadfiles[wad]->filename);
-			return bytesread;
+			// Stop at the end of the file, like fread would.
+			if (l->position + offset >= wadfile->filesize)
+				bytesread = 0;
+			else
+			{
+				bytesread = min(size, wadfile->filesize - (l->position + offset));
+				M_Memcpy(dest, wadfile->mapped + l->position + offset, bytesread);
+			}
 		}
-#else
-		return fread(dest, 1, size, handle);
+		else
+			bytesread = fread(dest, 1, size, wadfile->handle);
+#ifdef NO_PNG_LUMPS
+		if (R_IsLumpPNG((UINT8 *)dest, bytesread))
+			W_ThrowPNGError(l->fullname, wadfiles[wad]->filename);
 #endif
+		return bytesread;
 	case CM_LZF:		// Is it LZF compressed? Used by ZWADs.
 		{
 #ifdef ZWAD
@@ -1403,11 +2113,9 @@ size_t W_ReadLumpHeaderPwad(UINT16 wad, UINT16 lump, void *dest, size_t size, si
 			char *decData; // Lump's decompressed real data.
 			size_t retval; // Helper var, lzf_decompress returns 0 when an error occurs.
 
-			rawData = Z_Malloc(l->disksize, PU_STATIC, NULL);
+			rawData = W_GetRawLumpData(wad, lump, l->position + offset, l->disksize);
 			decData = Z_Malloc(l->size, PU_STATIC, NULL);
 
-			if (fread(rawData, 1, l->disksize, handle) < l->disksize)
-				I_Error("wad %d, lump %d: cannot read compressed data", wad, lump);
 			retval = lzf_decompress(rawData, l->disksize, decData, l->size);
 #ifndef AVOID_ERRNO
 			if (retval == 0) // If this was returned, check if errno was set
@@ -1428,7 +2136,7 @@ size_t W_ReadLumpHeaderPwad(UINT16 wad, UINT16 lump, void *dest, size_t size, si
 			if (!decData) // Did we get no data at all?
 				return 0;
 			M_Memcpy(dest, decData + offset, size);
-			Z_Free(rawData);
+			W_FreeRawLumpData(wad, rawData);
 			Z_Free(decData);
 #ifdef NO_PNG_LUMPS
 			if (R_IsLumpPNG((UINT8 *)dest, size))
@@ -1448,41 +2156,16 @@ size_t W_ReadLumpHeaderPwad(UINT16 wad, UINT16 lump, void *dest, size_t size, si
 			UINT8 *decData; // Lump's decompressed real data.
 
 			int zErr; // Helper var.
-			z_stream strm;
 			unsigned long rawSize = l->disksize;
 			unsigned long decSize = l->size;
 
-			rawData = Z_Malloc(rawSize, PU_STATIC, NULL);
+			rawData = W_GetRawLumpData(wad, lump, l->position + offset, rawSize);
 			decData = Z_Malloc(decSize, PU_STATIC, NULL);
 
-			if (fread(rawData, 1, rawSize, handle) < rawSize)
-				I_Error("wad %d, lump %d: cannot read compressed data", wad, lump);
-
-			strm.zalloc = Z_NULL;
-			strm.zfree = Z_NULL;
-			strm.opaque = Z_NULL;
-
-			strm.total_in = strm.avail_in = rawSize;
-			strm.total_out = strm.avail_out = decSize;
-
-			strm.next_in = rawData;
-			strm.next_out = decData;
-
-			zErr = inflateInit2(&strm, -15);
-			if (zErr == Z_OK)
+			zErr = W_InflateLump(rawData, rawSize, decData, decSize);
+			if (zErr == Z_STREAM_END)
 			{
-				zErr = inflate(&strm, Z_FINISH);
-				if (zErr == Z_STREAM_END)
-				{
-					M_Memcpy(dest, decData, size);
-				}
-				else
-				{
-					size = 0;
-					zerr(zErr);
-				}
-
-				(void)inflateEnd(&strm);
+				M_Memcpy(dest, decData, size);
 			}
 			else
 			{
@@ -1490,7 +2173,7 @@ size_t W_ReadLumpHeaderPwad(UINT16 wad, UINT16 lump, void *dest, size_t size, si
 				zerr(zErr);
 			}
 
-			Z_Free(rawData);
+			W_FreeRawLumpData(wad, rawData);
 			Z_Free(decData);
 
 #ifdef NO_PNG_LUMPS
@@ -1528,6 +2211,36 @@ void W_ReadLumpPwad(UINT16 wad, UINT16 lump, void *dest)
 	W_ReadLumpHeaderPwad(wad, lump, dest, 0, 0);
 }
 
+/** Finds an uncompressed lump in a mapped wad file, so it can be used
+  * right where it is instead of being copied out.
+  * The pointer can be given to Z_Free and Z_ChangeTag like any cached
+  * lump, see Z_AddExternal.
+  *
+  * \param wad Wad number of the lump.
+  * \param lump Lump number of the lump.
+  * \return The lump in the mapping, or NULL if it has to be read normally.
+  */
+static void *W_MappedLumpPwad(UINT16 wad, UINT16 lump)
+{
+	wadfile_t *wadfile = wadfiles[wad];
+	lumpinfo_t *l = &wadfile->lumpinfo[lump];
+
+	if (!wadfile->mapped || l->compression != CM_NOCOMPRESSION || !l->size)
+		return NULL;
+	// A truncated lump reads short, let W_ReadLumpHeaderPwad deal with it.
+	if (l->position > wadfile->filesize || l->size > wadfile->filesize - l->position)
+		return NULL;
+	// Plenty of lumps get read as structs, keep those aligned.
+	if (l->position & 3)
+		return NULL;
+
+#ifdef NO_PNG_LUMPS
+	if (R_IsLumpPNG(wadfile->mapped + l->position, l->size))
+		W_ThrowPNGError(l->fullname, wadfile->filename);
+#endif
+	return wadfile->mapped + l->position;
+}
+
 // ==========================================================================
 // W_CacheLumpNum
 // ==========================================================================
@@ -1541,8 +2254,14 @@ void *W_CacheLumpNumPwad(UINT16 wad, UINT16 lump, INT32 tag)
 	lumpcache = wadfiles[wad]->lumpcache;
 	if (!lumpcache[lump])
 	{
-		void *ptr = Z_Malloc(W_LumpLengthPwad(wad, lump), tag, &lumpcache[lump]);
-		W_ReadLumpHeaderPwad(wad, lump, ptr, 0, 0);  // read the lump in full
+		void *ptr = W_MappedLumpPwad(wad, lump);
+		if (ptr)
+			lumpcache[lump] = ptr; // never purged, the tag doesn't matter
+		else
+		{
+			ptr = Z_Malloc(W_LumpLengthPwad(wad, lump), tag, &lumpcache[lump]);
+			W_ReadLumpHeaderPwad(wad, lump, ptr, 0, 0);  // read the lump in full
+		}
 	}
 	else
 		Z_ChangeTag(lumpcache[lump], tag);
@@ -1867,6 +2586,94 @@ void W_VerifyFileMD5(UINT16 wadfilenum, const char *matchmd5)
 #endif
 }
 
+#ifdef DEVELOP
+// Plain forward scan through one wad's lumps, the way lump names were
+// looked up before the hash index. Only used by lumpbench for comparison.
+static UINT16 W_ScanNumForNamePwad(const char *name, UINT16 wad, boolean longname)
+{
+	const lumpinfo_t *lump_p = wadfiles[wad]->lumpinfo;
+	UINT16 i;
+
+	for (i = 0; i < wadfiles[wad]->numlumps; i++, lump_p++)
+		if (longname ? !strcmp(lump_p->longname, name) : !strncmp(lump_p->name, name, 8))
+			return i;
+
+	return INT16_MAX;
+}
+
+/** The function called by the "lumpbench" console command.
+  * Looks up a spread of the loaded lump names in every file, newest first,
+  * with both the plain scan and the hash index, and prints the timings.
+  * Optional argument: number of names to look up (default 10000).
+  */
+void Command_Lumpbench_f(void)
+{
+	size_t totallumps = 0, count = 10000, n, step, mismatches = 0;
+	int scantime[2] = {0, 0}, hashtime[2] = {0, 0};
+	INT32 longname;
+
+	if (COM_Argc() > 1)
+		count = max(1, atoi(COM_Argv(1)));
+
+	for (n = 0; n < numwadfiles; n++)
+		totallumps += wadfiles[n]->numlumps;
+	if (!totallumps)
+		return;
+	step = max(1, totallumps / count);
+
+	for (longname = 0; longname < 2; longname++)
+	{
+		size_t k = 0;
+
+		for (n = 0; n < count; n++, k = (k + step) % totallumps)
+		{
+			const lumpinfo_t *lump_p;
+			char uname[256 + 1];
+			UINT16 w, scanres = INT16_MAX, hashres = INT16_MAX;
+			INT32 i, scanwad = -1, hashwad = -1, t;
+			size_t l = k;
+
+			for (w = 0; l >= wadfiles[w]->numlumps; w++)
+				l -= wadfiles[w]->numlumps;
+			lump_p = &wadfiles[w]->lumpinfo[l];
+			strlcpy(uname, longname ? lump_p->longname : lump_p->name, sizeof uname);
+			strupr(uname);
+
+			t = I_GetTimeMicros();
+			for (i = numwadfiles - 1; i >= 0; i--)
+				if ((scanres = W_ScanNumForNamePwad(uname, (UINT16)i, longname)) != INT16_MAX)
+				{
+					scanwad = i;
+					break;
+				}
+			scantime[longname] += I_GetTimeMicros() - t;
+
+			t = I_GetTimeMicros();
+			for (i = numwadfiles - 1; i >= 0; i--)
+			{
+				hashres = longname ? W_CheckNumForLongNamePwad(uname, (UINT16)i, 0)
+					: W_CheckNumForNamePwad(uname, (UINT16)i, 0);
+				if (hashres != INT16_MAX)
+				{
+					hashwad = i;
+					break;
+				}
+			}
+			hashtime[longname] += I_GetTimeMicros() - t;
+
+			if (scanwad != hashwad || scanres != hashres)
+				mismatches++;
+		}
+	}
+
+	CONS_Printf(M_GetText("%s lookups over %s lumps in %d files:\n"), sizeu1(count), sizeu2(totallumps), numwadfiles);
+	CONS_Printf(M_GetText("Short names: scan %8d us, hash %8d us\n"), scantime[0], hashtime[0]);
+	CONS_Printf(M_GetText("Long names:  scan %8d us, hash %8d us\n"), scantime[1], hashtime[1]);
+	if (mismatches)
+		CONS_Alert(CONS_WARNING, M_GetText("%s lookups gave different results!\n"), sizeu1(mismatches));
+}
+#endif
+
 // Verify versions for different archive
 // formats. checklist assumed to be valid.
 
@@ -116,11 +116,25 @@ typedef enum restype
 	RET_UNKNOWN,
 } restype_t;
 
+// Lump name lookup table for one wad.
+// Each chain lists the lumps whose names hash to it in ascending order,
+// so lookups from a given 'startlump' behave just like a forward scan.
+#define LUMPHASHEND 0xFFFF
+
+typedef struct
+{
+	UINT16 *first; // first lump of each chain
+	UINT16 *next; // next lump in the same chain, per lump
+	UINT16 mask; // number of chains - 1
+} lumphash_t;
+
 typedef struct wadfile_s
 {
 	char *filename;
 	restype_t type;
 	lumpinfo_t *lumpinfo;
+	lumphash_t namehash; // by lumpinfo_t name
+	lumphash_t longnamehash; // by lumpinfo_t longname
 	lumpcache_t *lumpcache;
 	lumpcache_t *patchcache;
 #ifdef HWRENDER
@@ -128,6 +142,8 @@ typedef struct wadfile_s
 #endif
 	UINT16 numlumps; // this wad's number of resources
 	FILE *handle;
+	UINT8 *mapped; // the whole file mapped read-only into memory (-mmapwads), or NULL
+	UINT8 **preinflated; // lumps inflated ahead of time on worker threads (malloc'd), or NULL
 	UINT32 filesize; // for network
 	UINT8 md5sum[16];
 
@@ -213,6 +229,10 @@ void W_UnlockCachedPatch(void *patch);
 
 void W_VerifyFileMD5(UINT16 wadfilenum, const char *matchmd5);
 
+#ifdef DEVELOP
+void Command_Lumpbench_f(void);
+#endif
+
 int W_VerifyNMUSlumps(const char *filename);
 
 #endif // __W_WAD__
@@ -24,6 +24,12 @@
 ///        caught with this direct-malloc version. We also suspected that SRB2's
 ///        allocator was fragmenting badly. Finally, this version is a bit
 ///        simpler (about half the lines of code).
+///
+///        Small non-purgable allocations (thinkers, mobjs, line specials...)
+///        are the exception: they are carved out of size-class slabs, with the
+///        memblock_t stored inline in front of the data, so that allocating
+///        or freeing one of them is a free list push/pop instead of two
+///        malloc()/free() pairs.
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -32,6 +38,7 @@
 #include "i_video.h" // rendermode
 #include "z_zone.h"
 #include "m_misc.h" // M_Memcpy
+#include "m_argv.h" // M_CheckParm
 #include "lua_script.h"
 
 #ifdef HWRENDER
@@ -83,12 +90,68 @@ typedef struct memblock_s
 	struct memblock_s *next, *prev;
 } ATTRPACK memblock_t;
 
-// both the head and tail of the zone memory block list
-static memblock_t head;
+// Blocks are kept in one list per tag, so that freeing or measuring a
+// range of tags only walks the blocks that actually have those tags.
+// Tags outside of 1..NUMZONETAGS-2 share the first or last list.
+#define NUMZONETAGS 128
+#define ZTAGLIST(tag) ((tag) <= 0 ? 0 : (tag) >= NUMZONETAGS-1 ? NUMZONETAGS-1 : (tag))
+
+// both the head and tail of each zone memory block list
+static memblock_t heads[NUMZONETAGS];
+
+// bytes allocated in each list, as reported by Z_TagsUsage
+static size_t tagusage[NUMZONETAGS];
+
+#ifndef HAVE_VALGRIND
+#define ZSLAB
+#endif
+
+#ifdef ZSLAB
+// Size-class slabs for small allocations.
+// A slab slot holds the memblock_t, the memhdr_t and the data back to back,
+// and a slab block is recognised by its "real" pointer pointing at itself.
+// Slab pages are never given back to the system; freed slots go on the
+// free list of their size class and get reused by the next allocation.
+#define ZSLAB_PAGESIZE (64<<10)
+#define ZSLAB_PAGEHDR 16 // keeps the slots 16-byte aligned
+#define ZSLAB_MAXSIZE 1024
+
+typedef struct zslabfree_s
+{
+	struct zslabfree_s *next;
+} zslabfree_t;
+
+typedef struct
+{
+	size_t slotsize;
+	zslabfree_t *freelist;
+	void *pages; // first word of each page links to the next one
+	size_t numpages;
+	size_t numslots; // total slots in all pages
+	size_t used; // slots currently handed out
+} zslabclass_t;
+
+static const size_t slabsizes[] =
+{
+	  80,   96,  112,  128,  160,  192,  224,  256,
+	 320,  384,  448,  512,  640,  768,  896, 1024
+};
+#define NUMSLABCLASSES (sizeof slabsizes / sizeof *slabsizes)
+
+static zslabclass_t slabclasses[NUMSLABCLASSES]; // slot sizes set by Z_Init
+
+// slab class for a given slot size, indexed by (size+15)>>4
+static UINT8 slabclassfor[(ZSLAB_MAXSIZE>>4) + 1];
+
+static boolean zslabenabled = false;
+
+static void Command_Memslab_f(void);
+#endif
 
 //
 // Function prototypes
 //
+static void Z_CheckList(INT32 i, memblock_t *list);
 static void Command_Memfree_f(void);
 #ifdef ZDEBUG
 static void Command_Memdump_f(void);
@@ -107,26 +170,144 @@ void Z_Init(void)
 {
 	UINT32 total, memfree;
 
-	memset(&head, 0x00, sizeof(head));
+	INT32 i;
+
+	memset(heads, 0x00, sizeof(heads));
+	memset(tagusage, 0x00, sizeof(tagusage));
 
-	head.next = head.prev = &head;
+	for (i = 0; i < NUMZONETAGS; i++)
+		heads[i].next = heads[i].prev = &heads[i];
 
 	memfree = I_GetFreeMem(&total)>>20;
 	CONS_Printf("System memory: %uMB - Free: %uMB\n", total>>20, memfree);
 
+#ifdef ZSLAB
+	{
+		size_t s, c = 0;
+
+		for (c = 0; c < NUMSLABCLASSES; c++)
+			slabclasses[c].slotsize = slabsizes[c];
+
+		for (s = 0, c = 0; s < sizeof slabclassfor; s++)
+		{
+			while (slabclasses[c].slotsize < (s<<4))
+				c++;
+			slabclassfor[s] = (UINT8)c;
+		}
+	}
+
+	// Handy for tracking down overruns with external tools
+	zslabenabled = !M_CheckParm("-nozoneslab");
+#endif
+
 	// Note: This allocates memory. Watch out.
 	COM_AddCommand("memfree", Command_Memfree_f);
+#ifdef ZSLAB
+	COM_AddCommand("memslab", Command_Memslab_f);
+#endif
 
 #ifdef ZDEBUG
 	COM_AddCommand("memdump", Command_Memdump_f);
 #endif
 }
 
+// ---------------
+// External memory
+// ---------------
+
+typedef struct
+{
+	UINT8 *base;
+	size_t size;
+} zexternal_t;
+
+static zexternal_t *externals = NULL;
+static size_t numexternals = 0;
+
+/** Lets pointers into some memory the zone doesn't own, such as a
+  * mapped wad file, be handed to the zone functions. Z_Free and
+  * Z_ChangeTag leave them alone, and Z_Realloc copies them.
+  *
+  * \param base Start of the memory.
+  * \param size Size of the memory, in bytes.
+  * \sa Z_RemoveExternal
+  */
+void Z_AddExternal(void *base, size_t size)
+{
+	zexternal_t *ext = realloc(externals, (numexternals + 1) * sizeof *externals);
+	if (!ext)
+		I_Error("Z_AddExternal: out of memory");
+	externals = ext;
+	externals[numexternals].base = base;
+	externals[numexternals].size = size;
+	numexternals++;
+}
+
+/** Forgets about memory given to Z_AddExternal.
+  *
+  * \param base Start of the memory.
+  */
+void Z_RemoveExternal(void *base)
+{
+	size_t i;
+
+	for (i = 0; i < numexternals; i++)
+		if (externals[i].base == base)
+		{
+			externals[i] = externals[--numexternals];
+			return;
+		}
+}
+
+/** Finds the external memory a pointer points into.
+  *
+  * \param ptr A pointer.
+  * eturn The external memory, or NULL if the pointer isn't in any.
+  */
+static zexternal_t *Z_FindExternal(void *ptr)
+{
+	size_t i;
+
+	for (i = 0; i < numexternals; i++)
+		if ((UINT8 *)ptr >= externals[i].base && (UINT8 *)ptr < externals[i].base + externals[i].size)
+			return &externals[i];
+	return NULL;
+}
 
 // ----------------------
 // Zone memory allocation
 // ----------------------
 
+/** Links a block into the list for its tag.
+  *
+  * \param block The block, with its tag and size already set.
+  * \sa Z_UnlinkBlock
+  */
+static inline void Z_LinkBlock(memblock_t *block)
+{
+	const INT32 l = ZTAGLIST(block->tag);
+
+	block->next = heads[l].next;
+	block->prev = &heads[l];
+	heads[l].next = block;
+	block->next->prev = block;
+
+	tagusage[l] += block->size + sizeof *block;
+}
+
+/** Unlinks a block from the list for its tag.
+  *
+  * \param block The block.
+  * \sa Z_LinkBlock
+  */
+static inline void Z_UnlinkBlock(memblock_t *block)
+{
+	block->prev->next = block->next;
+	block->next->prev = block->prev;
+
+	tagusage[ZTAGLIST(block->tag)] -= block->size + sizeof *block;
+}
+
 /** Returns the corresponding memblock_t for a given memory block.
   *
   * \param ptr A pointer to allocated memory,
@@ -206,6 +387,9 @@ void Z_Free(void *ptr)
 	CONS_Debug(DBG_MEMORY, "Z_Free %s:%d\n", file, line);
 #endif
 
+	if (numexternals && Z_FindExternal(ptr))
+		return;
+
 #ifdef ZDEBUG
 	block = Ptr2Memblock2(ptr, "Z_Free", file, line);
 #else
@@ -228,13 +412,27 @@ void Z_Free(void *ptr)
 	if (block->user != NULL)
 		*block->user = NULL;
 
+	Z_UnlinkBlock(block);
+
+#ifdef ZSLAB
+	// Slab block: hand the slot back to its size class.
+	if (block->real == block)
+	{
+		zslabclass_t *sc = &slabclasses[slabclassfor[(block->size + sizeof *block + 15)>>4]];
+		zslabfree_t *slot = block->real;
+		block->hdr->id = 0; // catch double frees
+		slot->next = sc->freelist;
+		sc->freelist = slot;
+		sc->used--;
+		return;
+	}
+#endif
+
 	// Free the memory and get rid of the block.
 	free(block->real);
 #ifdef VALGRIND_DESTROY_MEMPOOL
 	VALGRIND_DESTROY_MEMPOOL(block);
 #endif
-	block->prev->next = block->next;
-	block->next->prev = block->prev;
 	free(block);
 }
 
@@ -267,6 +465,42 @@ static void *xm(size_t size)
 	return p;
 }
 
+#ifdef ZSLAB
+/** Takes a slot from a slab size class, adding a new page to it if it's full.
+  *
+  * \param sc The size class to allocate from.
+  * \return A pointer to the start of the slot.
+  */
+static void *Z_SlabAlloc(zslabclass_t *sc)
+{
+	zslabfree_t *slot;
+
+	if (sc->freelist == NULL)
+	{
+		UINT8 *page = xm(ZSLAB_PAGESIZE);
+		size_t i, n = (ZSLAB_PAGESIZE - ZSLAB_PAGEHDR) / sc->slotsize;
+
+		*(void **)page = sc->pages;
+		sc->pages = page;
+		sc->numpages++;
+		sc->numslots += n;
+
+		// Link backwards so the slots are handed out in address order.
+		for (i = n; i-- > 0;)
+		{
+			slot = (zslabfree_t *)(page + ZSLAB_PAGEHDR + i*sc->slotsize);
+			slot->next = sc->freelist;
+			sc->freelist = slot;
+		}
+	}
+
+	slot = sc->freelist;
+	sc->freelist = slot->next;
+	sc->used++;
+	return slot;
+}
+#endif
+
 /** The Z_MallocAlign function.
   * Allocates a block of memory, adds it to a linked list so we can keep track of it.
   *
@@ -293,6 +527,9 @@ void *Z_MallocAlign(size_t size, INT32 tag, void *user, INT32 alignbits)
 	memhdr_t *hdr;
 	void *given;
 	size_t blocksize = extrabytes + sizeof *hdr + size;
+#ifdef ZSLAB
+	boolean slab = false;
+#endif
 
 #ifdef ZDEBUG2
 	CONS_Debug(DBG_MEMORY, "Z_Malloc %s:%d\n", file, line);
@@ -301,11 +538,23 @@ void *Z_MallocAlign(size_t size, INT32 tag, void *user, INT32 alignbits)
 	if (blocksize < size)/* overflow check */
 		I_Error("You are allocating memory too large!");
 
-	block = xm(sizeof *block);
+#ifdef ZSLAB
+	if (zslabenabled && tag < PU_PURGELEVEL && blocksize <= ZSLAB_MAXSIZE - sizeof *block)
+	{
+		// Small block: memblock_t and data share one slab slot.
+		block = Z_SlabAlloc(&slabclasses[slabclassfor[(blocksize + sizeof *block + 15)>>4]]);
+		ptr = (UINT8 *)block + sizeof *block;
+		slab = true;
+	}
+	else
+#endif
+	{
+		block = xm(sizeof *block);
 #ifdef HAVE_VALGRIND
-	padsize += (1<<sizeof(size_t))*2;
+		padsize += (1<<sizeof(size_t))*2;
 #endif
-	ptr = xm(blocksize + padsize*2);
+		ptr = xm(blocksize + padsize*2);
+	}
 
 	// This horrible calculation makes sure that "given" is aligned
 	// properly.
@@ -319,12 +568,11 @@ void *Z_MallocAlign(size_t size, INT32 tag, void *user, INT32 alignbits)
 	Z_calloc = false;
 #endif
 
-	block->next = head.next;
-	block->prev = &head;
-	head.next = block;
-	block->next->prev = block;
-
 	block->real = ptr;
+#ifdef ZSLAB
+	if (slab)
+		block->real = block;
+#endif
 	block->hdr = hdr;
 	block->tag = tag;
 	block->user = NULL;
@@ -335,6 +583,8 @@ void *Z_MallocAlign(size_t size, INT32 tag, void *user, INT32 alignbits)
 	block->size = blocksize;
 	block->realsize = size;
 
+	Z_LinkBlock(block);
+
 #ifdef VALGRIND_CREATE_MEMPOOL
 	VALGRIND_CREATE_MEMPOOL(block, padsize, Z_calloc);
 #endif
@@ -435,6 +685,24 @@ void *Z_ReallocAlign(void *ptr, size_t size, INT32 tag, void *user, INT32 alignb
 #endif
 	}
 
+	if (numexternals)
+	{
+		zexternal_t *ext = Z_FindExternal(ptr);
+		if (ext)
+		{
+			copysize = min(size, (size_t)(ext->base + ext->size - (UINT8 *)ptr));
+#ifdef ZDEBUG
+			rez = Z_Malloc2(size, tag, user, alignbits, file, line);
+#else
+			rez = Z_MallocAlign(size, tag, user, alignbits);
+#endif
+			M_Memcpy(rez, ptr, copysize);
+			if (size > copysize)
+				memset((char*)rez+copysize, 0x00, size-copysize);
+			return rez;
+		}
+	}
+
 #ifdef ZDEBUG
 	block = Ptr2Memblock2(ptr, "Z_Realloc", file, line);
 #else
@@ -484,14 +752,21 @@ void *Z_ReallocAlign(void *ptr, size_t size, INT32 tag, void *user, INT32 alignb
 void Z_FreeTags(INT32 lowtag, INT32 hightag)
 {
 	memblock_t *block, *next;
+	INT32 l;
 
-	Z_CheckHeap(420);
-	for (block = head.next; block != &head; block = next)
+	if (lowtag > hightag)
+		return;
+
+	for (l = ZTAGLIST(lowtag); l <= ZTAGLIST(hightag); l++)
 	{
-		next = block->next; // get link before freeing
+		Z_CheckList(420, &heads[l]);
+		for (block = heads[l].next; block != &heads[l]; block = next)
+		{
+			next = block->next; // get link before freeing
 
-		if (block->tag >= lowtag && block->tag <= hightag)
-			Z_Free((UINT8 *)block->hdr + sizeof *block->hdr);
+			if (block->tag >= lowtag && block->tag <= hightag)
+				Z_Free((UINT8 *)block->hdr + sizeof *block->hdr);
+		}
 	}
 }
 
@@ -551,19 +826,21 @@ void Z_CheckMemCleanup(void)
 }
 
 
-/** Checks the heap, as well as the memhdr_ts, for any corruption or
-  * other problems.
-  * \param i Identifies from where in the code Z_CheckHeap was called.
+/** Checks one of the tag lists, as well as the memhdr_ts, for any
+  * corruption or other problems.
+  * \param i Identifies from where in the code the check was requested.
+  * \param list The head of the tag list to check.
   * \author Graue <graue@oceanbase.org>
+  * \sa Z_CheckHeap
   */
-void Z_CheckHeap(INT32 i)
+static void Z_CheckList(INT32 i, memblock_t *list)
 {
 	memblock_t *block;
 	memhdr_t *hdr;
 	UINT32 blocknumon = 0;
 	void *given;
 
-	for (block = head.next; block != &head; block = block->next)
+	for (block = list->next; block != list; block = block->next)
 	{
 		blocknumon++;
 		hdr = block->hdr;
@@ -656,6 +933,18 @@ void Z_CheckHeap(INT32 i)
 	}
 }
 
+/** Checks the heap, as well as the memhdr_ts, for any corruption or
+  * other problems.
+  * \param i Identifies from where in the code Z_CheckHeap was called.
+  */
+void Z_CheckHeap(INT32 i)
+{
+	INT32 l;
+
+	for (l = 0; l < NUMZONETAGS; l++)
+		Z_CheckList(i, &heads[l]);
+}
+
 // ------------------------
 // Zone memory modification
 // ------------------------
@@ -679,6 +968,10 @@ void Z_ChangeTag(void *ptr, INT32 tag)
 	if (ptr == NULL)
 		return;
 
+	// Never purged, so any tag will do
+	if (numexternals && Z_FindExternal(ptr))
+		return;
+
 	hdr = (memhdr_t *)((UINT8 *)ptr - sizeof *hdr);
 
 #ifdef VALGRIND_MAKE_MEM_DEFINED
@@ -709,7 +1002,15 @@ void Z_ChangeTag(void *ptr, INT32 tag)
 		I_Error("Internal memory management error: "
 			"tried to make block purgable but it has no owner");
 
+	if (ZTAGLIST(tag) == ZTAGLIST(block->tag))
+	{
+		block->tag = tag;
+		return;
+	}
+
+	Z_UnlinkBlock(block);
 	block->tag = tag;
+	Z_LinkBlock(block);
 }
 
 /** Changes a memory block's user.
@@ -731,6 +1032,12 @@ void Z_SetUser(void *ptr, void **newuser)
 	if (ptr == NULL)
 		return;
 
+	if (numexternals && Z_FindExternal(ptr))
+	{
+		*newuser = ptr;
+		return;
+	}
+
 	hdr = (memhdr_t *)((UINT8 *)ptr - sizeof *hdr);
 
 #ifdef VALGRIND_MAKE_MEM_DEFINED
@@ -770,12 +1077,27 @@ size_t Z_TagsUsage(INT32 lowtag, INT32 hightag)
 {
 	size_t cnt = 0;
 	memblock_t *rover;
+	INT32 l;
+
+	if (lowtag > hightag)
+		return 0;
 
-	for (rover = head.next; rover != &head; rover = rover->next)
+	for (l = ZTAGLIST(lowtag); l <= ZTAGLIST(hightag); l++)
 	{
-		if (rover->tag < lowtag || rover->tag > hightag)
+		// Lists that hold a single tag keep a running total
+		if (l != 0 && l != NUMZONETAGS-1)
+		{
+			cnt += tagusage[l];
 			continue;
-		cnt += rover->size + sizeof *rover;
+		}
+
+		// The shared ones may be only partly in range
+		for (rover = heads[l].next; rover != &heads[l]; rover = rover->next)
+		{
+			if (rover->tag < lowtag || rover->tag > hightag)
+				continue;
+			cnt += rover->size + sizeof *rover;
+		}
 	}
 
 	return cnt;
@@ -822,6 +1144,39 @@ static void Command_Memfree_f(void)
 	CONS_Printf(M_GetText("Available physical memory: %7u KB\n"), freebytes>>10);
 }
 
+#ifdef ZSLAB
+/** The function called by the "memslab" console command.
+  * Prints how full each of the small block size classes is.
+  */
+static void Command_Memslab_f(void)
+{
+	size_t i, pages = 0, slots = 0, used = 0;
+
+	if (!zslabenabled)
+	{
+		CONS_Printf(M_GetText("Zone slabs are disabled (-nozoneslab).\n"));
+		return;
+	}
+
+	CONS_Printf("\x82%s", M_GetText("Zone Slab Info\n"));
+	CONS_Printf(M_GetText("Slot  Pages   Used/Slots     KB   Full\n"));
+	for (i = 0; i < NUMSLABCLASSES; i++)
+	{
+		const zslabclass_t *sc = &slabclasses[i];
+		if (!sc->numpages)
+			continue;
+		CONS_Printf("%4s %6s %6s/%-6s %6s %5d%%\n", sizeu1(sc->slotsize), sizeu2(sc->numpages),
+			sizeu3(sc->used), sizeu4(sc->numslots), sizeu5((sc->numpages*ZSLAB_PAGESIZE)>>10),
+			(INT32)(sc->used*100 / sc->numslots));
+		pages += sc->numpages;
+		slots += sc->numslots;
+		used += sc->used;
+	}
+	CONS_Printf(M_GetText("Total: %s KB in %s pages, %s of %s slots used\n"),
+		sizeu1((pages*ZSLAB_PAGESIZE)>>10), sizeu2(pages), sizeu3(used), sizeu4(slots));
+}
+#endif
+
 #ifdef ZDEBUG
 /** The function called by the "memdump" console command.
   * Prints zone memory debugging information (i.e. tag, size, location in code allocated).
@@ -840,12 +1195,16 @@ static void Command_Memdump_f(void)
 	if ((i = COM_CheckParm("-max")))
 		maxtag = atoi(COM_Argv(i + 1));
 
-	for (block = head.next; block != &head; block = block->next)
-		if (block->tag >= mintag && block->tag <= maxtag)
-		{
-			char *filename = strrchr(block->ownerfile, PATHSEP[0]);
-			CONS_Printf("[%3d] %s (%s) bytes @ %s:%d\n", block->tag, sizeu1(block->size), sizeu2(block->realsize), filename ? filename + 1 : block->ownerfile, block->ownerline);
-		}
+	if (mintag > maxtag)
+		return;
+
+	for (i = ZTAGLIST(mintag); i <= ZTAGLIST(maxtag); i++)
+		for (block = heads[i].next; block != &heads[i]; block = block->next)
+			if (block->tag >= mintag && block->tag <= maxtag)
+			{
+				char *filename = strrchr(block->ownerfile, PATHSEP[0]);
+				CONS_Printf("[%3d] %s (%s) bytes @ %s:%d\n", block->tag, sizeu1(block->size), sizeu2(block->realsize), filename ? filename + 1 : block->ownerfile, block->ownerline);
+			}
 }
 #endif
 
@@ -107,6 +107,10 @@ void *Z_ReallocAlign(void *ptr, size_t size, INT32 tag, void *user, INT32 alignb
 #define Z_FreeTag(tagnum) Z_FreeTags(tagnum, tagnum)
 void Z_FreeTags(INT32 lowtag, INT32 hightag);
 
+// Memory the zone doesn't own, see Z_AddExternal
+void Z_AddExternal(void *base, size_t size);
+void Z_RemoveExternal(void *base);
+
 //
 // Utility functions
 //